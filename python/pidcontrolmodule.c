@@ -0,0 +1,459 @@
+/*********************************************************************
+* File: pidcontrolmodule.c
+*
+* Python extension module wrapping the controllers of the library. The
+* module uses the library exactly as compiled for a target (value format,
+* integration algorithm, ...), hence Python scripts get the same numbers
+* as the target.
+*
+* Arrays are passed through the buffer protocol, so NumPy arrays,
+* array.array and memoryview objects are stepped in place without
+* copying. The array type has to match the value format of the library
+* (module attribute FORMAT, e.g. numpy.float32 for PID_VAL_FORMAT_F32).
+* Values in fixpoint format are passed as integers scaled by
+* FIXPOINT_FACTOR.
+*
+* The controllers are the global bank of the library, which has no lock
+* of its own. All functions keep the GIL while they access the bank, so
+* calls from several Python threads are serialized. A long batch step
+* therefore blocks the other threads of the interpreter.
+*
+* Build it with "python3 setup.py build_ext --inplace" in this directory,
+* see setup.py for the options.
+*
+*
+* Copyright (c) 2014 Jan Winkler, Matthias Schfer, Oscar Rivera
+* Institut fr Regelungs- und Steuerungstheorie
+* Technische Universitt Dresden / Dresden University of Technology
+* D-01062 Dresden, Germany
+*
+* Redistribution and use in source and binary forms, with or without 
+* modification, are permitted provided that the following conditions 
+* are met:
+*
+*     Redistributions of source code must retain the above copyright 
+*     notice, this list of conditions and the following disclaimer. 
+*
+*     Redistributions in binary form must not misrepresent the orignal
+*     source in the documentation and/or other materials provided 
+*     with the distribution. 
+*
+*     The names of the authors nor its contributors may be used to 
+*     endorse or promote products derived from this software without 
+*     specific prior written permission. 
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+* OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Jan.Winkler@tu-dresden.de
+* 04.06.2014
+*********************************************************************/
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include "pidcontrol.h"
+
+
+/* Format character of the buffer protocol for the value type */
+#if (defined PID_VAL_FORMAT_I8)
+	#define PIDPY_FORMAT "b"
+#elif (defined PID_VAL_FORMAT_I16)
+	#define PIDPY_FORMAT "h"
+#elif (defined PID_VAL_FORMAT_I32)
+	#define PIDPY_FORMAT "i"
+#elif (defined PID_VAL_FORMAT_I64)
+	#define PIDPY_FORMAT "q"
+#elif (defined PID_VAL_FORMAT_F32)
+	#define PIDPY_FORMAT "f"
+#else
+	#define PIDPY_FORMAT "d"
+#endif
+
+
+/* Returns None for pidErr_Ok, otherwise raises a ValueError for the 
+   error code of the library and returns NULL
+*/
+static PyObject* pidpy_Result( PIDErr err )
+{
+	static const char* msg[] =
+	{
+		"ok",
+		"controller index out of range",
+		"sample time <= 0",
+		"Tn <= 0",
+		"Tv <= 0",
+		"Tf < sample time",
+		"invalid gain schedule",
+		"invalid memory",
+		"input/output error",
+		"not supported"
+	};
+
+	if ( err == pidErr_Ok ) Py_RETURN_NONE;
+	PyErr_SetString(PyExc_ValueError, ((unsigned)err < sizeof(msg)/sizeof(msg[0])) ? msg[err] : "unknown error");
+	return NULL;
+}
+
+
+
+/* Converts a Python number to the value type */
+static int pidpy_Val( PyObject* o, void* v )
+{
+#ifdef PID_FIXPOINT
+	long long x = PyLong_AsLongLong(o);
+	if ( x == -1 && PyErr_Occurred() ) return 0;
+	if ( x < (long long)PID_VAL_MIN || x > (long long)PID_VAL_MAX )
+	{
+		PyErr_SetString(PyExc_OverflowError, "value does not fit into the value format of the library");
+		return 0;
+	}
+	*(PIDValue*)v = (PIDValue)x;
+#else
+	double x = PyFloat_AsDouble(o);
+	if ( x == -1.0 && PyErr_Occurred() ) return 0;
+	*(PIDValue*)v = (PIDValue)x;
+#endif
+	return 1;
+}
+
+
+
+/* Converts the value type to a Python number */
+static PyObject* pidpy_Obj( PIDValue v )
+{
+#ifdef PID_FIXPOINT
+	return PyLong_FromLongLong((long long)v);
+#else
+	return PyFloat_FromDouble((double)v);
+#endif
+}
+
+
+
+/* Converts a Python integer to a controller index */
+static int pidpy_Ind( PyObject* o, void* id )
+{
+	unsigned long x = PyLong_AsUnsignedLong(o);
+	if ( x == (unsigned long)-1 && PyErr_Occurred() ) return 0;
+	if ( x >= PID_NUM_CONTROLLERS )
+	{
+		pidpy_Result(pidErr_Index);
+		return 0;
+	}
+	*(PIDInd*)id = (PIDInd)x;
+	return 1;
+}
+
+
+
+/* Gets a C-contiguous buffer of values. Any format character of the
+   same kind and size as the value type is accepted, e.g. "l" and "q"
+   for 64bit integers.
+*/
+static int pidpy_GetBuffer( PyObject* o, Py_buffer* b, int writable )
+{
+	const char* f;
+
+	if ( PyObject_GetBuffer(o, b, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0)) != 0 )
+		return 0;
+
+	f = b->format ? b->format : "B";
+	if ( *f == '@' || *f == '=' ) f++;
+#if (PY_BIG_ENDIAN)
+	if ( *f == '>' || *f == '!' ) f++;
+#else
+	if ( *f == '<' ) f++;
+#endif
+
+	if ( b->itemsize != sizeof(PIDValue) || f[0] == 0 || f[1] != 0 ||
+#ifdef PID_FIXPOINT
+		 strchr("bhilq", f[0]) == NULL )
+#else
+		 strchr("fd", f[0]) == NULL )
+#endif
+	{
+		PyErr_Format(PyExc_TypeError, "array of format '%s' expected, got '%s'", PIDPY_FORMAT, b->format ? b->format : "B");
+		PyBuffer_Release(b);
+		return 0;
+	}
+	return 1;
+}
+
+
+
+/* Returns the output buffer: the passed object or a new memoryview of n
+   values. The reference to the returned object is owned by the caller.
+*/
+static PyObject* pidpy_Out( PyObject* out, Py_buffer* b, Py_ssize_t n )
+{
+	PyObject *bytes, *view, *cast;
+
+	if ( out == NULL || out == Py_None )
+	{
+		bytes = PyByteArray_FromStringAndSize(NULL, n*(Py_ssize_t)sizeof(PIDValue));
+		if ( bytes == NULL ) return NULL;
+		view = PyMemoryView_FromObject(bytes);
+		Py_DECREF(bytes);
+		if ( view == NULL ) return NULL;
+		cast = PyObject_CallMethod(view, "cast", "s", PIDPY_FORMAT);
+		Py_DECREF(view);
+		out = cast;
+	}
+	else Py_INCREF(out);
+
+	if ( out == NULL ) return NULL;
+	if ( !pidpy_GetBuffer(out, b, 1) )
+	{
+		Py_DECREF(out);
+		return NULL;
+	}
+	if ( b->len != n*(Py_ssize_t)sizeof(PIDValue) )
+	{
+		PyErr_SetString(PyExc_ValueError, "output array has not the size of the input array");
+		PyBuffer_Release(b);
+		Py_DECREF(out);
+		return NULL;
+	}
+	return out;
+}
+
+
+
+static PyObject* pidpy_Init( PyObject* self, PyObject* args )
+{
+	pid_Init();
+	Py_RETURN_NONE;
+}
+
+
+
+static PyObject* pidpy_ParaSet_T( PyObject* self, PyObject* args )
+{
+	PIDInd id;
+	PIDValue Kr, Tn, Tv, Tf, TSample;
+
+	if ( !PyArg_ParseTuple(args, "O&O&O&O&O&O&", pidpy_Ind, &id, pidpy_Val, &Kr, pidpy_Val, &Tn, 
+						   pidpy_Val, &Tv, pidpy_Val, &Tf, pidpy_Val, &TSample) )
+		return NULL;
+	return pidpy_Result(pid_ParaSet_T(id, Kr, Tn, Tv, Tf, TSample));
+}
+
+
+
+static PyObject* pidpy_ParaSet_K( PyObject* self, PyObject* args )
+{
+	PIDInd id;
+	PIDValue Kp, Ki, Kd, Tf, TSample;
+
+	if ( !PyArg_ParseTuple(args, "O&O&O&O&O&O&", pidpy_Ind, &id, pidpy_Val, &Kp, pidpy_Val, &Ki, 
+						   pidpy_Val, &Kd, pidpy_Val, &Tf, pidpy_Val, &TSample) )
+		return NULL;
+	return pidpy_Result(pid_ParaSet_K(id, Kp, Ki, Kd, Tf, TSample));
+}
+
+
+
+static PyObject* pidpy_LimitsSet( PyObject* self, PyObject* args )
+{
+	PIDInd id;
+	PIDValue yMin, yMax;
+
+	if ( !PyArg_ParseTuple(args, "O&O&O&", pidpy_Ind, &id, pidpy_Val, &yMin, pidpy_Val, &yMax) )
+		return NULL;
+	return pidpy_Result(pid_LimitsSet(id, yMin, yMax));
+}
+
+
+
+static PyObject* pidpy_ArwSet( PyObject* self, PyObject* args )
+{
+	PIDInd id;
+	int on;
+
+	if ( !PyArg_ParseTuple(args, "O&p", pidpy_Ind, &id, &on) )
+		return NULL;
+	return pidpy_Result(pid_ArwSet(id, on ? pidArw_On : pidArw_Off));
+}
+
+
+
+static PyObject* pidpy_IPartSet( PyObject* self, PyObject* args )
+{
+	PIDInd id;
+	PIDValue I;
+
+	if ( !PyArg_ParseTuple(args, "O&O&", pidpy_Ind, &id, pidpy_Val, &I) )
+		return NULL;
+	return pidpy_Result(pid_IPartSet(id, I));
+}
+
+
+
+static PyObject* pidpy_Reset( PyObject* self, PyObject* args )
+{
+	PIDInd id;
+
+	if ( !PyArg_ParseTuple(args, "O&", pidpy_Ind, &id) )
+		return NULL;
+	return pidpy_Result(pid_Reset(id));
+}
+
+
+
+static PyObject* pidpy_PartsGet( PyObject* self, PyObject* args )
+{
+	PIDInd id;
+	PIDValue P, I, D;
+
+	if ( !PyArg_ParseTuple(args, "O&", pidpy_Ind, &id) )
+		return NULL;
+	pid_PartsGet(id, &P, &I, &D);
+	return Py_BuildValue("(NNN)", pidpy_Obj(P), pidpy_Obj(I), pidpy_Obj(D));
+}
+
+
+
+static PyObject* pidpy_Step( PyObject* self, PyObject* args )
+{
+	PIDInd id;
+	PIDValue e, y;
+
+	if ( !PyArg_ParseTuple(args, "O&O&", pidpy_Ind, &id, pidpy_Val, &e) )
+		return NULL;
+	pid_Step(id, e, &y);
+	return pidpy_Obj(y);
+}
+
+
+
+/* step_block(id, e, out=None): steps controller id over all values of e */
+static PyObject* pidpy_StepBlock( PyObject* self, PyObject* args, PyObject* kw )
+{
+	static char* kwlist[] = { "id", "e", "out", NULL };
+	PIDInd id;
+	PyObject *e, *out = NULL;
+	Py_buffer be, by;
+
+	if ( !PyArg_ParseTupleAndKeywords(args, kw, "O&O|O", kwlist, pidpy_Ind, &id, &e, &out) )
+		return NULL;
+	if ( !pidpy_GetBuffer(e, &be, 0) ) return NULL;
+	out = pidpy_Out(out, &by, be.len/(Py_ssize_t)sizeof(PIDValue));
+	if ( out == NULL )
+	{
+		PyBuffer_Release(&be);
+		return NULL;
+	}
+
+	pid_StepBlock(id, (const PIDValue*)be.buf, (PIDValue*)by.buf, (size_t)(be.len/(Py_ssize_t)sizeof(PIDValue)));
+
+	PyBuffer_Release(&be);
+	PyBuffer_Release(&by);
+	return out;
+}
+
+
+
+/* step_bank(first, e, out=None): steps the controllers first, ..., 
+   first + m - 1 for the rows of e of shape (ticks, m)
+*/
+static PyObject* pidpy_StepBank( PyObject* self, PyObject* args, PyObject* kw )
+{
+	static char* kwlist[] = { "first", "e", "out", NULL };
+	PIDInd first, i;
+	PyObject *e, *out = NULL, *res;
+	Py_buffer be, by;
+	Py_ssize_t m, n, k;
+	const PIDValue* pe;
+	PIDValue* py;
+
+	if ( !PyArg_ParseTupleAndKeywords(args, kw, "O&O|O", kwlist, pidpy_Ind, &first, &e, &out) )
+		return NULL;
+	if ( !pidpy_GetBuffer(e, &be, 0) ) return NULL;
+
+	n = be.len/(Py_ssize_t)sizeof(PIDValue);
+	m = (be.ndim >= 2) ? be.shape[be.ndim-1] : n;
+	if ( m == 0 || first + m > PID_NUM_CONTROLLERS )
+	{
+		PyBuffer_Release(&be);
+		return pidpy_Result(pidErr_Index);
+	}
+
+	res = pidpy_Out(out, &by, n);
+	if ( res == NULL )
+	{
+		PyBuffer_Release(&be);
+		return NULL;
+	}
+
+	pe = (const PIDValue*)be.buf;
+	py = (PIDValue*)by.buf;
+	for (k = 0; k < n; k += m)
+	{
+		for (i = 0; i < (PIDInd)m; i++)
+		{
+			pid_Step(first + i, pe[k + i], &py[k + i]);
+		}
+	}
+
+	PyBuffer_Release(&be);
+	PyBuffer_Release(&by);
+	return res;
+}
+
+
+
+static PyMethodDef pidpy_Methods[] =
+{
+	{ "init",       pidpy_Init,      METH_NOARGS,  "init() -> initializes all controllers (pid_Init)" },
+	{ "para_set_t", pidpy_ParaSet_T, METH_VARARGS, "para_set_t(id, Kr, Tn, Tv, Tf, TSample) -> sets the parameters in time constant form" },
+	{ "para_set_k", pidpy_ParaSet_K, METH_VARARGS, "para_set_k(id, Kp, Ki, Kd, Tf, TSample) -> sets the parameters as gains" },
+	{ "limits_set", pidpy_LimitsSet, METH_VARARGS, "limits_set(id, yMin, yMax) -> sets the boundary values" },
+	{ "arw_set",    pidpy_ArwSet,    METH_VARARGS, "arw_set(id, on) -> switches the anti-windup on or off" },
+	{ "i_part_set", pidpy_IPartSet,  METH_VARARGS, "i_part_set(id, I) -> sets the I-part" },
+	{ "reset",      pidpy_Reset,     METH_VARARGS, "reset(id) -> resets the controller" },
+	{ "parts_get",  pidpy_PartsGet,  METH_VARARGS, "parts_get(id) -> (P, I, D) of the last step" },
+	{ "step",       pidpy_Step,      METH_VARARGS, "step(id, e) -> y, one step of the controller" },
+	{ "step_block", (PyCFunction)(void(*)(void))pidpy_StepBlock, METH_VARARGS | METH_KEYWORDS, 
+	  "step_block(id, e, out=None) -> out, steps the controller over the array e.\n"
+	  "out is written in place, a memoryview is returned if it is not given." },
+	{ "step_bank",  (PyCFunction)(void(*)(void))pidpy_StepBank, METH_VARARGS | METH_KEYWORDS, 
+	  "step_bank(first, e, out=None) -> out, steps the controllers first, ..., first+m-1\n"
+	  "for each row of the array e of shape (ticks, m)." },
+	{ NULL, NULL, 0, NULL }
+};
+
+
+
+static struct PyModuleDef pidpy_Module =
+{
+	PyModuleDef_HEAD_INIT, "pidcontrol", 
+	"Bindings of the PID controller library, see pidcontrol.h", -1, pidpy_Methods
+};
+
+
+
+PyMODINIT_FUNC PyInit_pidcontrol( void )
+{
+	PyObject* m = PyModule_Create(&pidpy_Module);
+	if ( m == NULL ) return NULL;
+
+	PyModule_AddIntConstant(m, "NUM_CONTROLLERS", PID_NUM_CONTROLLERS);
+	PyModule_AddStringConstant(m, "FORMAT", PIDPY_FORMAT);
+#ifdef PID_FIXPOINT
+	PyModule_AddIntConstant(m, "FIXPOINT_FACTOR", PID_FIXPOINT_FACTOR);
+#else
+	PyModule_AddIntConstant(m, "FIXPOINT_FACTOR", 1);
+#endif
+
+	pid_Init();
+	return m;
+}
@@ -0,0 +1,44 @@
+"""
+Builds the Python extension module pidcontrol from the C library.
+
+    python3 setup.py build_ext --inplace
+    python3 test_pidcontrol.py
+
+The library is compiled with the configuration of ../src/pidconfig.h.
+The following environment variables override it, so the module can be
+built for the configuration of a target:
+
+PID_VAL_FORMAT: value format (I8, I16, I32, I64, F32, F64)
+PID_INTEGER_PRECISION: decimal places of the fixpoint formats
+PID_INTALGO: integration algorithm (RECT, TRAPZ)
+PID_NUM_CONTROLLERS: number of controllers
+"""
+
+import os
+from setuptools import setup, Extension
+
+src = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src")
+src = os.path.relpath(src)
+
+macros = []
+if os.environ.get("PID_VAL_FORMAT"):
+    macros.append(("PID_VAL_FORMAT_" + os.environ["PID_VAL_FORMAT"], None))
+if os.environ.get("PID_INTALGO"):
+    macros.append(("PID_INTALGO_" + os.environ["PID_INTALGO"], None))
+for name in ("PID_INTEGER_PRECISION", "PID_NUM_CONTROLLERS"):
+    if os.environ.get(name):
+        macros.append((name, os.environ[name]))
+
+setup(
+    name="pidcontrol",
+    version="1.0",
+    description="PID controller library",
+    ext_modules=[
+        Extension(
+            "pidcontrol",
+            sources=["pidcontrolmodule.c", os.path.join(src, "pidcontrol.c")],
+            include_dirs=[src],
+            define_macros=macros,
+        )
+    ],
+)
@@ -0,0 +1,116 @@
+"""
+Tests of the extension module pidcontrol (build it with setup.py first).
+
+The controllers of pidtest are stepped with the test data of this
+directory, the results of the batch functions have to equal the ones
+of single steps. The comparison with the simulation of the toolbox
+uses the thresholds of pidtest. NumPy arrays are tested if NumPy is
+installed, array.array otherwise.
+"""
+
+import array
+import os
+import unittest
+
+import pidcontrol as pid
+
+try:
+    import numpy as np
+except ImportError:
+    np = None
+
+DATAFILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "PIDControlTestDataPython.txt")
+
+# parameters of pidtest for floating point and fixpoint arithmetic
+FIXPOINT = pid.FORMAT not in "fd"
+F = pid.FIXPOINT_FACTOR
+if FIXPOINT:
+    PARAS = [(2*F, 0, 0, 0, 5), (2*F, F//20, 0, 0, 5), (2*F, F//20, 20*F, 20, 5)]
+    VARIANCE = 2*10.0**(-2*(len(str(F)) - 2))
+else:
+    PARAS = [(2, 0, 0, 0, 0.5), (2, 0.5, 0, 0, 0.5), (2, 0.5, 2, 2, 0.5)]
+    VARIANCE = 2e-13
+
+
+def load():
+    with open(DATAFILE) as f:
+        rows = [[float(x) for x in line.split()] for line in f if line.strip()]
+    return list(zip(*rows))
+
+
+def values(x):
+    if FIXPOINT:
+        return [int(v*F) for v in x]
+    return list(x)
+
+
+class TestPIDControl(unittest.TestCase):
+
+    def setUp(self):
+        self.t, self.e, self.yP, self.yPI, self.yPID = load()
+        pid.init()
+        for i, p in enumerate(PARAS):
+            pid.para_set_k(i, *p)
+
+    def single(self, i, e):
+        pid.reset(i)
+        return [pid.step(i, v) for v in e]
+
+    def test_block_equals_single_steps(self):
+        e = values(self.e)
+        for i in range(len(PARAS)):
+            y = self.single(i, e)
+            pid.reset(i)
+            out = pid.step_block(i, array.array(pid.FORMAT, e))
+            self.assertEqual(list(out), y)
+
+    def test_block_in_place(self):
+        e = array.array(pid.FORMAT, values(self.e))
+        y = array.array(pid.FORMAT, bytes(len(e)*e.itemsize))
+        pid.reset(2)
+        self.assertIs(pid.step_block(2, e, y), y)
+        self.assertEqual(list(y), self.single(2, list(e)))
+
+    def test_bank(self):
+        e = values(self.e)
+        bank = array.array(pid.FORMAT, [v for v in e for i in range(3)])
+        for i in range(3):
+            pid.reset(i)
+        y = pid.step_bank(0, memoryview(bank).cast("B").cast(pid.FORMAT, (len(e), 3)))
+        for i in range(3):
+            self.assertEqual(list(y)[i::3], self.single(i, e))
+
+    def test_simulation(self):
+        e = array.array(pid.FORMAT, values(self.e))
+        for i, ref in enumerate((self.yP, self.yPI, self.yPID)):
+            pid.reset(i)
+            y = pid.step_block(i, e)
+            ref = values(ref)
+            var = sum(((y[k] - ref[k])/F)**2 for k in range(len(ref)))/len(ref)
+            self.assertLessEqual(var, VARIANCE)
+
+    def test_errors(self):
+        with self.assertRaises(ValueError):
+            pid.step(pid.NUM_CONTROLLERS, 0)
+        with self.assertRaises(TypeError):
+            pid.step_block(0, array.array("b" if pid.FORMAT != "b" else "d", [0]))
+        with self.assertRaises(ValueError):
+            pid.step_block(0, array.array(pid.FORMAT, [0, 0]), array.array(pid.FORMAT, [0]))
+
+    @unittest.skipIf(np is None, "NumPy not installed")
+    def test_numpy(self):
+        e = np.array(values(self.e), dtype=pid.FORMAT)
+        y = np.zeros_like(e)
+        pid.reset(2)
+        pid.step_block(2, e, y)
+        self.assertEqual(y.tolist(), self.single(2, e.tolist()))
+        bank = np.repeat(e[:, None], 3, axis=1)
+        for i in range(3):
+            pid.reset(i)
+        yb = np.asarray(pid.step_bank(0, bank)).reshape(bank.shape)
+        for i in range(3):
+            self.assertEqual(yb[:, i].tolist(), self.single(i, e.tolist()))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,209 @@
+/*********************************************************************
+* File: pidbank.c
+*
+* Implementation of the allocation of the controller memory on huge
+* pages and NUMA nodes (Linux). The NUMA policies are set by the system
+* call mbind, hence libnuma is not required.
+*
+* Refer to the header for more information
+*
+*
+* Copyright (c) 2014 Jan Winkler, Matthias Schfer, Oscar Rivera
+* Institut fr Regelungs- und Steuerungstheorie
+* Technische Universitt Dresden / Dresden University of Technology
+* D-01062 Dresden, Germany
+*
+* Redistribution and use in source and binary forms, with or without 
+* modification, are permitted provided that the following conditions 
+* are met:
+*
+*     Redistributions of source code must retain the above copyright 
+*     notice, this list of conditions and the following disclaimer. 
+*
+*     Redistributions in binary form must not misrepresent the orignal
+*     source in the documentation and/or other materials provided 
+*     with the distribution. 
+*
+*     The names of the authors nor its contributors may be used to 
+*     endorse or promote products derived from this software without 
+*     specific prior written permission. 
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+* OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Jan.Winkler@tu-dresden.de
+* 04.06.2014
+*********************************************************************/
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "pidbank.h"
+
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+/* Size of a transparent huge page */
+#define PID_BANK_THP_SIZE ((size_t)1 << 21)
+
+/* Maximum number of NUMA nodes supported by the node masks */
+#define PID_BANK_MAX_NODES 1024
+
+
+
+/* Size of the pages the memory is mapped with, i.e. the granularity 
+   of the NUMA policies
+*/
+static size_t pid_BankPageSize( PIDBankPages Pages )
+{
+	switch ( Pages )
+	{
+	case pidBank_Pages2M: return (size_t)1 << 21;
+	case pidBank_Pages1G: return (size_t)1 << 30;
+	default:			  return (size_t)sysconf(_SC_PAGESIZE);
+	}
+}
+
+
+
+/* Binds the page aligned memory [p, p+len) to the NUMA node */
+static int pid_BankMbind( void* p, size_t len, int Node, unsigned flags )
+{
+	unsigned long mask[PID_BANK_MAX_NODES/(8*sizeof(unsigned long))] = { 0 };
+
+	if ( Node < 0 || Node >= PID_BANK_MAX_NODES ) return -1;
+	mask[Node/(8*sizeof(unsigned long))] = 1UL << (Node % (8*sizeof(unsigned long)));
+
+	return (int)syscall(SYS_mbind, p, len, MPOL_BIND, mask, PID_BANK_MAX_NODES + 1, flags);
+}
+
+
+
+/* Maps len bytes aligned to align with the given flags */
+static void* pid_BankMap( size_t len, size_t align, int flags )
+{
+	uint8_t *p, *a;
+
+	p = mmap(NULL, len + align, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if ( p == MAP_FAILED ) return p;
+
+	/* Release the unaligned head and the rest of the tail */
+	a = (uint8_t*)(((uintptr_t)p + align - 1) & ~(uintptr_t)(align - 1));
+	if ( a > p ) munmap(p, a - p);
+	munmap(a + len, (p + len + align) - (a + len));
+
+	return a;
+}
+
+
+
+PIDErr pid_BankAlloc( PIDBank* b, PIDBankPages Pages, int Node )
+{
+	size_t size = pid_BankSize(), page;
+	void* p = MAP_FAILED;
+	int flags;
+
+	b->Mem = NULL;
+
+	for (;;)
+	{
+		flags = MAP_PRIVATE | MAP_ANONYMOUS;
+		page  = pid_BankPageSize(Pages);
+
+		if ( Pages == pidBank_Pages2M ) flags |= MAP_HUGETLB | MAP_HUGE_2MB;
+		if ( Pages == pidBank_Pages1G ) flags |= MAP_HUGETLB | MAP_HUGE_1GB;
+
+		if ( Pages == pidBank_PagesTHP )
+		{
+			/* Transparent huge pages require mappings aligned to their size */
+			b->Len = (size + PID_BANK_THP_SIZE - 1) & ~(PID_BANK_THP_SIZE - 1);
+			p = pid_BankMap(b->Len, PID_BANK_THP_SIZE, flags);
+			if ( p != MAP_FAILED && madvise(p, b->Len, MADV_HUGEPAGE) != 0 )
+			{
+				munmap(p, b->Len);
+				p = MAP_FAILED;
+			}
+		}
+		else
+		{
+			/* Huge page mappings are aligned by the kernel */
+			b->Len = (size + page - 1) & ~(page - 1);
+			p = mmap(NULL, b->Len, PROT_READ | PROT_WRITE, flags, -1, 0);
+		}
+
+		if ( p != MAP_FAILED || Pages == pidBank_Pages4K ) break;
+		Pages = (PIDBankPages)(Pages - 1);
+	}
+
+	if ( p == MAP_FAILED ) return pidErr_Memory;
+
+	if ( Node >= 0 && pid_BankMbind(p, b->Len, Node, 0) != 0 )
+	{
+		munmap(p, b->Len);
+		return pidErr_Memory;
+	}
+
+	b->Mem   = p;
+	b->Pages = Pages;
+
+	return pidErr_Ok;
+}
+
+
+
+PIDErr pid_BankBind( const PIDBank* b, PIDInd first, PIDInd n, int Node )
+{
+	size_t size = pid_BankSize()/PID_NUM_CONTROLLERS;
+	uintptr_t page = pid_BankPageSize(b->Pages), start, end;
+
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( (unsigned long)first + n > PID_NUM_CONTROLLERS ) return pidErr_Index;
+	if ( b->Mem == NULL )								 return pidErr_Memory;
+#endif
+
+	if ( n == 0 ) return pidErr_Ok;
+
+	start = ((uintptr_t)b->Mem + first*size) & ~(page - 1);
+	end   = ((uintptr_t)b->Mem + (first + (size_t)n)*size + page - 1) & ~(page - 1);
+	if ( pid_BankMbind((void*)start, end - start, Node, MPOL_MF_MOVE) != 0 ) return pidErr_Memory;
+
+	return pidErr_Ok;
+}
+
+
+
+int pid_BankNode( void )
+{
+	unsigned cpu, node;
+
+	if ( syscall(SYS_getcpu, &cpu, &node, NULL) != 0 ) return -1;
+	return (int)node;
+}
+
+
+
+void pid_BankFree( PIDBank* b )
+{
+	if ( b->Mem != NULL ) munmap(b->Mem, b->Len);
+	b->Mem = NULL;
+	b->Len = 0;
+}
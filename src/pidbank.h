@@ -0,0 +1,127 @@
+/*********************************************************************
+* File: pidbank.h
+*
+* Allocation of the memory of the controllers on huge pages and on NUMA
+* nodes (Linux). Build the library with PID_BANK_RELOCATABLE and pass
+* the allocated memory to pid_BankSet.
+*
+* Huge pages reduce the TLB misses when a large bank is stepped, either
+* from the huge page pool of the kernel (2 MiB, 1 GiB, see
+* /proc/sys/vm/nr_hugepages) or as transparent huge pages. The memory
+* of a bank may be bound to a NUMA node, or each shard of controllers
+* to the node of the thread stepping it. Alternatively leave the memory
+* unbound and initialize each shard by pid_InitRange from its thread,
+* the kernel then places the pages on the node of the first touch.
+*
+* pid_BankAlloc		-> Allocates the memory for the controllers
+* pid_BankBind		-> Binds the memory of a range of controllers to a NUMA node
+* pid_BankNode		-> Returns the NUMA node of the calling thread
+* pid_BankFree		-> Releases the memory
+*
+*
+* Copyright (c) 2014 Jan Winkler, Matthias Schfer, Oscar Rivera
+* Institut fr Regelungs- und Steuerungstheorie
+* Technische Universitt Dresden / Dresden University of Technology
+* D-01062 Dresden, Germany
+*
+* Redistribution and use in source and binary forms, with or without 
+* modification, are permitted provided that the following conditions 
+* are met:
+*
+*     Redistributions of source code must retain the above copyright 
+*     notice, this list of conditions and the following disclaimer. 
+*
+*     Redistributions in binary form must not misrepresent the orignal
+*     source in the documentation and/or other materials provided 
+*     with the distribution. 
+*
+*     The names of the authors nor its contributors may be used to 
+*     endorse or promote products derived from this software without 
+*     specific prior written permission. 
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+* OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Jan.Winkler@tu-dresden.de
+* 04.06.2014
+*********************************************************************/
+#ifndef PIDBANK_H
+#define PIDBANK_H
+
+#include "pidcontrol.h"
+
+
+/* Page types of the memory */
+typedef enum
+{
+	pidBank_Pages4K,	/* Normal pages */
+	pidBank_PagesTHP,	/* Transparent huge pages (madvise) */
+	pidBank_Pages2M,	/* 2 MiB pages from the huge page pool */
+	pidBank_Pages1G		/* 1 GiB pages from the huge page pool */
+} PIDBankPages;
+
+
+/* Memory allocated by pid_BankAlloc */
+typedef struct
+{
+	void*			Mem;	/* Memory to pass to pid_BankSet */
+	size_t			Len;	/* Length of the mapping in bytes */
+	PIDBankPages	Pages;	/* Page type actually obtained */
+} PIDBank;
+
+
+
+/* Allocates the memory for all controllers (pid_BankSize bytes). If the 
+   requested huge pages are not available the next smaller page type is
+   used (1G -> 2M -> THP -> 4K), the type obtained is stored in b->Pages.
+   The memory is zeroed but not initialized, call pid_Init or 
+   pid_InitRange after pid_BankSet. With PID_LAZY_INIT the zeroed memory
+   is a valid bank whose pages are only touched by the first use.
+
+   b	 -> The allocated memory is described here
+   Pages -> Requested page type
+   Node	 -> NUMA node to bind all memory to, -1 for first touch
+*/
+PIDErr pid_BankAlloc( PIDBank* b, PIDBankPages Pages, int Node );
+
+
+
+/* Binds the memory of the controllers first, ..., first+n-1 to the NUMA
+   node Node and moves pages which are already placed elsewhere. Pages
+   shared with the neighboring ranges are bound as well, hence the 
+   ranges should span whole pages.
+
+   b	 -> Memory allocated by pid_BankAlloc
+   first -> Index of the first controller
+   n	 -> Number of controllers
+   Node	 -> NUMA node, e.g. pid_BankNode() of the stepping thread
+*/
+PIDErr pid_BankBind( const PIDBank* b, PIDInd first, PIDInd n, int Node );
+
+
+
+/* Returns the NUMA node the calling thread is running on, -1 if it
+   cannot be determined
+*/
+int pid_BankNode( void );
+
+
+
+/* Releases the memory. Call pid_BankSet(NULL) before if the library
+   still uses it.
+
+   b	 -> Memory allocated by pid_BankAlloc
+*/
+void pid_BankFree( PIDBank* b );
+
+#endif
@@ -0,0 +1,1408 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "pidcontrol.h"
+#include "pidscan.h"
+#include "pidhalf.h"
+#include "pidlog.h"
+#include "pidexec.h"
+#if (defined PID_BANK_RELOCATABLE) && (defined __linux__)
+#include "pidbank.h"
+#define BENCH_BANKS
+#endif
+
+/* Benchmark for the PID controller library. Banks of controllers with
+ * randomized tunings are stepped with noisy control differences and the
+ * time per controller step is reported for several bank sizes.
+ * Build it with "make -f Makefile.linux bench" and pass the options of
+ * the library (format=I16, saturate=y, branchfree=y, ...) to make, or
+ * use "make -f Makefile.linux benchall" to run it for all value formats.
+ * Finally one controller is stepped over a long trace sequentially and
+ * with the parallel evaluation of pidscan.c using all processors, and
+ * the drift of the I-part of a floating point controller from the sum
+ * in double precision is shown (see PID_INTEGRATOR_COMPENSATED).
+ * The outputs of the whole bank are encoded into the binary log of
+ * pidlog.c, its speed and size are compared with the text output.
+ * The bank is reset by single calls and by the bulk operations on
+ * groups of controllers. The changed outputs
+ * are exported with several deadbands. The event-triggered step is
+ * compared with the full-rate step for quiescent controllers, the step
+ * from ADC counts with the fused input stage with a conversion pass. With
+ * PID_OUTPUT_STAGE (make bench outstage=y) the fused output stage is 
+ * compared with a second pass over the outputs. The cyclic executor of
+ * pidexec.c steps a part of the bank every millisecond, its wake-up
+ * latency and deadline misses are shown.
+ * If the library is built with PID_BANK_RELOCATABLE the whole bank is
+ * stepped in random order from memory with different page sizes
+ * (see pidbank.h) to show the effect of the TLB misses, and the startup
+ * time of a new bank is shown (see PID_LAZY_INIT). Pass controllers=N
+ * to make for another bank size, e.g. 1048576.
+ * On Linux the hardware counters (cycles, instructions, branch misses,
+ * cache misses and stalls) are read around each measured region and
+ * normalized to one controller step.
+ * Command Line Options: pidbench [steps]
+ * steps = number of controller steps per bank size (default 4194304)
+ * */
+
+/* Number of controller steps measured per bank size by default */
+#define BENCH_STEPS 4194304
+
+/* Smallest bank size, each further size is 16 times larger */
+#define BENCH_MIN_BANK 16
+
+/* Name of the value format the library got compiled for */
+#if (defined PID_VAL_FORMAT_I8)
+	#define BENCH_FORMAT "I8"
+#elif (defined PID_VAL_FORMAT_I16)
+	#define BENCH_FORMAT "I16"
+#elif (defined PID_VAL_FORMAT_I32)
+	#define BENCH_FORMAT "I32"
+#elif (defined PID_VAL_FORMAT_I64)
+	#define BENCH_FORMAT "I64"
+#elif (defined PID_VAL_FORMAT_F32)
+	#define BENCH_FORMAT "F32"
+#else
+	#define BENCH_FORMAT "F64"
+#endif
+
+#ifdef PID_FIXPOINT_SATURATE
+	#define BENCH_ARITH "saturating"
+#elif (defined PID_INTEGRATOR_COMPENSATED)
+	#define BENCH_ARITH "twosum"
+#else
+	#define BENCH_ARITH "plain"
+#endif
+
+#ifdef PID_STEP_BRANCHFREE
+	#define BENCH_KERNEL "branch-free"
+#else
+	#define BENCH_KERNEL "default"
+#endif
+
+
+/* Deterministic pseudo random numbers (xorshift) so that all builds
+ * of the benchmark work on the same bank and the same input data */
+#define BENCH_SEED 2463534242u
+static uint32_t bench_seed = BENCH_SEED;
+
+static double bench_Rand(double lo, double hi)
+{
+	bench_seed ^= bench_seed << 13;
+	bench_seed ^= bench_seed >> 17;
+	bench_seed ^= bench_seed << 5;
+	return lo + (hi - lo)*(bench_seed/4294967296.0);
+}
+
+/* Converts a floating point number into the value format of the library,
+ * values which are not representable are clamped */
+static PIDValue bench_Val(double x)
+{
+#ifdef PID_FIXPOINT
+	x *= PID_FIXPOINT_FACTOR;
+#endif
+	if (x > (double)PID_VAL_MAX) return PID_VAL_MAX;
+	if (x < (double)PID_VAL_MIN) return PID_VAL_MIN;
+	return (PIDValue)x;
+}
+
+/* Allocates zeroed memory for n elements of the given size, the benchmark
+ * has no results without its data, hence it stops if there is none */
+static void* bench_Alloc(size_t n, size_t size)
+{
+	void* p = calloc(n, size);
+
+	if (p == NULL && n > 0) {
+		puts("Memory allocation failed");
+		exit(1);
+	}
+	return p;
+}
+
+static double bench_Now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+/* Hardware counters read around the measured region. If the kernel does
+ * not permit their use (see /proc/sys/kernel/perf_event_paranoid) they
+ * are reported as n/a. */
+typedef struct
+{
+	const char* name;
+	uint32_t    type;
+	uint64_t    config;
+	int         fd;
+	double      value;
+} BenchCounter;
+
+#ifdef __linux__
+#define BENCH_CACHE(cache, op, result) \
+	((PERF_COUNT_HW_CACHE_##cache) | (PERF_COUNT_HW_CACHE_OP_##op << 8) | (PERF_COUNT_HW_CACHE_RESULT_##result << 16))
+
+static BenchCounter bench_counters[] =
+{
+	{ "cycles",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,              -1, 0 },
+	{ "instructions",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,            -1, 0 },
+	{ "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,           -1, 0 },
+	{ "L1d-misses",    PERF_TYPE_HW_CACHE, BENCH_CACHE(L1D, READ, MISS),          -1, 0 },
+	{ "LLC-misses",    PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,            -1, 0 },
+	{ "dTLB-misses",   PERF_TYPE_HW_CACHE, BENCH_CACHE(DTLB, READ, MISS),         -1, 0 },
+	{ "stalls-front",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND, -1, 0 },
+	{ "stalls-back",   PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND,  -1, 0 }
+};
+#define BENCH_NUM_COUNTERS (int)(sizeof(bench_counters)/sizeof(bench_counters[0]))
+
+/* Opens all counters. Counters not supported by the CPU or not permitted
+ * by the kernel keep fd = -1. More counters than the PMU provides are 
+ * multiplexed by the kernel, their values are scaled accordingly. */
+static void bench_PerfOpen(void)
+{
+	struct perf_event_attr attr;
+	int c, n = 0;
+
+	for (c = 0; c < BENCH_NUM_COUNTERS; c++)
+	{
+		memset(&attr, 0, sizeof(attr));
+		attr.size           = sizeof(attr);
+		attr.type           = bench_counters[c].type;
+		attr.config         = bench_counters[c].config;
+		attr.disabled       = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv     = 1;
+		attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		bench_counters[c].fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		n += (bench_counters[c].fd >= 0);
+	}
+	if (n == 0)
+		puts("hardware counters not available (perf_event_paranoid?), reporting timing only");
+}
+
+static void bench_PerfStart(void)
+{
+	int c;
+	for (c = 0; c < BENCH_NUM_COUNTERS; c++)
+	{
+		if (bench_counters[c].fd < 0) continue;
+		ioctl(bench_counters[c].fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(bench_counters[c].fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+static void bench_PerfStop(void)
+{
+	/* value, time enabled, time running */
+	uint64_t v[3];
+	int c;
+
+	for (c = 0; c < BENCH_NUM_COUNTERS; c++)
+	{
+		if (bench_counters[c].fd < 0) continue;
+		ioctl(bench_counters[c].fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(bench_counters[c].fd, v, sizeof(v)) != sizeof(v) || v[2] == 0)
+			bench_counters[c].value = -1;
+		else
+			bench_counters[c].value = (double)v[0]*v[1]/v[2];
+	}
+}
+#else
+#define BENCH_NUM_COUNTERS 0
+static BenchCounter bench_counters[1];
+static void bench_PerfOpen(void) {}
+static void bench_PerfStart(void) {}
+static void bench_PerfStop(void) {}
+#endif
+
+/* Prints the header of the result table */
+static void bench_PrintHeader(void)
+{
+	int c;
+
+	printf("%-6s %-11s %-10s %-8s %-14s %9s", "format", "kernel", "arith", "bank", "function", "ns/step");
+	for (c = 0; c < BENCH_NUM_COUNTERS; c++)
+		printf(" %13s", bench_counters[c].name);
+	printf("\n");
+}
+
+/* Prints one row of the result table, the counters are normalized to one
+ * controller step */
+static void bench_PrintRow(const char* function, long bank, double ns, double steps)
+{
+	int c;
+
+	printf("%-6s %-11s %-10s %-8ld %-14s %9.2f", BENCH_FORMAT, BENCH_KERNEL, BENCH_ARITH, bank, function, ns/steps);
+	for (c = 0; c < BENCH_NUM_COUNTERS; c++)
+	{
+		if (bench_counters[c].fd < 0 || bench_counters[c].value < 0)
+			printf(" %13s", "n/a");
+		else
+			printf(" %13.3f", bench_counters[c].value/steps);
+	}
+	printf("\n");
+}
+
+/* Gives every controller of the bank a random tuning. About half of the
+ * controllers use a filtered D-part, limits and anti-windup. The tunings
+ * follow the floating point and fixpoint parameters of pidtest. */
+static void bench_Setup(void)
+{
+	PIDInd i;
+	double Kp, Ki, Kd, Tf, lim;
+
+	pid_Init();
+	for (i = 0; i < PID_NUM_CONTROLLERS; i++)
+	{
+		Kp  = bench_Rand(0.1, 2.0);
+		Ki  = bench_Rand(0.0, 0.5);
+		Kd  = bench_Rand(0.0, 2.0);
+		Tf  = (bench_Rand(0.0, 1.0) < 0.5) ? 0 : bench_Rand(1.0, 4.0);
+		lim = bench_Rand(2.0, 8.0);
+#ifdef PID_FIXPOINT
+		/* Sample time 0.5s -> 5, see pidtest */
+		pid_ParaSet_K(i, bench_Val(Kp), bench_Val(Ki/10), bench_Val(Kd*10), (PIDValue)(Tf*10), 5);
+#else
+		pid_ParaSet_K(i, (PIDValue)Kp, (PIDValue)Ki, (PIDValue)Kd, (PIDValue)Tf, (PIDValue)0.5);
+#endif
+		if (bench_Rand(0.0, 1.0) < 0.5)
+			pid_LimitsSet(i, bench_Val(-lim), bench_Val(lim));
+		pid_ArwSet(i, (bench_Rand(0.0, 1.0) < 0.5) ? pidArw_On : pidArw_Off);
+	}
+}
+
+/* Noisy control differences for a bank of n controllers over all ticks */
+static PIDValue* bench_Errors(long n, long ticks)
+{
+	PIDValue* e = bench_Alloc((size_t)ticks*n, sizeof(PIDValue));
+	long k, i;
+
+	for (k = 0; k < ticks; k++)
+		for (i = 0; i < n; i++)
+			e[(size_t)k*n + i] = bench_Val(2.0*((i & 7) + 1)/8.0*(k % 50 < 25 ? 1 : -1) + bench_Rand(-2.0, 2.0));
+	return e;
+}
+
+/* Resets the controllers 0..n-1 */
+static void bench_Reset(long n)
+{
+	PIDInd i;
+	for (i = 0; i < n; i++)
+		pid_Reset(i);
+}
+
+/* Steps the controllers 0..n-1 for the given number of ticks with pid_Step */
+static double bench_Step(long n, long ticks, const PIDValue* e)
+{
+	long k;
+	PIDInd i;
+	PIDValue y = 0;
+	double checksum = 0;
+
+	for (k = 0; k < ticks; k++)
+	{
+		for (i = 0; i < n; i++)
+		{
+			pid_Step(i, e[(size_t)k*n + i], &y);
+			checksum += (double)y;
+		}
+	}
+	return checksum;
+}
+
+/* Steps the controllers 0..n-1 with pid_StepDt, the sample time jitters
+ * by +-20% around the one of the tuning */
+#define BENCH_DT_NUM 64
+static double bench_StepDt(long n, long ticks, const PIDValue* e)
+{
+	long k;
+	PIDInd i;
+	PIDValue y = 0, dt[BENCH_DT_NUM];
+	double checksum = 0;
+
+	for (k = 0; k < BENCH_DT_NUM; k++)
+	{
+#ifdef PID_FIXPOINT
+		dt[k] = (PIDValue)(4 + k % 3);
+#else
+		dt[k] = (PIDValue)bench_Rand(0.4, 0.6);
+#endif
+	}
+
+	for (k = 0; k < ticks; k++)
+	{
+		for (i = 0; i < n; i++)
+		{
+			pid_StepDt(i, e[(size_t)k*n + i], dt[k % BENCH_DT_NUM], &y);
+			checksum += (double)y;
+		}
+	}
+	return checksum;
+}
+
+#ifdef PID_FLIGHT_RECORDER
+/* Steps the controllers 0..n-1 with pid_Step while each of them records
+ * into its own flight recorder of 32 samples with all events enabled,
+ * the recorders are rearmed when they freeze. The user event is a rare
+ * control difference beyond +-3.9 (the data stays within +-4). */
+#define BENCH_REC_NUM 32
+static int bench_RecPred(const PIDRecSample* s, void* ctx)
+{
+	PIDValue lim = *(const PIDValue*)ctx;
+	return (s->e > lim) || (s->e < -lim);
+}
+
+static double bench_StepRec(long n, long ticks, const PIDValue* e)
+{
+	PIDRecorder* rec = bench_Alloc(n, sizeof(PIDRecorder));
+	PIDRecSample* buf = bench_Alloc((size_t)n*BENCH_REC_NUM, sizeof(PIDRecSample));
+	long k;
+	PIDInd i;
+	PIDValue y = 0, lim = bench_Val(3.9);
+	double checksum = 0;
+
+	for (i = 0; i < n; i++)
+	{
+		pid_RecInit(&rec[i], &buf[(size_t)i*BENCH_REC_NUM], BENCH_REC_NUM, BENCH_REC_NUM/2,
+					pidRec_SatMax | pidRec_SatMin | pidRec_Arw | pidRec_User, bench_RecPred, &lim);
+		pid_RecSet(i, &rec[i]);
+	}
+
+	for (k = 0; k < ticks; k++)
+	{
+		for (i = 0; i < n; i++)
+		{
+			pid_Step(i, e[(size_t)k*n + i], &y);
+			checksum += (double)y;
+			if (pid_RecFrozen(&rec[i])) pid_RecArm(&rec[i]);
+		}
+	}
+
+	for (i = 0; i < n; i++)
+		pid_RecSet(i, NULL);
+	free(buf);
+	free(rec);
+	return checksum;
+}
+#endif
+
+/* Steps each of the controllers 0..n-1 over a block of all ticks with
+ * pid_StepBlock. The error data is interpreted controller by controller. */
+static double bench_StepBlock(long n, long ticks, const PIDValue* e)
+{
+	PIDInd i;
+	long k;
+	PIDValue* y = bench_Alloc(ticks, sizeof(PIDValue));
+	double checksum = 0;
+
+	for (i = 0; i < n; i++)
+	{
+		pid_StepBlock(i, &e[(size_t)i*ticks], y, ticks);
+		for (k = 0; k < ticks; k++)
+			checksum += (double)y[k];
+	}
+	free(y);
+	return checksum;
+}
+
+/* Gain schedule with 8 operating points over the control difference,
+ * shared by all controllers */
+#define BENCH_SCHED_POINTS 8
+static PIDCoeffs   bench_table[BENCH_SCHED_POINTS];
+static PIDSchedule bench_sched;
+
+static void bench_SchedSetup(void)
+{
+	PIDInd i;
+	int k;
+
+	for (k = 0; k < BENCH_SCHED_POINTS; k++)
+	{
+#ifdef PID_FIXPOINT
+		pid_CoeffsCalc_K(bench_Val(0.5 + 0.2*k), bench_Val(0.01*k), bench_Val(10.0), 20, 5, &bench_table[k]);
+#else
+		pid_CoeffsCalc_K((PIDValue)(0.5 + 0.2*k), (PIDValue)(0.1*k), 1, 2, (PIDValue)0.5, &bench_table[k]);
+#endif
+	}
+	pid_ScheduleInit(&bench_sched, bench_table, BENCH_SCHED_POINTS, bench_Val(-4.0), bench_Val(4.0));
+	for (i = 0; i < PID_NUM_CONTROLLERS; i++)
+		pid_ScheduleSet(i, &bench_sched);
+}
+
+/* Steps the controllers 0..n-1 with pid_StepSched, the control difference
+ * is used as scheduling variable */
+static double bench_StepSched(long n, long ticks, const PIDValue* e)
+{
+	long k;
+	PIDInd i;
+	PIDValue y = 0;
+	double checksum = 0;
+
+	for (k = 0; k < ticks; k++)
+	{
+		for (i = 0; i < n; i++)
+		{
+			pid_StepSched(i, e[(size_t)k*n + i], e[(size_t)k*n + i], &y);
+			checksum += (double)y;
+		}
+	}
+	return checksum;
+}
+
+/* Steps the controllers 0..n-1 with pid_StepSchedBank */
+static double bench_StepSchedBank(long n, long ticks, const PIDValue* e)
+{
+	long k;
+	PIDInd i;
+	PIDValue* y = bench_Alloc(n, sizeof(PIDValue));
+	double checksum = 0;
+
+	for (k = 0; k < ticks; k++)
+	{
+		pid_StepSchedBank(0, (PIDInd)n, &e[(size_t)k*n], &e[(size_t)k*n], y);
+		for (i = 0; i < n; i++)
+			checksum += (double)y[i];
+	}
+	free(y);
+	return checksum;
+}
+
+/* Steps the controllers 0..n-1 with pid_StepBank */
+static double bench_StepBank(long n, long ticks, const PIDValue* e)
+{
+	long k;
+	PIDInd i;
+	PIDValue* y = bench_Alloc(n, sizeof(PIDValue));
+	double checksum = 0;
+
+	for (k = 0; k < ticks; k++)
+	{
+		pid_StepBank(0, (PIDInd)n, &e[(size_t)k*n], y);
+		for (i = 0; i < n; i++)
+			checksum += (double)y[i];
+	}
+	free(y);
+	return checksum;
+}
+
+/* Steps the controllers 0..n-1 with pid_StepBank and updates the
+ * statistics in the application, which reads the I-parts again */
+static double bench_StepBankReread(long n, long ticks, const PIDValue* e)
+{
+	long k;
+	PIDInd i;
+	PIDValue* y = bench_Alloc(n, sizeof(PIDValue));
+	PIDStats* S = bench_Alloc(n, sizeof(PIDStats));
+	PIDValue P, I, D;
+	PIDStatValue x, d;
+	double checksum = 0;
+
+	pid_StatsReset(S, (PIDInd)n);
+	for (k = 0; k < ticks; k++)
+	{
+		pid_StepBank(0, (PIDInd)n, &e[(size_t)k*n], y);
+		for (i = 0; i < n; i++)
+		{
+			pid_PartsGet(i, &P, &I, &D);
+			x = (PIDStatValue)e[(size_t)k*n + i];
+			S[i].Count++;
+			d = x - S[i].Mean;
+			S[i].Mean += d/(PIDStatValue)S[i].Count;
+			S[i].M2   += d*(x - S[i].Mean);
+			S[i].MeanSq += (PIDStatValue)0.01*(x*x - S[i].MeanSq);
+			S[i].Sat  += (y[i] == PID_VAL_MAX) | (y[i] == PID_VAL_MIN);
+			if ( I < S[i].IMin ) S[i].IMin = I;
+			if ( I > S[i].IMax ) S[i].IMax = I;
+			checksum += (double)y[i];
+		}
+	}
+	free(S);
+	free(y);
+	return checksum;
+}
+
+/* Steps the controllers 0..n-1 with pid_StepBankStats */
+static double bench_StepBankStats(long n, long ticks, const PIDValue* e)
+{
+	long k;
+	PIDInd i;
+	PIDValue* y = bench_Alloc(n, sizeof(PIDValue));
+	PIDStats* S = bench_Alloc(n, sizeof(PIDStats));
+	double checksum = 0;
+
+	pid_StatsReset(S, (PIDInd)n);
+	for (k = 0; k < ticks; k++)
+	{
+		pid_StepBankStats(0, (PIDInd)n, &e[(size_t)k*n], y, S, (PIDStatValue)0.01);
+		for (i = 0; i < n; i++)
+			checksum += (double)y[i];
+	}
+	free(S);
+	free(y);
+	return checksum;
+}
+
+/* Sensor and actuator structs of an application */
+typedef struct
+{
+	uint32_t Id;
+	float    e;
+	uint32_t Status;
+} BenchSensor;
+
+typedef struct
+{
+	float    y;
+	uint16_t Flags;
+} BenchDrive;
+
+/* Copies the control differences into sensor structs */
+static BenchSensor* bench_Sensors(long n, long ticks, const PIDValue* e)
+{
+	BenchSensor* s = bench_Alloc((size_t)ticks*n, sizeof(BenchSensor));
+	size_t i;
+
+	for (i = 0; i < (size_t)ticks*n; i++)
+	{
+		s[i].Id     = (uint32_t)i;
+		s[i].e      = (float)e[i];
+		s[i].Status = 0;
+	}
+	return s;
+}
+
+/* Steps the controllers 0..n-1 on sensor and actuator structs by copying
+ * the values to and from arrays for pid_StepBank */
+static double bench_StepCopy(long n, long ticks, const PIDValue* e)
+{
+	BenchSensor* s = bench_Sensors(n, ticks, e);
+	BenchDrive* d = bench_Alloc(n, sizeof(BenchDrive));
+	PIDValue* ei = bench_Alloc(n, sizeof(PIDValue));
+	PIDValue* y = bench_Alloc(n, sizeof(PIDValue));
+	long k;
+	PIDInd i;
+	double checksum = 0;
+
+	for (k = 0; k < ticks; k++)
+	{
+		for (i = 0; i < n; i++)
+			ei[i] = (PIDValue)s[(size_t)k*n + i].e;
+		pid_StepBank(0, (PIDInd)n, ei, y);
+		for (i = 0; i < n; i++)
+			d[i].y = (float)y[i];
+		for (i = 0; i < n; i++)
+			checksum += (double)d[i].y;
+	}
+	free(y);
+	free(ei);
+	free(d);
+	free(s);
+	return checksum;
+}
+
+/* Steps the controllers 0..n-1 directly on sensor and actuator structs */
+static double bench_StepStrided(long n, long ticks, const PIDValue* e)
+{
+	BenchSensor* s = bench_Sensors(n, ticks, e);
+	BenchDrive* d = bench_Alloc(n, sizeof(BenchDrive));
+	PIDStrided eIo = { NULL, sizeof(BenchSensor), pidIo_F32 };
+	PIDStrided yIo = { &d[0].y, sizeof(BenchDrive), pidIo_F32 };
+	long k;
+	PIDInd i;
+	double checksum = 0;
+
+	for (k = 0; k < ticks; k++)
+	{
+		eIo.Base = &s[(size_t)k*n].e;
+		pid_StepStrided(0, (PIDInd)n, &eIo, &yIo);
+		for (i = 0; i < n; i++)
+			checksum += (double)d[i].y;
+	}
+	free(d);
+	free(s);
+	return checksum;
+}
+
+/* Steps controller 0 over a long trace sequentially and in parallel */
+static void bench_Trace(long steps)
+{
+	PIDValue* e = bench_Errors(1, steps);
+	PIDValue* y = bench_Alloc(steps, sizeof(PIDValue));
+	unsigned rounds = 0;
+	double t0, t1;
+
+	pid_Reset(0);
+	bench_PerfStart();
+	t0 = bench_Now();
+	pid_StepBlock(0, e, y, steps);
+	t1 = bench_Now();
+	bench_PerfStop();
+	bench_PrintRow("StepBlock", 1, t1 - t0, (double)steps);
+
+	pid_Reset(0);
+	bench_PerfStart();
+	t0 = bench_Now();
+	pid_StepTrace(0, e, y, steps, 0, bench_Val(1e-3), &rounds);
+	t1 = bench_Now();
+	bench_PerfStop();
+	bench_PrintRow("StepTrace", 1, t1 - t0, (double)steps);
+	printf("StepTrace: %u parallel round(s)\n", rounds);
+
+	pid_Reset(0);
+	free(y);
+	free(e);
+}
+
+#ifdef BENCH_BANKS
+/* Steps all controllers of the bank in a random order, so that nearly
+ * every step touches another page */
+static void bench_Banks(long steps)
+{
+	static const struct
+	{
+		const char*  name;
+		int          pages;
+	} types[] =
+	{
+		{ "Rnd/static", -1 },
+		{ "Rnd/4K",     pidBank_Pages4K },
+		{ "Rnd/THP",    pidBank_PagesTHP },
+		{ "Rnd/2M",     pidBank_Pages2M },
+		{ "Rnd/1G",     pidBank_Pages1G }
+	};
+	long n = PID_NUM_CONTROLLERS, ticks = (steps + n - 1)/n, k, i, j;
+	PIDInd* perm = bench_Alloc(n, sizeof(PIDInd));
+	PIDValue* e = bench_Errors(n, ticks);
+	PIDValue y;
+	PIDBank bank;
+	double t0, t1;
+	unsigned t;
+
+	for (i = 0; i < n; i++)
+		perm[i] = (PIDInd)i;
+	for (i = n - 1; i > 0; i--)
+	{
+		j = (long)bench_Rand(0, (double)i + 1);
+		k = perm[i]; perm[i] = perm[j]; perm[j] = (PIDInd)k;
+	}
+
+	for (t = 0; t < sizeof(types)/sizeof(types[0]); t++)
+	{
+		bank.Mem = NULL;
+		if (types[t].pages >= 0)
+		{
+			/* Skip the page types which are not available */
+			if (pid_BankAlloc(&bank, (PIDBankPages)types[t].pages, -1) != pidErr_Ok)
+				continue;
+			if (bank.Pages != (PIDBankPages)types[t].pages)
+			{
+				printf("%s: not available\n", types[t].name);
+				pid_BankFree(&bank);
+				continue;
+			}
+		}
+		pid_BankSet(bank.Mem);
+		bench_seed = BENCH_SEED;
+		bench_Setup();
+
+		/* Warm up */
+		for (i = 0; i < n; i++)
+			pid_Step(perm[i], e[i], &y);
+
+		bench_PerfStart();
+		t0 = bench_Now();
+		for (k = 0; k < ticks; k++)
+			for (i = 0; i < n; i++)
+				pid_Step(perm[i], e[(size_t)k*n + i], &y);
+		t1 = bench_Now();
+		bench_PerfStop();
+		bench_PrintRow(types[t].name, n, t1 - t0, (double)ticks*n);
+
+		pid_BankSet(NULL);
+		pid_BankFree(&bank);
+	}
+
+	free(e);
+	free(perm);
+}
+
+/* Times the startup of a freshly allocated bank: pid_Init and the
+ * configuration of all controllers. With PID_LAZY_INIT pid_Init does not
+ * touch the pages, they are faulted in by the configuration instead */
+static void bench_Startup(void)
+{
+	long n = PID_NUM_CONTROLLERS, i;
+	PIDBank bank;
+	double t0, t1, t2;
+
+	if (pid_BankAlloc(&bank, pidBank_Pages4K, -1) != pidErr_Ok)
+		return;
+	pid_BankSet(bank.Mem);
+
+	t0 = bench_Now();
+	pid_Init();
+	t1 = bench_Now();
+	for (i = 0; i < n; i++)
+		pid_ParaSet_K((PIDInd)i, bench_Val(1.0), bench_Val(0.1), 0, 0, 5);
+	t2 = bench_Now();
+#ifdef PID_LAZY_INIT
+	printf("startup (lazy) of %ld controllers: pid_Init %.3f ms, configuration %.3f ms\n", n, (t1 - t0)*1e-6, (t2 - t1)*1e-6);
+#else
+	printf("startup of %ld controllers: pid_Init %.3f ms, configuration %.3f ms\n", n, (t1 - t0)*1e-6, (t2 - t1)*1e-6);
+#endif
+
+	pid_BankSet(NULL);
+	pid_BankFree(&bank);
+}
+#endif
+
+#ifndef PID_FIXPOINT
+/* Steps all controllers with pid_StepBank and copies of them in the
+ * compact banks in half precision. Prints the time per step, the bytes
+ * per controller, and the deviation of the outputs from pid_StepBank. */
+static void bench_Half(long steps)
+{
+	static const char* names[] = { "Half/F16", "Half/BF16" };
+	long n = PID_NUM_CONTROLLERS, ticks = (steps + n - 1)/n, k, i;
+	PIDValue* e = bench_Errors(n, ticks);
+	PIDValue* y = bench_Alloc(n, sizeof(PIDValue));
+	PIDValue* yRef = bench_Alloc((size_t)ticks*n, sizeof(PIDValue));
+	PIDHalfBank half;
+	PIDCoeffs C;
+	PIDValue yMin, yMax;
+	PIDArw arw;
+	void* mem = NULL;
+	double t0, t1, d, err, sq, ref;
+	int f;
+
+	bench_Reset(n);
+	bench_PerfStart();
+	t0 = bench_Now();
+	for (k = 0; k < ticks; k++)
+		pid_StepBank(0, (PIDInd)n, &e[(size_t)k*n], &yRef[(size_t)k*n]);
+	t1 = bench_Now();
+	bench_PerfStop();
+	bench_PrintRow("Half/ref", n, t1 - t0, (double)ticks*n);
+	bench_Reset(n);
+
+	for (f = pidHalf_F16; f <= pidHalf_BF16; f++)
+	{
+		if (posix_memalign(&mem, 64, pid_HalfSize(n)) != 0) break;
+		pid_HalfInit(&half, mem, n, (PIDHalfFormat)f);
+		for (i = 0; i < n; i++)
+		{
+			pid_CoeffsGet((PIDInd)i, &C);
+			pid_LimitsGet((PIDInd)i, &yMin, &yMax);
+			pid_ArwGet((PIDInd)i, &arw);
+			pid_HalfSet(&half, i, &C, yMin, yMax, arw);
+		}
+
+		bench_PerfStart();
+		t0 = bench_Now();
+		for (k = 0; k < ticks; k++)
+			pid_HalfStep(&half, 0, n, &e[(size_t)k*n], y);
+		t1 = bench_Now();
+		bench_PerfStop();
+		bench_PrintRow(names[f], n, t1 - t0, (double)ticks*n);
+
+		/* Deviation from the reference, relative to its RMS value */
+		pid_HalfReset(&half, 0, n);
+		err = sq = ref = 0;
+		for (k = 0; k < ticks; k++)
+		{
+			pid_HalfStep(&half, 0, n, &e[(size_t)k*n], y);
+			for (i = 0; i < n; i++)
+			{
+				d = (double)y[i] - yRef[(size_t)k*n + i];
+				if (fabs(d) > err) err = fabs(d);
+				sq  += d*d;
+				ref += (double)yRef[(size_t)k*n + i]*yRef[(size_t)k*n + i];
+			}
+		}
+		printf("%s: %s kernel, %.1f bytes per controller (pid_Step: %.1f), "
+			   "max. deviation %.3e, RMS deviation %.3e (relative to RMS output)\n",
+			   names[f], pid_HalfKernel(&half), (double)pid_HalfSize(n)/n, (double)pid_BankSize()/PID_NUM_CONTROLLERS,
+			   err/sqrt(ref/((double)ticks*n)), sqrt(sq/ref));
+		free(mem);
+	}
+
+	free(yRef);
+	free(y);
+	free(e);
+}
+#endif
+
+#ifndef PID_FIXPOINT
+/* Integrates a small noisy control difference with a short sample time
+ * by controller 0 over 16 times the given number of steps. The I-part is
+ * compared with the sum of the same increments in double precision. */
+static void bench_Drift(long steps)
+{
+	long k, n = 16*steps;
+	PIDCoeffs C;
+	PIDValue e, e1 = 0, y, P, I, D;
+	double Iref = 0, t0, t1, dev = 0;
+
+	pid_ParaSet_K(0, (PIDValue)1.0, (PIDValue)0.1, 0, 0, (PIDValue)0.001);
+	pid_LimitsSet(0, PID_VAL_MIN, PID_VAL_MAX);
+	pid_ArwSet(0, pidArw_Off);
+	pid_CoeffsGet(0, &C);
+	pid_Reset(0);
+	bench_seed = BENCH_SEED;
+
+	t0 = bench_Now();
+	for (k = 0; k < n; k++)
+	{
+		e = (PIDValue)(0.01 + bench_Rand(-1.0, 1.0));
+		pid_Step(0, e, &y);
+#if (defined PID_INTALGO_RECT)
+		Iref += (double)C.Ci*e1;
+#else
+		Iref += (double)C.Ci*((double)e + e1);
+#endif
+		e1 = e;
+		if ((k & 0xffff) == 0xffff)
+		{
+			pid_PartsGet(0, &P, &I, &D);
+			if (fabs((double)I - Iref) > dev) dev = fabs((double)I - Iref);
+		}
+	}
+	t1 = bench_Now();
+	pid_PartsGet(0, &P, &I, &D);
+	printf("I-part drift (%s) after %ld steps: I = %.9g, double sum = %.9g, "
+		   "deviation %.3e (max. %.3e), %.2f ns/step incl. random numbers\n",
+		   BENCH_ARITH, n, (double)I, Iref, fabs((double)I - Iref), dev, (t1 - t0)/n);
+	bench_Setup();
+}
+#endif
+
+/* Write function of the binary log which only counts the bytes */
+static int bench_LogCount(void* ctx, const void* data, size_t len)
+{
+	(void)data;
+	*(size_t*)ctx += len;
+	return 0;
+}
+
+/* Steps all controllers and encodes their outputs into the binary log,
+ * only the encoding is measured */
+static void bench_Log(long steps)
+{
+	long n = PID_NUM_CONTROLLERS, ticks = (steps + n - 1)/n, k, i;
+	PIDValue* e = bench_Errors(n, ticks);
+	PIDValue* y = bench_Alloc(n, sizeof(PIDValue));
+	void* mem = bench_Alloc(pid_LogMemSize((uint32_t)n, 65536), 1);
+	PIDLogEncoder log;
+	size_t bytes = 0, text = 0;
+	double t = 0, t0;
+	char line[64];
+
+	bench_Reset(n);
+	pid_LogOpen(&log, mem, (uint32_t)n, 65536, 1e6, 0.5, bench_LogCount, &bytes);
+	for (k = 0; k < ticks; k++)
+	{
+		pid_StepBank(0, (PIDInd)n, &e[(size_t)k*n], y);
+		bench_PerfStart();
+		t0 = bench_Now();
+		pid_LogTick(&log, y);
+		t += bench_Now() - t0;
+		bench_PerfStop();
+		for (i = 0; i < n; i++)
+#ifdef PID_FIXPOINT
+			text += snprintf(line, sizeof(line), "%.8f\t", (double)y[i]/PID_FIXPOINT_FACTOR);
+#else
+			text += snprintf(line, sizeof(line), "%.8f\t", (double)y[i]);
+#endif
+	}
+	pid_LogFlush(&log);
+	bench_PrintRow("LogTick", n, t, (double)ticks*n);
+	printf("binary log: %.2f bytes per value (text: %.2f)\n", (double)bytes/((double)ticks*n), (double)text/((double)ticks*n));
+	bench_Reset(n);
+
+	free(mem);
+	free(y);
+	free(e);
+}
+
+/* Resets the whole bank by single calls of pid_Reset and by the bulk
+ * operation on groups: the range of all controllers, a dense bitset
+ * (7 of 8 controllers) and a sparse one (1 of 8). The time is given per
+ * reset controller */
+static void bench_Groups(long steps)
+{
+	long n = PID_NUM_CONTROLLERS, reps = (steps + n - 1)/n, k, i, m;
+	size_t words = (n + 63)/64;
+	uint64_t* dense = bench_Alloc(words, sizeof(uint64_t));
+	uint64_t* sparse = bench_Alloc(words, sizeof(uint64_t));
+	PIDGroup g;
+	double t0, t1;
+
+	for (i = 0; i < n; i++)
+	{
+		if (bench_Rand(0.0, 1.0) < 7.0/8) dense[i/64] |= (uint64_t)1 << (i%64);
+		if (bench_Rand(0.0, 1.0) < 1.0/8) sparse[i/64] |= (uint64_t)1 << (i%64);
+	}
+
+	bench_PerfStart();
+	t0 = bench_Now();
+	for (k = 0; k < reps; k++)
+		for (i = 0; i < n; i++)
+			pid_Reset((PIDInd)i);
+	t1 = bench_Now();
+	bench_PerfStop();
+	bench_PrintRow("Reset", n, t1 - t0, (double)reps*n);
+
+	pid_GroupInit(&g, "all", 0, (PIDInd)n, NULL);
+	bench_PerfStart();
+	t0 = bench_Now();
+	for (k = 0; k < reps; k++)
+		pid_GroupReset(&g);
+	t1 = bench_Now();
+	bench_PerfStop();
+	bench_PrintRow("Reset/range", n, t1 - t0, (double)reps*n);
+
+	pid_GroupInit(&g, "dense", 0, (PIDInd)n, dense);
+	m = (long)pid_GroupSize(&g);
+	bench_PerfStart();
+	t0 = bench_Now();
+	for (k = 0; k < reps; k++)
+		pid_GroupReset(&g);
+	t1 = bench_Now();
+	bench_PerfStop();
+	bench_PrintRow("Reset/dense", m, t1 - t0, (double)reps*m);
+
+	pid_GroupInit(&g, "sparse", 0, (PIDInd)n, sparse);
+	m = (long)pid_GroupSize(&g);
+	bench_PerfStart();
+	t0 = bench_Now();
+	for (k = 0; k < reps; k++)
+		pid_GroupReset(&g);
+	t1 = bench_Now();
+	bench_PerfStop();
+	bench_PrintRow("Reset/sparse", m, t1 - t0, (double)reps*m);
+
+	free(sparse);
+	free(dense);
+}
+
+/* Steps the whole bank by pid_StepBankExport and collects the changed
+ * outputs after each tick, for several deadbands. The time is given per
+ * controller step incl. the collection, the share of the exported 
+ * values is printed below */
+static void bench_Export(long steps)
+{
+	static const double bands[] = { 0.0, 0.1, 1.0 };
+	long n = PID_NUM_CONTROLLERS, ticks = (steps + n - 1)/n, k;
+	PIDValue* e = bench_Errors(n, ticks);
+	PIDValue* y = bench_Alloc(n, sizeof(PIDValue));
+	PIDExportEntry* out = bench_Alloc(n, sizeof(PIDExportEntry));
+	void* mem = bench_Alloc(pid_ExportMemSize((PIDInd)n), 1);
+	PIDExport x;
+	double t0, t1, sent;
+	char row[32];
+	unsigned b;
+
+	for (b = 0; b < sizeof(bands)/sizeof(bands[0]); b++)
+	{
+		pid_ExportInit(&x, mem, 0, (PIDInd)n, pidExp_Y, bench_Val(bands[b]));
+		bench_Reset(n);
+		sent = 0;
+		bench_PerfStart();
+		t0 = bench_Now();
+		for (k = 0; k < ticks; k++)
+		{
+			pid_StepBankExport(0, (PIDInd)n, &e[(size_t)k*n], y, &x);
+			sent += (double)pid_ExportCollect(&x, out, (size_t)n);
+		}
+		t1 = bench_Now();
+		bench_PerfStop();
+		snprintf(row, sizeof(row), "Export/%g", bands[b]);
+		bench_PrintRow(row, n, t1 - t0, (double)ticks*n);
+		printf("Export/%g: %.1f%% of the outputs exported\n", bands[b], 100*sent/((double)ticks*n));
+	}
+	bench_Reset(n);
+
+	free(mem);
+	free(out);
+	free(y);
+	free(e);
+}
+
+/* Steps the whole bank at full rate by pid_StepBank and event-triggered
+ * by pid_StepBankEvent. The control difference of each controller jumps
+ * every 32 ticks and decays into noise below the threshold. Prints the 
+ * skip rate, the saved time and the maximum deviation of the outputs
+ * from the full-rate run */
+static void bench_Event(long steps)
+{
+	long n = PID_NUM_CONTROLLERS, ticks = (steps + n - 1)/n, k, i;
+	PIDValue* e = bench_Alloc((size_t)ticks*n, sizeof(PIDValue));
+	PIDValue* yFull = bench_Alloc((size_t)ticks*n, sizeof(PIDValue));
+	PIDValue* y = bench_Alloc(n, sizeof(PIDValue));
+	void* mem = bench_Alloc(pid_EventMemSize((PIDInd)n), 1);
+	PIDEvent v;
+	PIDEventStats st;
+	double t0, t1, tFull, tEvent, dev = 0, yMax = 0, d;
+
+	for (k = 0; k < ticks; k++)
+		for (i = 0; i < n; i++)
+			e[(size_t)k*n + i] = bench_Val((((k + i)/32) % 2 ? 1.0 : -1.0)*exp(-0.5*((k + i) % 32)) + bench_Rand(-0.02, 0.02));
+
+	bench_Reset(n);
+	bench_PerfStart();
+	t0 = bench_Now();
+	for (k = 0; k < ticks; k++)
+		pid_StepBank(0, (PIDInd)n, &e[(size_t)k*n], &yFull[(size_t)k*n]);
+	t1 = bench_Now();
+	bench_PerfStop();
+	tFull = t1 - t0;
+	bench_PrintRow("Event/full", n, tFull, (double)ticks*n);
+
+	bench_Reset(n);
+	pid_EventInit(&v, mem, 0, (PIDInd)n, bench_Val(0.05), 64);
+	bench_PerfStart();
+	t0 = bench_Now();
+	for (k = 0; k < ticks; k++)
+		pid_StepBankEvent(0, (PIDInd)n, &e[(size_t)k*n], y, &v);
+	t1 = bench_Now();
+	bench_PerfStop();
+	tEvent = t1 - t0;
+	bench_PrintRow("Event/0.05", n, tEvent, (double)ticks*n);
+	pid_EventStatsRead(&v, &st);
+
+	/* Second run for the deviation */
+	bench_Reset(n);
+	for (i = 0; i < n; i++)
+		y[i] = 0;
+	pid_EventInit(&v, mem, 0, (PIDInd)n, bench_Val(0.05), 64);
+	for (k = 0; k < ticks; k++)
+	{
+		pid_StepBankEvent(0, (PIDInd)n, &e[(size_t)k*n], y, &v);
+		for (i = 0; i < n; i++)
+		{
+			d = fabs((double)y[i] - (double)yFull[(size_t)k*n + i]);
+			if (d > dev) dev = d;
+			if (fabs((double)yFull[(size_t)k*n + i]) > yMax) yMax = fabs((double)yFull[(size_t)k*n + i]);
+		}
+	}
+	printf("Event/0.05: %.1f%% of the steps skipped (%.1f%% forced), %.1f%% of the time saved, max. deviation %.3g (%.2g of the max. output)\n",
+		   100*st.SkipFrac, 100*(double)st.Forced/(double)(st.Steps + st.Skips), 100*(1 - tEvent/tFull), dev, dev/(yMax > 0 ? yMax : 1));
+	bench_Reset(n);
+
+	free(mem);
+	free(y);
+	free(yFull);
+	free(e);
+}
+
+#ifdef PID_OUTPUT_STAGE
+/* Steps the whole bank and converts the outputs to the codes of a 12 bit
+ * DAC with a slew limit and a deadband, once by pid_StepBank followed by
+ * a second pass of the application, once by pid_StepBankOut */
+static void bench_OutStage(long steps)
+{
+	long n = PID_NUM_CONTROLLERS, ticks = (steps + n - 1)/n, k, i;
+	PIDValue* e = bench_Errors(n, ticks);
+	PIDValue* y = bench_Alloc(n, sizeof(PIDValue));
+	PIDValue* yPrev = bench_Alloc(n, sizeof(PIDValue));
+	int32_t* u = bench_Alloc(n, sizeof(int32_t));
+	PIDOutStage st;
+	double t0, t1, d, x;
+
+	st.Slew	  = bench_Val(1.0);
+	st.Band	  = bench_Val(0.05);
+	st.Gain	  = 2047.0/(double)bench_Val(8.0);
+	st.Offset = 2048;
+	st.uMin	  = 0;
+	st.uMax	  = 4095;
+
+	bench_Reset(n);
+	bench_PerfStart();
+	t0 = bench_Now();
+	for (k = 0; k < ticks; k++)
+	{
+		pid_StepBank(0, (PIDInd)n, &e[(size_t)k*n], y);
+		for (i = 0; i < n; i++)
+		{
+			d = (double)y[i] - (double)yPrev[i];
+			if (d > (double)st.Slew)		 y[i] = yPrev[i] + st.Slew;
+			else if (d < -(double)st.Slew)	 y[i] = yPrev[i] - st.Slew;
+			yPrev[i] = y[i];
+			x = (y[i] <= st.Band && y[i] >= -st.Band) ? st.Offset : st.Gain*(double)y[i] + st.Offset;
+			x = (x < st.uMin) ? st.uMin : ((x > st.uMax) ? st.uMax : x);
+			u[i] = (int32_t)(x + 0.5);
+		}
+	}
+	t1 = bench_Now();
+	bench_PerfStop();
+	bench_PrintRow("Out/2pass", n, t1 - t0, (double)ticks*n);
+
+	for (i = 0; i < n; i++)
+		pid_OutStageSet((PIDInd)i, &st);
+	bench_Reset(n);
+	bench_PerfStart();
+	t0 = bench_Now();
+	for (k = 0; k < ticks; k++)
+		pid_StepBankOut(0, (PIDInd)n, &e[(size_t)k*n], NULL, u);
+	t1 = bench_Now();
+	bench_PerfStop();
+	bench_PrintRow("Out/fused", n, t1 - t0, (double)ticks*n);
+	for (i = 0; i < n; i++)
+		pid_OutStageSet((PIDInd)i, NULL);
+	bench_Reset(n);
+
+	free(u);
+	free(yPrev);
+	free(y);
+	free(e);
+}
+#endif
+
+/* Steps the whole bank from 12 bit ADC counts with calibration, 
+ * prefilter and setpoint, once by a conversion pass of the application
+ * followed by pid_StepBank, once by pid_StepBankRaw. The conversion
+ * pass knows the raw type and is vectorized as a whole, it stays ahead
+ * of pid_StepBankRaw by a few percent */
+static void bench_Input(long steps)
+{
+	long n = PID_NUM_CONTROLLERS, ticks = (steps + n - 1)/n, k, i;
+	uint16_t* raw = bench_Alloc((size_t)ticks*n, sizeof(uint16_t));
+	PIDValue* e = bench_Alloc(n, sizeof(PIDValue));
+	PIDValue* y = bench_Alloc(n, sizeof(PIDValue));
+	double* cal = bench_Alloc(5*n, sizeof(double));
+	double *gain = cal, *offset = cal + n, *alpha = cal + 2*n, *w = cal + 3*n, *xf = cal + 4*n;
+	void* mem = bench_Alloc(pid_InputMemSize((PIDInd)n), 1);
+	PIDStrided r;
+	PIDInput v;
+	double t0, t1, x;
+
+	for (k = 0; k < ticks; k++)
+		for (i = 0; i < n; i++)
+			raw[(size_t)k*n + i] = (uint16_t)bench_Rand(0.0, 4095.0);
+	for (i = 0; i < n; i++)
+	{
+		gain[i]	  = bench_Rand(9.9, 10.1)/4096;
+		offset[i] = bench_Rand(-5.1, -4.9);
+		alpha[i]  = 0.5;
+		w[i]	  = 0.5;
+		xf[i]	  = w[i];
+	}
+
+	bench_Reset(n);
+	bench_PerfStart();
+	t0 = bench_Now();
+	for (k = 0; k < ticks; k++)
+	{
+		for (i = 0; i < n; i++)
+		{
+			x = gain[i]*raw[(size_t)k*n + i] + offset[i];
+			xf[i] = alpha[i]*x + (1 - alpha[i])*xf[i];
+#ifdef PID_FIXPOINT
+			e[i] = (PIDValue)((w[i] - xf[i])*PID_FIXPOINT_FACTOR);
+#else
+			e[i] = (PIDValue)(w[i] - xf[i]);
+#endif
+		}
+		pid_StepBank(0, (PIDInd)n, e, y);
+	}
+	t1 = bench_Now();
+	bench_PerfStop();
+	bench_PrintRow("In/2pass", n, t1 - t0, (double)ticks*n);
+
+	pid_InputInit(&v, mem, 0, (PIDInd)n);
+	for (i = 0; i < n; i++)
+		pid_InputSet(&v, (PIDInd)i, gain[i], offset[i], alpha[i], w[i]);
+	bench_Reset(n);
+	bench_PerfStart();
+	t0 = bench_Now();
+	for (k = 0; k < ticks; k++)
+	{
+		r.Base	 = &raw[(size_t)k*n];
+		r.Stride = sizeof(uint16_t);
+		r.Type	 = pidIo_U16;
+		pid_StepBankRaw(0, (PIDInd)n, &r, NULL, &v, y);
+	}
+	t1 = bench_Now();
+	bench_PerfStop();
+	bench_PrintRow("In/fused", n, t1 - t0, (double)ticks*n);
+	bench_Reset(n);
+
+	free(mem);
+	free(cal);
+	free(y);
+	free(e);
+	free(raw);
+}
+
+/* Control differences of the cyclic executor */
+static void bench_ExecSense(void* Ctx, uint64_t Tick, PIDInd first, PIDInd n, PIDValue e[])
+{
+	(void)Tick;
+	memcpy(e, (const PIDValue*)Ctx + first, n*sizeof(PIDValue));
+}
+
+/* 4096 controllers (a fraction of the period) are stepped every
+ * millisecond by a loop sleeping 1 ms after each step and by the cyclic
+ * executor, which sleeps until the absolute release times. The loop
+ * falls behind by the step time and the wake-up latency of every cycle. */
+static void bench_Exec(void)
+{
+	const long cycles = 1000;
+	long n = (PID_NUM_CONTROLLERS < 4096) ? PID_NUM_CONTROLLERS : 4096, k;
+	PIDValue* e = bench_Errors(n, 1);
+	PIDValue* y = bench_Alloc(n, sizeof(PIDValue));
+	void* mem = bench_Alloc(pid_ExecMemSize((PIDInd)n), 1);
+	struct timespec ms = { 0, 1000000 };
+	PIDValue TSample;
+	PIDExecClock Clock;
+	PIDExecStats St;
+	PIDExec X;
+	double t0, t1;
+
+	/* Same sample time for all controllers again */
+	bench_Setup();
+	t0 = bench_Now();
+	for (k = 0; k < cycles; k++) {
+		pid_StepBank(0, (PIDInd)n, e, y);
+		nanosleep(&ms, NULL);
+	}
+	t1 = bench_Now();
+
+	pid_ParaGet_K(0, NULL, NULL, NULL, NULL, &TSample);
+	pid_ExecClockReal(&Clock);
+	if (pid_ExecInit(&X, mem, 0, (PIDInd)n, 1e-3/(double)TSample, &Clock) != pidErr_Ok) {
+		printf("Exec: not available\n");
+	} else {
+		pid_ExecIoSet(&X, bench_ExecSense, NULL, e);
+		pid_ExecRun(&X, cycles);
+		pid_ExecStatsRead(&X, &St);
+		printf("Exec/1ms: %ld controllers, sleep loop %.3f ms behind after %ld cycles, executor: "
+			   "latency mean %.1f us max %.1f us, step %.1f us, %lu of %lu cycles missed\n",
+			   n, (t1 - t0)*1e-6 - cycles, cycles, 1e-3*St.LatencySum/St.Cycles, 1e-3*St.LatencyMax,
+			   1e-3*St.ExecSum/St.Cycles, (unsigned long)St.Misses, (unsigned long)St.Cycles);
+	}
+	bench_Reset(n);
+	free(mem);
+	free(y);
+	free(e);
+}
+
+/* The functions measured for each bank size */
+typedef double (*BenchFunc)(long n, long ticks, const PIDValue* e);
+
+static const struct
+{
+	const char* name;
+	BenchFunc   func;
+} bench_funcs[] =
+{
+	{ "pid_Step",       bench_Step },
+	{ "StepDt",         bench_StepDt },
+#ifdef PID_FLIGHT_RECORDER
+	{ "StepRec",        bench_StepRec },
+#endif
+	{ "StepBlock",      bench_StepBlock },
+	{ "StepSched",      bench_StepSched },
+	{ "StepSchedBank",  bench_StepSchedBank },
+	{ "StepBank",       bench_StepBank },
+	{ "StepBankReread", bench_StepBankReread },
+	{ "StepBankStats",  bench_StepBankStats },
+	{ "StepCopy",       bench_StepCopy },
+	{ "StepStrided",    bench_StepStrided }
+};
+#define BENCH_NUM_FUNCS (int)(sizeof(bench_funcs)/sizeof(bench_funcs[0]))
+
+int main(int argc, char* argv[])
+{
+	long steps = BENCH_STEPS;
+	long n, ticks;
+	int f;
+	PIDValue* e;
+	double t0, t1;
+	double checksum = 0, sum;
+
+	if (argc > 1)
+		steps = strtol(argv[1], NULL, 10);
+	if (steps <= 0) {
+		puts("Usage ./pidbench [steps]");
+		return 1;
+	}
+
+	bench_Setup();
+	bench_SchedSetup();
+	bench_PerfOpen();
+	bench_PrintHeader();
+
+	for (n = BENCH_MIN_BANK; ; n *= 16)
+	{
+		if (n > PID_NUM_CONTROLLERS) n = PID_NUM_CONTROLLERS;
+		ticks = (steps + n - 1)/n;
+		e = bench_Errors(n, ticks);
+
+		for (f = 0; f < BENCH_NUM_FUNCS; f++)
+		{
+			/* Warm up the caches and the branch predictor */
+			bench_funcs[f].func(n, ticks < 4 ? ticks : 4, e);
+			bench_Reset(n);
+
+			bench_PerfStart();
+			t0 = bench_Now();
+			sum = bench_funcs[f].func(n, ticks, e);
+			t1 = bench_Now();
+			bench_PerfStop();
+			bench_PrintRow(bench_funcs[f].name, n, t1 - t0, (double)ticks*n);
+			bench_Reset(n);
+			if (f == 0) checksum = sum;
+		}
+
+		free(e);
+		if (n == PID_NUM_CONTROLLERS) break;
+	}
+
+	bench_Trace(steps);
+	bench_Log(steps);
+	bench_Groups(steps);
+	bench_Export(steps);
+	bench_Event(steps);
+	bench_Input(steps);
+	bench_Exec();
+#ifdef PID_OUTPUT_STAGE
+	bench_OutStage(steps);
+#endif
+#ifndef PID_FIXPOINT
+	bench_Half(steps);
+	bench_Drift(steps);
+#endif
+
+	/* The checksum of the largest bank allows to compare the results of 
+	 * different builds */
+	printf("checksum: %.17g\n", checksum);
+
+#ifdef PID_FIXPOINT_OVERFLOW_FLAG
+	{
+		unsigned char ovf;
+		PIDInd i;
+		int cnt = 0;
+		for (i = 0; i < PID_NUM_CONTROLLERS; i++)
+		{
+			pid_OverflowGet(i, &ovf);
+			cnt += ovf;
+		}
+		printf("controllers with saturated intermediate results: %d\n", cnt);
+	}
+#endif
+
+#ifdef BENCH_BANKS
+	bench_Banks(steps);
+	bench_Startup();
+#endif
+
+	return 0;
+}
@@ -47,8 +47,12 @@
    Define the number of controllers you want to use.
    In the functions of this library the first controller is accessed
    by 0, the second by 1, the third by 2, ...
+   More than 255 controllers are possible; the index type PIDInd is
+   widened automatically in that case.
 */
+#ifndef PID_NUM_CONTROLLERS
 #define PID_NUM_CONTROLLERS 3
+#endif
 
 
 /* PID_INTALGO_XYZ:
@@ -58,7 +62,9 @@
    PID_INTALGO_RECT		-> Rectangular approximation
    PID_INTALGO_TRAPZ	-> Trapezoidal approximation
 */
+#if !(defined PID_INTALGO_RECT) && !(defined PID_INTALGO_TRAPZ)
 #define PID_INTALGO_TRAPZ
+#endif
 
 
 
@@ -77,8 +83,15 @@
    arithmetic you also have to define the number of positions after the 
    decimal point which are considered in the integer number. This is done
    by setting the macro PID_INTEGER_PRECISION
+
+   The value type may also be passed on the command line of the compiler
+   (e.g. -D PID_VAL_FORMAT_I32), the default below is used otherwise.
 */
+#if !(defined PID_VAL_FORMAT_I8)  && !(defined PID_VAL_FORMAT_I16) && \
+    !(defined PID_VAL_FORMAT_I32) && !(defined PID_VAL_FORMAT_I64) && \
+    !(defined PID_VAL_FORMAT_F32) && !(defined PID_VAL_FORMAT_F64)
 #define PID_VAL_FORMAT_F32
+#endif
 
 
 /* PID_INTEGER_PRECISION:
@@ -125,7 +138,9 @@
    Then you mulitpliy all K values with PID_FIXPOINT_FACTOR and pass
    them. 
 */
+#ifndef PID_INTEGER_PRECISION
 #define PID_INTEGER_PRECISION 4
+#endif
 
 
 /* PID_INDEX_BOUND_CHECK:
@@ -136,6 +151,89 @@
 #define PID_INDEX_BOUND_CHECK
 
 
+/* PID_FIXPOINT_SATURATE:
+   Only used with fixpoint arithmetic. Define this to compute all products
+   of pid_Step in an integer type of double width (8->16, 16->32, 32->64,
+   64->128bit) and to saturate every intermediate result at the limits of
+   the value type instead of letting it wrap around. This allows to use
+   narrow value types without risking sign flips of the controller output.
+   128bit products require a compiler providing __int128 (gcc, clang).
+*/
+/* #define PID_FIXPOINT_SATURATE */
+
+
+/* PID_FIXPOINT_OVERFLOW_FLAG:
+   Only used together with PID_FIXPOINT_SATURATE. Define this to record
+   for each controller whether a saturation took place. The flag can be
+   read with pid_OverflowGet.
+*/
+/* #define PID_FIXPOINT_OVERFLOW_FLAG */
+
+
+/* PID_STEP_BRANCHFREE:
+   Define this to use a calculation step without data dependent jumps.
+   The unfiltered D-part is computed as a filtered one with a vanishing
+   filter coefficient, the limits and the anti-windup are applied by 
+   selects. This avoids mispredicted branches when many controllers with
+   different tunings are stepped with noisy inputs. The results are
+   identical to the ones of the default calculation step.
+*/
+/* #define PID_STEP_BRANCHFREE */
+
+
+/* PID_INTEGRATOR_COMPENSATED:
+   Define this to accumulate the I-part with a compensated summation
+   (TwoSum) for floating point values. The rounding errors of the 
+   additions are collected in a second value of the controller and fed
+   back, hence the I-part of a PID_VAL_FORMAT_F32 controller does not
+   drift away from the exact sum over long runs. The step gets slower by
+   a few additions. Has no effect with fixpoint arithmetic, whose 
+   additions are exact. Do not compile with -ffast-math, which removes
+   the compensation.
+*/
+/* #define PID_INTEGRATOR_COMPENSATED */
+
+
+/* PID_LAZY_INIT:
+   Define this to make all-zero memory the initial state of a controller
+   (no limits, sample time 1, see pid_Init). pid_Init then returns without
+   writing the controllers, which saves the startup time of large banks
+   and leaves the pages of a bank from pid_BankAlloc untouched until a
+   controller is used. The calculation step tests a flag set by 
+   pid_LimitsSet before it applies the limits.
+*/
+/* #define PID_LAZY_INIT */
+
+
+/* PID_OUTPUT_STAGE:
+   Define this to attach an output stage to the controllers (slew-rate
+   limit, deadband, scaling and quantization to actuator codes, see
+   pid_OutStageSet), which pid_StepBankOut applies in the same pass as 
+   the calculation step. Adds a pointer to each controller.
+*/
+/* #define PID_OUTPUT_STAGE */
+
+
+/* PID_FLIGHT_RECORDER:
+   Define this to enable the flight recorder. A recorder attached to a
+   controller by pid_RecSet keeps the last samples (e, P, I, D, y) of
+   each step in a circular buffer and freezes on events like the
+   saturation of the output (see pid_RecInit). Without this macro the
+   calculation step contains no code for recording.
+*/
+/* #define PID_FLIGHT_RECORDER */
+
+
+/* PID_BANK_RELOCATABLE:
+   Define this to access the controllers through a pointer which can be 
+   redirected to memory provided by the application with pid_BankSet,
+   e.g. memory on huge pages or on the NUMA node of the thread stepping
+   the controllers (see pidbank.h). Otherwise the controllers are a
+   static array of the library which saves the indirection.
+*/
+/* #define PID_BANK_RELOCATABLE */
+
+
 /* PID_USE_OWN_STDINT:
    Define the following macro if your compiler does not ship the stdint.h
    file with integer type definitions according to the C99 standard. For
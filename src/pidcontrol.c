@@ -46,20 +46,35 @@
 * Jan.Winkler@tu-dresden.de
 * 04.06.2014
 *********************************************************************/
+#include <stdlib.h>
+#include <string.h>
 #include "pidcontrol.h"
 
 
+/* Type of the precomputed factors of pid_StepDt. With fixpoint arithmetic
+   they are scaled by PID_DT_SCALE and multiplied by dt in 64 bit (128 bit
+   for PID_VAL_FORMAT_I64 if available), which leaves rounding errors
+   below one digit of the coefficients for dt < PID_DT_SCALE.
+*/
+#ifdef PID_FIXPOINT
+#define PID_DT_SCALE 65536
+#if (defined PID_VAL_FORMAT_I64) && (defined __SIZEOF_INT128__)
+typedef __int128 PIDDtFactor;
+#else
+typedef int64_t PIDDtFactor;
+#endif
+#else
+typedef PIDValue PIDDtFactor;
+#endif
+
+
 /* Structure defining the parameters and state of a PID controller */
 typedef struct PIDControllerStruct
 {
 	/* The coefficients for the difference equations resulting 
 	   from the controller parameters 
 	*/
-	PIDValue Cp;	/* Proportional (Kp)*/
-	PIDValue Ci;	/* Integration rectengular approx. (Ki*TSample) or (Ki*TSample/2)*/
-	PIDValue Cd;	/* Differentiation without filtering (Kd/TSample)*/
-	PIDValue Cdf;	/* Differentiation with filtering, diff. part (Kd/Tf)*/
-	PIDValue Cf;	/* Differentiation with filtering, filt. part (1-Ta/Tf)*/
+	PIDCoeffs C;
 	
 	/* The boundary values */ 
 	PIDValue yMax;
@@ -68,6 +83,19 @@ typedef struct PIDControllerStruct
 	/* The sample time */
 	PIDValue TSample;
 
+	/* Base values for steps with a varying sample time dt (pid_StepDt):
+	   Ci = KiDt*dt, Cd = KdNum/dt, Cf = (Tf-dt)*TfInv. With fixpoint
+	   arithmetic KiDt and TfInv are scaled by PID_DT_SCALE.
+	*/
+	PIDDtFactor KiDt;
+	PIDDtFactor TfInv;
+	PIDValue KdNum;
+	PIDValue Tf;
+
+	/* Cd of the last dt passed to pid_StepDt (DtLast = 0 if none) */
+	PIDValue DtLast;
+	PIDValue CdLast;
+
 	/* History of input, output and filtered input
 	   The neweset value can be found at position 0,
 	   the oldest at position 1
@@ -79,37 +107,222 @@ typedef struct PIDControllerStruct
 	PIDValue P;
 	PIDValue I;
 	PIDValue D;
+
+#ifdef PID_INTEGRATOR_COMPENSATED
+	/* Rounding error of the I-part not yet added to it */
+	PIDValue Ic;
+#endif
 	
 	/* Anti-Windup enabled */
 	PIDArw     Arw;
 
+#ifdef PID_LAZY_INIT
+	/* Set by pid_LimitsSet, without it yMin and yMax are not applied */
+	unsigned char Limits;
+
+	/* Set in the first controller of a bank by pid_Init, the zeroed
+	   memory of a new bank has it cleared
+	*/
+	unsigned char Inited;
+#endif
+
+	/* Gain schedule used by pid_StepSched (NULL if none) */
+	const PIDSchedule* Sched;
+
+#ifdef PID_FLIGHT_RECORDER
+	/* Flight recorder (NULL if none) */
+	PIDRecorder* Rec;
+
+	/* Set if the anti-windup held the I-part in the last step */
+	unsigned char Held;
+#endif
+
+#ifdef PID_OUTPUT_STAGE
+	/* Output stage used by pid_StepBankOut (NULL if none) */
+	const PIDOutStage* Out;
+#endif
+
+#ifdef PID_FIXPOINT_OVERFLOW_FLAG
+	/* Set if an intermediate result had to be saturated */
+	unsigned char Ovf;
+#endif
+
 } PIDController;
 
 
+/* Divisor of the I-coefficient of the integration algorithm */
+#if (defined PID_INTALGO_RECT)
+#define PID_INTALGO_DIV 1
+#else
+#define PID_INTALGO_DIV 2
+#endif
+
+
+/* With lazy initialization all-zero bits are the default state of a
+   controller: it has no limits and a sample time of 1 until the
+   parameters are set.
+*/
+#ifdef PID_LAZY_INIT
+#define PID_HAS_LIMITS(c)	((c)->Limits)
+#define PID_TSAMPLE(c)		(((c)->TSample == 0) ? 1 : (c)->TSample)
+#else
+#define PID_HAS_LIMITS(c)	1
+#define PID_TSAMPLE(c)		((c)->TSample)
+#endif
+
+
 /* The global array of PID controllers managed by the running
-   instance of the library 
+   instance of the library. If the bank is relocatable PID points
+   to it and may be redirected to other memory by pid_BankSet.
 */
+#ifdef PID_BANK_RELOCATABLE
+static PIDController pid_BankDefault[PID_NUM_CONTROLLERS];
+PIDController* PID = pid_BankDefault;
+#else
 PIDController PID[PID_NUM_CONTROLLERS];
+#endif
+
+
+
+/* Index of the lowest set bit of x (x != 0) */
+static PID_INLINE uint32_t pid_Ctz64( uint64_t x )
+{
+#ifdef __GNUC__
+	return (uint32_t)__builtin_ctzll(x);
+#else
+	uint32_t k = 0;
+
+	while ( (x & 1) == 0 ) { x >>= 1; k++; }
+	return k;
+#endif
+}
+
+
+
+#ifdef PID_FIXPOINT_SATURATE
+/* Saturating fixpoint arithmetic used by pid_Step. The limits are applied
+   by selects instead of jumps so that the compiler can emit conditional
+   moves. Each saturation is recorded in *Ovf.
+*/
+
+/* Reduces a value of double width to the value type */
+static PID_INLINE PIDValue pid_SatNarrow( PIDWideValue x, unsigned char* Ovf )
+{
+	unsigned char hi = (x > PID_VAL_MAX);
+	unsigned char lo = (x < PID_VAL_MIN);
+
+	*Ovf |= hi | lo;
+	x = hi ? PID_VAL_MAX : x;
+	x = lo ? PID_VAL_MIN : x;
+	return (PIDValue)x;
+}
+
+/* a + b */
+static PID_INLINE PIDValue pid_SatAdd( PIDValue a, PIDValue b, unsigned char* Ovf )
+{
+#ifdef __GNUC__
+	PIDValue r;
+	unsigned char o = (unsigned char)__builtin_add_overflow(a, b, &r);
+
+	/* An overflow is only possible if a and b have the same sign */
+	*Ovf |= o;
+	return o ? (PIDValue)((a < 0) ? PID_VAL_MIN : PID_VAL_MAX) : r;
+#else
+	return pid_SatNarrow((PIDWideValue)a + b, Ovf);
+#endif
+}
+
+/* a - b */
+static PID_INLINE PIDValue pid_SatSub( PIDValue a, PIDValue b, unsigned char* Ovf )
+{
+#ifdef __GNUC__
+	PIDValue r;
+	unsigned char o = (unsigned char)__builtin_sub_overflow(a, b, &r);
+
+	/* An overflow is only possible if a and b have different signs */
+	*Ovf |= o;
+	return o ? (PIDValue)((a < 0) ? PID_VAL_MIN : PID_VAL_MAX) : r;
+#else
+	return pid_SatNarrow((PIDWideValue)a - b, Ovf);
+#endif
+}
+
+/* (a*b)/PID_FIXPOINT_FACTOR with the product formed in double width */
+static PID_INLINE PIDValue pid_SatMul( PIDValue a, PIDValue b, unsigned char* Ovf )
+{
+	return pid_SatNarrow(((PIDWideValue)a*b) PID_FIXPOINT_CORR_MUL, Ovf);
+}
+#endif
 
 
 
 
 /* Initialization of the library */
 void pid_Init( void )
+{
+#ifdef PID_LAZY_INIT
+	/* The zeroed memory of a new bank is already initialized, a bank 
+	   initialized before may have been used since. The mark stays with
+	   the bank, so switching banks by pid_BankSet keeps it */
+	if ( PID[0].Inited ) pid_InitRange(0, PID_NUM_CONTROLLERS);
+	PID[0].Inited = 1;
+#else
+	pid_InitRange(0, PID_NUM_CONTROLLERS);
+#endif
+}
+
+
+
+/* Initialization of the controllers first, ..., first+n-1 */
+PIDErr pid_InitRange( PIDInd first, PIDInd n )
 {
 	PIDInd i, j;
+#ifdef PID_LAZY_INIT
+	unsigned char Inited = PID[0].Inited;
+#endif
+
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( (unsigned long)first + n > PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
 
-	for (i = 0; i < PID_NUM_CONTROLLERS; i++)
+#ifdef PID_LAZY_INIT
+	(void)i;
+	(void)j;
+	memset(&PID[first], 0, n*sizeof(PIDController));
+	/* The mark of pid_Init belongs to the bank, not to controller 0 */
+	PID[0].Inited = Inited;
+#else
+	for (i = first; i < first + n; i++)
 	{
-		PID[i].Cp		= 0;
-		PID[i].Ci		= 0;
-		PID[i].Cd		= 0;
-		PID[i].Cf		= 0;
+		PID[i].C.Cp		= 0;
+		PID[i].C.Ci		= 0;
+		PID[i].C.Cd		= 0;
+		PID[i].C.Cf		= 0;
 		PID[i].TSample	= 1;
+		PID[i].KiDt		= 0;
+		PID[i].TfInv	= 0;
+		PID[i].KdNum	= 0;
+		PID[i].Tf		= 0;
+		PID[i].DtLast	= 0;
+		PID[i].CdLast	= 0;
 		PID[i].Arw		= pidArw_Off;
+		PID[i].Sched	= 0;
+#ifdef PID_FLIGHT_RECORDER
+		PID[i].Rec		= 0;
+		PID[i].Held		= 0;
+#endif
+#ifdef PID_OUTPUT_STAGE
+		PID[i].Out		= 0;
+#endif
 		PID[i].P		= 0;
 		PID[i].I		= 0;
 		PID[i].D		= 0;
+#ifdef PID_INTEGRATOR_COMPENSATED
+		PID[i].Ic		= 0;
+#endif
+#ifdef PID_FIXPOINT_OVERFLOW_FLAG
+		PID[i].Ovf		= 0;
+#endif
 
 		for (j = 0; j < 2; j++) 
 		{
@@ -140,59 +353,82 @@ void pid_Init( void )
 #endif
 
 	}
+#endif
+
+	return pidErr_Ok;
 }
 
 
 
-/* Sets parameters of the controller with the index id (time constant form)*/
-PIDErr pid_ParaSet_T( PIDInd id, PIDValue Kr, PIDValue Tn, PIDValue Tv, PIDValue Tf, PIDValue TSample )
+/* Size of the memory of all controllers */
+size_t pid_BankSize( void )
 {
+	return sizeof(PIDController)*PID_NUM_CONTROLLERS;
+}
+
 
+
+#ifdef PID_BANK_RELOCATABLE
+/* Places the controllers in the memory Mem, NULL for the default bank */
+PIDErr pid_BankSet( void* Mem )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( ((size_t)Mem % 16) != 0 ) return pidErr_Memory;
+#endif
+
+	PID = (Mem != NULL) ? (PIDController*)Mem : pid_BankDefault;
+
+	return pidErr_Ok;
+}
+#endif
+
+
+
+/* Computes the coefficients for the parameters in time constant form */
+PIDErr pid_CoeffsCalc_T( PIDValue Kr, PIDValue Tn, PIDValue Tv, PIDValue Tf, PIDValue TSample, PIDCoeffs* C )
+{
 #ifdef PID_INDEX_BOUND_CHECK
-	if ( id >= PID_NUM_CONTROLLERS )    return pidErr_Index;
 	if ( (Tf != 0) && (Tf < TSample) )  return pidErr_Tf;
 	if ( TSample <= 0)                  return pidErr_TSample;
 	if ( Tn < 0 )						return pidErr_Tn;
 	if ( Tv < 0 )						return pidErr_Tv;
 #endif
 
-	PID[id].TSample = TSample;
-
 	/* Coefficients P-part */
-	PID[id].Cp		= Kr;
+	C->Cp		= Kr;
 	
 	/* Coefficients I-part */
 	if (Tn == 0)
 	{
-		PID[id].Ci = 0;
+		C->Ci = 0;
 	}
 	else
 	{
 #if (defined PID_INTALGO_RECT)
-		PID[id].Ci	= (Kr*TSample)/Tn;
+		C->Ci	= (Kr*TSample)/Tn;
 #elif (defined PID_INTALGO_TRAPZ)
-		PID[id].Ci	= (Kr*TSample)/(2*Tn);
+		C->Ci	= (Kr*TSample)/(2*Tn);
 #else
 	#error "No integration algorithm (PID_INTALGO_TRAPZ, PID_INTALGO_RECT) specified!"
 #endif
 	}
 
 	/* Coefficients D-part */
-	PID[id].Cd		= (Kr*Tv)/TSample;
+	C->Cd		= (Kr*Tv)/TSample;
 
 	if ( Tf == 0 )
 	{
-		PID[id].Cf	= 0;
-		PID[id].Cdf = 0;
+		C->Cf	= 0;
+		C->Cdf = 0;
 	}
 	else 
 	{
 #ifdef PID_FIXPOINT
-		PID[id].Cf	= (PID_FIXPOINT_FACTOR*(Tf - TSample))/Tf;
+		C->Cf	= (PID_FIXPOINT_FACTOR*(Tf - TSample))/Tf;
 #else
-		PID[id].Cf	= 1 - TSample/Tf;
+		C->Cf	= 1 - TSample/Tf;
 #endif
-		PID[id].Cdf = (Kr*Tv)/Tf;
+		C->Cdf = (Kr*Tv)/Tf;
 	};
 
 	return pidErr_Ok;
@@ -200,44 +436,41 @@ PIDErr pid_ParaSet_T( PIDInd id, PIDValue Kr, PIDValue Tn, PIDValue Tv, PIDValue
 
 
 
-/* Sets parameters of the controller with the index id (gain constant form)*/
-PIDErr pid_ParaSet_K( PIDInd id, PIDValue Kp, PIDValue Ki, PIDValue Kd, PIDValue Tf, PIDValue TSample )
+/* Computes the coefficients for the parameters in gain form */
+PIDErr pid_CoeffsCalc_K( PIDValue Kp, PIDValue Ki, PIDValue Kd, PIDValue Tf, PIDValue TSample, PIDCoeffs* C )
 {
 #ifdef PID_INDEX_BOUND_CHECK
-	if ( id >= PID_NUM_CONTROLLERS )   return pidErr_Index;
 	if ( (Tf != 0) && (Tf < TSample) ) return pidErr_Tf;
 	if ( TSample <= 0)                 return pidErr_TSample;
 #endif
 
-	PID[id].TSample = TSample;
-	
 	/* Proportional part */
-	PID[id].Cp		= Kp;
+	C->Cp		= Kp;
 
 	/* Integration part */
 #if (defined PID_INTALGO_RECT)
-	PID[id].Ci		= Ki*TSample;
+	C->Ci		= Ki*TSample;
 #elif (defined PID_INTALGO_TRAPZ)
-	PID[id].Ci		= Ki*TSample/2;
+	C->Ci		= Ki*TSample/2;
 #else
 	#error "No integration algorithm (PID_INTALGO_TRAPZ, PID_INTALGO_RECT) specified!"
 #endif
 
 	/* Differential part */
-	PID[id].Cd		= Kd/TSample;
+	C->Cd		= Kd/TSample;
 	if ( Tf == 0 )
 	{
-		PID[id].Cf		= 0;
-		PID[id].Cdf     = 0;
+		C->Cf		= 0;
+		C->Cdf     = 0;
 	}
 	else 
 	{
 #ifdef PID_FIXPOINT  
-		PID[id].Cf		= (PID_FIXPOINT_FACTOR*(Tf - TSample))/Tf;
+		C->Cf		= (PID_FIXPOINT_FACTOR*(Tf - TSample))/Tf;
 #else
-		PID[id].Cf		= 1-TSample/Tf;
+		C->Cf		= 1-TSample/Tf;
 #endif
-		PID[id].Cdf     = Kd/Tf;
+		C->Cdf     = Kd/Tf;
 	};
 
 	return pidErr_Ok;
@@ -245,6 +478,69 @@ PIDErr pid_ParaSet_K( PIDInd id, PIDValue Kp, PIDValue Ki, PIDValue Kd, PIDValue
 
 
 
+/* Sets the base values of pid_StepDt for Ci = (KiNum/KiDen)*dt, 
+   Cd = KdNum/dt, and Cf = 1 - dt/Tf. The quotients are computed once 
+   here, so that a step only needs the division of the D-part.
+*/
+static void pid_DtBaseSet( PIDController* c, PIDValue KiNum, PIDValue KiDen, PIDValue KdNum, PIDValue Tf )
+{
+#ifdef PID_FIXPOINT
+	c->KiDt		= ((PIDDtFactor)KiNum*PID_DT_SCALE)/KiDen;
+	c->TfInv	= (Tf == 0) ? 0 : ((PIDDtFactor)PID_FIXPOINT_FACTOR*PID_DT_SCALE)/Tf;
+#else
+	c->KiDt		= KiNum/KiDen;
+	c->TfInv	= (Tf == 0) ? 0 : 1/Tf;
+#endif
+	c->KdNum	= KdNum;
+	c->Tf		= Tf;
+	c->DtLast	= 0;
+}
+
+
+
+/* Sets parameters of the controller with the index id (time constant form)*/
+PIDErr pid_ParaSet_T( PIDInd id, PIDValue Kr, PIDValue Tn, PIDValue Tv, PIDValue Tf, PIDValue TSample )
+{
+	PIDErr err;
+
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS )    return pidErr_Index;
+#endif
+
+	err = pid_CoeffsCalc_T(Kr, Tn, Tv, Tf, TSample, &PID[id].C);
+	if ( err != pidErr_Ok ) return err;
+
+	PID[id].TSample = TSample;
+	if ( Tn == 0 )
+		pid_DtBaseSet(&PID[id], 0, 1, Kr*Tv, Tf);
+	else
+		pid_DtBaseSet(&PID[id], Kr, PID_INTALGO_DIV*Tn, Kr*Tv, Tf);
+
+	return pidErr_Ok;
+}
+
+
+
+/* Sets parameters of the controller with the index id (gain constant form)*/
+PIDErr pid_ParaSet_K( PIDInd id, PIDValue Kp, PIDValue Ki, PIDValue Kd, PIDValue Tf, PIDValue TSample )
+{
+	PIDErr err;
+
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS )   return pidErr_Index;
+#endif
+
+	err = pid_CoeffsCalc_K(Kp, Ki, Kd, Tf, TSample, &PID[id].C);
+	if ( err != pidErr_Ok ) return err;
+
+	PID[id].TSample = TSample;
+	pid_DtBaseSet(&PID[id], Ki, PID_INTALGO_DIV, Kd, Tf);
+
+	return pidErr_Ok;
+}
+
+
+
 /* Gets the parameter of controller with id in time constant form */
 PIDErr pid_ParaGet_T( PIDInd id, PIDValue* Kr, PIDValue* Tn, PIDValue* Tv, PIDValue* Tf, PIDValue* TSample )
 {
@@ -254,25 +550,25 @@ PIDErr pid_ParaGet_T( PIDInd id, PIDValue* Kr, PIDValue* Tn, PIDValue* Tv, PIDVa
 	
 	/* Sample time */
 	if (TSample != 0) 
-		*TSample = PID[id].TSample;
+		*TSample = PID_TSAMPLE(&PID[id]);
 
 	/* Coefficients P-part */
 	if (Kr != 0)
-		*Kr = PID[id].Cp;
+		*Kr = PID[id].C.Cp;
 	
 	/* Coefficients I-part */
 	if (Tn != 0)
 	{
-		if (PID[id].Ci == 0)
+		if (PID[id].C.Ci == 0)
 		{
 			*Tn = 0;
 		}
 		else
 		{
 		#if (defined PID_INTALGO_RECT)
-			*Tn = (PID[id].Cp*PID[id].TSample)/PID[id].Ci;
+			*Tn = (PID[id].C.Cp*PID_TSAMPLE(&PID[id]))/PID[id].C.Ci;
 		#elif (defined PID_INTALGO_TRAPZ)
-			*Tn = (PID[id].Cp*PID[id].TSample)/(2*PID[id].Ci);
+			*Tn = (PID[id].C.Cp*PID_TSAMPLE(&PID[id]))/(2*PID[id].C.Ci);
 		#else
 			#error "No integration algorithm (PID_INTALGO_TRAPZ, PID_INTALGO_RECT) specified!"
 		#endif
@@ -282,19 +578,19 @@ PIDErr pid_ParaGet_T( PIDInd id, PIDValue* Kr, PIDValue* Tn, PIDValue* Tv, PIDVa
 	/* Coefficients D-part */
 	if ( Tv != 0 )
 	{
-		*Tv = (PID[id].Cd*PID[id].TSample)/PID[id].Cp;
+		*Tv = (PID[id].C.Cd*PID_TSAMPLE(&PID[id]))/PID[id].C.Cp;
 	}
 
 	/* Filter */
 	if ( Tf != 0 )
 	{
-		if ( PID[id].Cdf == 0 )
+		if ( PID[id].C.Cdf == 0 )
 		{
 			*Tf = 0;
 		}
 		else 
 		{
-			*Tf = (PID[id].Cd*PID[id].TSample)/PID[id].Cdf;
+			*Tf = (PID[id].C.Cd*PID_TSAMPLE(&PID[id]))/PID[id].C.Cdf;
 		};
 	};
 
@@ -312,19 +608,19 @@ PIDErr pid_ParaGet_K( PIDInd id, PIDValue* Kp, PIDValue* Ki, PIDValue* Kd, PIDVa
 	
 	/* Sample time */
 	if (TSample != 0) 
-		*TSample = PID[id].TSample;
+		*TSample = PID_TSAMPLE(&PID[id]);
 
 	/* Coefficients P-part */
 	if (Kp != 0)
-		*Kp = PID[id].Cp;
+		*Kp = PID[id].C.Cp;
 	
 	/* Coefficients I-part */
 	if (Ki != 0)
 	{
 	#if (defined PID_INTALGO_RECT)
-		*Ki = PID[id].Ci/PID[id].TSample;
+		*Ki = PID[id].C.Ci/PID_TSAMPLE(&PID[id]);
 	#elif (defined PID_INTALGO_TRAPZ)
-		*Ki = (2*PID[id].Ci)/PID[id].TSample;
+		*Ki = (2*PID[id].C.Ci)/PID_TSAMPLE(&PID[id]);
 	#else
 		#error "No integration algorithm (PID_INTALGO_TRAPZ, PID_INTALGO_RECT) specified!"
 	#endif
@@ -333,19 +629,19 @@ PIDErr pid_ParaGet_K( PIDInd id, PIDValue* Kp, PIDValue* Ki, PIDValue* Kd, PIDVa
 	/* Coefficients D-part */
 	if ( Kd != 0 )
 	{
-		*Kd = PID[id].Cd*PID[id].TSample;
+		*Kd = PID[id].C.Cd*PID_TSAMPLE(&PID[id]);
 	}
 
 	/* Filter */
 	if ( Tf != 0 )
 	{
-		if ( PID[id].Cdf == 0 )
+		if ( PID[id].C.Cdf == 0 )
 		{
 			*Tf = 0;
 		}
 		else 
 		{
-			*Tf = (PID[id].Cd*PID[id].TSample)/PID[id].Cdf;
+			*Tf = (PID[id].C.Cd*PID_TSAMPLE(&PID[id]))/PID[id].C.Cdf;
 		};
 	};
 
@@ -365,6 +661,31 @@ PIDErr pid_LimitsSet( PIDInd id, PIDValue yMin, PIDValue yMax )
 
 	PID[id].yMin = yMin;
 	PID[id].yMax = yMax;
+#ifdef PID_LAZY_INIT
+	PID[id].Limits = 1;
+#endif
+
+	return pidErr_Ok;
+}
+
+
+
+PIDErr pid_LimitsGet( PIDInd id, PIDValue* yMin, PIDValue* yMax )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
+
+#ifdef PID_LAZY_INIT
+	if ( !PID[id].Limits )
+	{
+		*yMin = PID_VAL_MIN;
+		*yMax = PID_VAL_MAX;
+		return pidErr_Ok;
+	}
+#endif
+	*yMin = PID[id].yMin;
+	*yMax = PID[id].yMax;
 
 	return pidErr_Ok;
 }
@@ -384,28 +705,130 @@ PIDErr pid_ArwSet( PIDInd id, PIDArw Arw )
 
 
 
+PIDErr pid_ArwGet( PIDInd id, PIDArw* Arw )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
 
+	*Arw = PID[id].Arw;
 
-PIDErr pid_Step( PIDInd id, PIDValue e, PIDValue* y )
+	return pidErr_Ok;
+}
+
+
+
+
+#ifdef PID_FLIGHT_RECORDER
+/* Publishing of the frozen flag to other threads */
+#ifdef __GNUC__
+	#define PID_REC_STORE(x, v)	__atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+	#define PID_REC_LOAD(x)		__atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#else
+	#define PID_REC_STORE(x, v)	((x) = (v))
+	#define PID_REC_LOAD(x)		(x)
+#endif
+
+/* Returns if the output y is at one of the limits of controller c */
+#define PID_AT_LIMIT(c, y) (PID_HAS_LIMITS(c) && (((y) == (c)->yMax) || ((y) == (c)->yMin)))
+
+/* Records the values of the last step of controller c and checks the
+   trigger events, held is set if the anti-windup held the I-part in
+   this step
+*/
+static PID_INLINE void pid_Record( const PIDController* c, PIDRecorder* R, unsigned char held )
 {
-	PIDValue IOld = 0;
+	PIDRecSample* s;
+	unsigned char ev = 0;
 
-#ifdef PID_INDEX_BOUND_CHECK
-	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+	if ( PID_REC_LOAD(R->Frozen) ) return;
+
+	s = &R->Buf[R->Pos];
+	s->e = c->e[0];
+	s->P = c->P;
+	s->I = c->I;
+	s->D = c->D;
+	s->y = c->y[0];
+	R->Pos = (R->Pos + 1 == R->Num) ? 0 : R->Pos + 1;
+	if ( R->Count < R->Num ) R->Count++;
+
+	if ( R->Event == 0 )
+	{
+		/* Check the events, the limits are triggered when they are reached */
+		if ( (R->Mask & pidRec_SatMax) && PID_HAS_LIMITS(c) && (c->y[0] == c->yMax) && (c->y[1] != c->yMax) ) ev |= pidRec_SatMax;
+		if ( (R->Mask & pidRec_SatMin) && PID_HAS_LIMITS(c) && (c->y[0] == c->yMin) && (c->y[1] != c->yMin) ) ev |= pidRec_SatMin;
+		if ( (R->Mask & pidRec_Arw) && held && !c->Held )										 ev |= pidRec_Arw;
+		if ( (R->Mask & pidRec_User) && (R->Pred != NULL) && R->Pred(s, R->Ctx) )			 ev |= pidRec_User;
+		if ( ev == 0 ) return;
+
+		R->Event	= ev;
+		R->PostLeft = R->Post;
+	}
+	else
+	{
+		R->PostLeft--;
+	}
+
+	if ( R->PostLeft == 0 ) PID_REC_STORE(R->Frozen, 1);
+}
+#endif
+
+
+
+#ifdef PID_INTEGRATOR_COMPENSATED
+/* Adds x to the I-part of controller c. The rounding error of the sum
+   is computed exactly (TwoSum) and collected in Ic, then as much of Ic
+   as possible is moved into the I-part.
+*/
+static PID_INLINE void pid_IAdd( PIDController* c, PIDValue x )
+{
+	PIDValue s = c->I + x;
+	PIDValue b = s - c->I;
+
+	c->Ic += (c->I - (s - b)) + (x - b);
+	c->I   = s + c->Ic;
+	c->Ic -= c->I - s;
+}
+#endif
+
+
+
+/* Performs one step of calculation for the controller c without
+   recording it. pid_StepBankOut records the step after its output stage.
+   Returns nonzero if the anti-windup held the I-part, i.e. dropped a
+   change of it.
+*/
+static PID_FORCE_INLINE unsigned char pid_KernelCalc( PIDController* c, const PIDCoeffs* C, PIDValue e )
+{
+	PIDValue IOld = 0;
+	unsigned char held = 0;
+#ifdef PID_INTEGRATOR_COMPENSATED
+	PIDValue IcOld = c->Ic;
+#endif
+#ifdef PID_STEP_BRANCHFREE
+	PIDValue Cdx;
+	unsigned char hi, lo, arw;
+#endif
+#ifdef PID_FIXPOINT_SATURATE
+	unsigned char Ovf = 0;
 #endif
 
 	/* Shift the history of the inputs and outputs. The following holds:
 	   e_k = e[0], e_{k-1} = e[1], e_{k-2} = e[2]
     */
-	PID[id].e[1] = PID[id].e[0];
-	PID[id].y[1] = PID[id].y[0];
+	c->e[1] = c->e[0];
+	c->y[1] = c->y[0];
 
 	/* Assign the new control difference to the history */
-	PID[id].e[0] = e;
+	c->e[0] = e;
 
 	/* Proportional part */
 	/*********************/
-	PID[id].P = (PID[id].Cp*e) PID_FIXPOINT_CORR_MUL;
+#ifdef PID_FIXPOINT_SATURATE
+	c->P = pid_SatMul(C->Cp, e, &Ovf);
+#else
+	c->P = (C->Cp*e) PID_FIXPOINT_CORR_MUL;
+#endif
 
 
 	/* Integral part */
@@ -414,13 +837,21 @@ PIDErr pid_Step( PIDInd id, PIDValue e, PIDValue* y )
 	/* Remember I part from last step if we have to drop the calculation
 	   due to anti-windup
     */ 
-	IOld = PID[id].I;
+	IOld = c->I;
 
 	/* Do the integration depending on the chosen integration algorithm */
-#if (defined PID_INTALGO_RECT) /* rectengular approximation */
-    PID[id].I += (PID[id].Ci*PID[id].e[1]) PID_FIXPOINT_CORR_MUL;
+#if (defined PID_FIXPOINT_SATURATE) && (defined PID_INTALGO_RECT)
+	c->I = pid_SatAdd(c->I, pid_SatMul(C->Ci, c->e[1], &Ovf), &Ovf);
+#elif (defined PID_FIXPOINT_SATURATE) && (defined PID_INTALGO_TRAPZ)
+	c->I = pid_SatAdd(c->I, pid_SatMul(C->Ci, pid_SatAdd(c->e[0], c->e[1], &Ovf), &Ovf), &Ovf);
+#elif (defined PID_INTEGRATOR_COMPENSATED) && (defined PID_INTALGO_RECT)
+	pid_IAdd(c, C->Ci*c->e[1]);
+#elif (defined PID_INTEGRATOR_COMPENSATED) && (defined PID_INTALGO_TRAPZ)
+	pid_IAdd(c, C->Ci*(c->e[0] + c->e[1]));
+#elif (defined PID_INTALGO_RECT) /* rectengular approximation */
+    c->I += (C->Ci*c->e[1]) PID_FIXPOINT_CORR_MUL;
 #elif (defined PID_INTALGO_TRAPZ) /* trapezoidal approximation */
-	PID[id].I += (PID[id].Ci*(PID[id].e[0] + PID[id].e[1])) PID_FIXPOINT_CORR_MUL;
+	c->I += (C->Ci*(c->e[0] + c->e[1])) PID_FIXPOINT_CORR_MUL;
 #else
 	#error "No integration algorithm (PID_INTALGO_TRAPZ, PID_INTALGO_RECT) specified!"
 #endif
@@ -428,51 +859,1424 @@ PIDErr pid_Step( PIDInd id, PIDValue e, PIDValue* y )
 
 	/* Differential part */
 	/*********************/
-	
+#ifdef PID_STEP_BRANCHFREE
+	/* The calculation without smoothing is the one with smoothing
+	   for Cf = 0 when Cd is used instead of Cdf
+	*/
+	Cdx = (C->Cf == 0) ? C->Cd : C->Cdf;
+#endif
+
+#if (defined PID_FIXPOINT_SATURATE) && (defined PID_STEP_BRANCHFREE)
+	/* See the filtered D-part below for the range of the wide sum */
+	c->D = pid_SatNarrow(((PIDWideValue)Cdx*pid_SatSub(c->e[0], c->e[1], &Ovf) 
+						 + (PIDWideValue)C->Cf*c->D) PID_FIXPOINT_CORR_MUL, &Ovf);
+#elif (defined PID_FIXPOINT_SATURATE)
+	if ( C->Cf == 0 )
+	{
+		c->D = pid_SatMul(C->Cd, pid_SatSub(c->e[0], c->e[1], &Ovf), &Ovf);
+	}
+	else
+	{
+		/* For n bit values |Cdf*(e0 - e1)| <= 2^(2n-2). The coefficients
+		   have 0 <= Cf <= PID_FIXPOINT_FACTOR < 2^(n-1) (pid_CoeffsCalc_*
+		   gives them, pid_ScheduleInit rejects others), hence
+		   |Cf*D| < 2^(2n-2) and the sum fits into the wide type
+		*/
+		c->D = pid_SatNarrow(((PIDWideValue)C->Cdf*pid_SatSub(c->e[0], c->e[1], &Ovf) 
+							 + (PIDWideValue)C->Cf*c->D) PID_FIXPOINT_CORR_MUL, &Ovf);
+	}
+#elif (defined PID_STEP_BRANCHFREE)
+	c->D = (Cdx*(c->e[0] - c->e[1]) + C->Cf*c->D) PID_FIXPOINT_CORR_MUL;
+#else
 	/* Calcultion without smoothing of the input */
-	if ( PID[id].Cf == 0 )
+	if ( C->Cf == 0 )
 	{
-		PID[id].D = (PID[id].Cd*(PID[id].e[0] - PID[id].e[1])) PID_FIXPOINT_CORR_MUL;
+		c->D = (C->Cd*(c->e[0] - c->e[1])) PID_FIXPOINT_CORR_MUL;
 	}
 	else /* Calcultion with smoothing of the input */
 	{
 		/* Differentiation incl. low-pass filtering*/
-		PID[id].D = (PID[id].Cdf*(PID[id].e[0] - PID[id].e[1]) + PID[id].Cf*PID[id].D) PID_FIXPOINT_CORR_MUL;
+		c->D = (C->Cdf*(c->e[0] - c->e[1]) + C->Cf*c->D) PID_FIXPOINT_CORR_MUL;
 	}
+#endif
 
 	/* Overall control output */
-	PID[id].y[0] = PID[id].P + PID[id].I + PID[id].D;
+#ifdef PID_FIXPOINT_SATURATE
+	c->y[0] = pid_SatNarrow((PIDWideValue)c->P + c->I + c->D, &Ovf);
+
+#ifdef PID_FIXPOINT_OVERFLOW_FLAG
+	c->Ovf |= Ovf;
+#endif
+#else
+	c->y[0] = c->P + c->I + c->D;
+#endif
 
+#ifdef PID_STEP_BRANCHFREE
+	/* Check the boundary values and apply anti-windup by selects. The
+	   order of the selects equals the one of the if-cascade below
+	*/
+	hi  = PID_HAS_LIMITS(c) & (c->y[0] > c->yMax);
+	lo  = PID_HAS_LIMITS(c) & (c->y[0] < c->yMin);
+	c->y[0] = hi ? c->yMax : c->y[0];
+	c->y[0] = (lo & !hi) ? c->yMin : c->y[0];
+
+	arw = (c->Arw == pidArw_On) & PID_HAS_LIMITS(c) & ((c->y[0] == c->yMax) | (c->y[0] == c->yMin));
+#ifdef PID_INTEGRATOR_COMPENSATED
+	held = arw & ((c->I != IOld) | (c->Ic != IcOld));
+#else
+	held = arw & (c->I != IOld);
+#endif
+	c->I = arw ? IOld : c->I;
+#ifdef PID_INTEGRATOR_COMPENSATED
+	c->Ic = arw ? IcOld : c->Ic;
+#endif
+#else
 	/* Check if boundary values are violated */
-	if (PID[id].y[0] > PID[id].yMax) PID[id].y[0] = PID[id].yMax;
-	else if (PID[id].y[0] < PID[id].yMin) PID[id].y[0] = PID[id].yMin;
+	if (PID_HAS_LIMITS(c) && c->y[0] > c->yMax) c->y[0] = c->yMax;
+	else if (PID_HAS_LIMITS(c) && c->y[0] < c->yMin) c->y[0] = c->yMin;
 
 	/* If Anti-Windup is activated and output is on its boundary value drop
 	   the last calculation of the I-Part
     */
-	if ( (PID[id].Arw == pidArw_On) && 
-		 ( (PID[id].y[0] == PID[id].yMax) || (PID[id].y[0] == PID[id].yMax) ) )
+	if ( (c->Arw == pidArw_On) && PID_HAS_LIMITS(c) &&
+		 ( (c->y[0] == c->yMax) || (c->y[0] == c->yMin) ) )
 	{
-		PID[id].I = IOld;
+#ifdef PID_INTEGRATOR_COMPENSATED
+		held = (c->I != IOld) || (c->Ic != IcOld);
+		c->Ic = IcOld;
+#else
+		held = (c->I != IOld);
+#endif
+		c->I = IOld;
 	}
+#endif
 
-	/* Assign the return value */
-	*y = PID[id].y[0];
-
-	return pidErr_Ok;
+	return held;
 }
- 
 
 
-/* Sets the I-part of controller with index id to the value I */
-PIDErr pid_IPartSet( PIDInd id, PIDValue I )
+
+/* Performs one step of calculation for the controller c. This is the
+   kernel shared by all step functions of the library.
+*/
+static PID_FORCE_INLINE void pid_Kernel( PIDController* c, const PIDCoeffs* C, PIDValue e )
 {
-#ifdef PID_INDEX_BOUND_CHECK
-	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
-#endif
-	PID[id].I = I;
+#ifdef PID_FLIGHT_RECORDER
+	unsigned char held = pid_KernelCalc(c, C, e);
 
-	return pidErr_Ok;
+	if ( c->Rec != NULL ) pid_Record(c, c->Rec, held);
+	c->Held = held;
+#else
+	pid_KernelCalc(c, C, e);
+#endif
+}
+
+
+
+PIDErr pid_Step( PIDInd id, PIDValue e, PIDValue* y )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
+
+	pid_Kernel(&PID[id], &PID[id].C, e);
+
+	/* Assign the return value */
+	*y = PID[id].y[0];
+
+	return pidErr_Ok;
+}
+
+
+
+/* Computes the coefficients of controller c for the sample time dt from
+   the base values set by pid_ParaSet_X. The only division by dt is the
+   one of the D-part, which is repeated only if dt changes. The fixpoint
+   factors are scaled by a power of two.
+*/
+static PID_INLINE void pid_CoeffsDt( PIDController* c, PIDValue dt, PIDCoeffs* C )
+{
+	C->Cp	= c->C.Cp;
+	C->Cdf	= c->C.Cdf;
+#ifdef PID_FIXPOINT
+	C->Ci	= (PIDValue)((c->KiDt*dt)/PID_DT_SCALE);
+#else
+	C->Ci	= c->KiDt*dt;
+#endif
+	if ( dt != c->DtLast )
+	{
+		c->CdLast = c->KdNum/dt;
+		c->DtLast = dt;
+	}
+	C->Cd	= c->CdLast;
+
+	/* The filter of the D-part vanishes if dt exceeds Tf */
+	if ( c->Tf <= dt )
+	{
+		C->Cf = 0;
+	}
+	else
+	{
+#ifdef PID_FIXPOINT
+		C->Cf = (PIDValue)(((c->Tf - dt)*c->TfInv)/PID_DT_SCALE);
+#else
+		C->Cf = (c->Tf - dt)*c->TfInv;
+#endif
+	}
+}
+
+
+
+PIDErr pid_StepDt( PIDInd id, PIDValue e, PIDValue dt, PIDValue* y )
+{
+	PIDCoeffs C;
+
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+	if ( dt <= 0 )                   return pidErr_TSample;
+#endif
+
+	/* The sample time of the parameters uses their coefficients, so 
+	   that the results are the ones of pid_Step
+	*/
+	if ( dt == PID_TSAMPLE(&PID[id]) )
+	{
+		pid_Kernel(&PID[id], &PID[id].C, e);
+	}
+	else
+	{
+		pid_CoeffsDt(&PID[id], dt, &C);
+		pid_Kernel(&PID[id], &C, e);
+	}
+
+	/* Assign the return value */
+	*y = PID[id].y[0];
+
+	return pidErr_Ok;
+}
+
+
+
+/* Steps the controller id over a block of n samples. The controller is
+   copied into a local variable so that the compiler can keep its state 
+   in registers, and written back after the last sample. P, I, and D may
+   be NULL.
+*/
+static PID_INLINE void pid_Block( PIDInd id, const PIDValue e[], PIDValue y[], 
+								  PIDValue P[], PIDValue I[], PIDValue D[], size_t n )
+{
+	PIDController c = PID[id];
+	size_t k;
+
+	for (k = 0; k < n; k++)
+	{
+		pid_Kernel(&c, &c.C, e[k]);
+		y[k] = c.y[0];
+		if (P != 0) P[k] = c.P;
+		if (I != 0) I[k] = c.I;
+		if (D != 0) D[k] = c.D;
+	}
+
+	PID[id] = c;
+}
+
+
+
+/* Steps the controller id over a block of samples */
+PIDErr pid_StepBlock( PIDInd id, const PIDValue e[], PIDValue y[], size_t n )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
+
+	pid_Block(id, e, y, 0, 0, 0, n);
+
+	return pidErr_Ok;
+}
+
+
+
+/* Steps the controller id over a block of samples and returns the parts */
+PIDErr pid_StepBlockParts( PIDInd id, const PIDValue e[], PIDValue y[], 
+						   PIDValue P[], PIDValue I[], PIDValue D[], size_t n )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
+
+	pid_Block(id, e, y, P, I, D, n);
+
+	return pidErr_Ok;
+}
+
+
+
+/* Copies the state of controller c to st */
+static PID_INLINE void pid_StateCopyTo( const PIDController* c, PIDState* st )
+{
+	st->e[0] = c->e[0];
+	st->e[1] = c->e[1];
+	st->y[0] = c->y[0];
+	st->y[1] = c->y[1];
+	st->P    = c->P;
+	st->I    = c->I;
+	st->D    = c->D;
+#ifdef PID_INTEGRATOR_COMPENSATED
+	st->Ic   = c->Ic;
+#endif
+}
+
+
+
+/* Copies the state st to controller c */
+static PID_INLINE void pid_StateCopyFrom( PIDController* c, const PIDState* st )
+{
+	c->e[0] = st->e[0];
+	c->e[1] = st->e[1];
+	c->y[0] = st->y[0];
+	c->y[1] = st->y[1];
+	c->P    = st->P;
+	c->I    = st->I;
+	c->D    = st->D;
+#ifdef PID_INTEGRATOR_COMPENSATED
+	c->Ic   = st->Ic;
+#endif
+}
+
+
+
+/* Steps a block of samples on a state kept outside of the controller */
+PIDErr pid_StepBlockState( PIDInd id, PIDState* st, const PIDValue e[], PIDValue y[], size_t n )
+{
+	PIDController c;
+	size_t k;
+
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
+
+	c = PID[id];
+	pid_StateCopyFrom(&c, st);
+#ifdef PID_FLIGHT_RECORDER
+	/* The steps on a separate state are not recorded */
+	c.Rec = NULL;
+#endif
+	for (k = 0; k < n; k++)
+	{
+		pid_Kernel(&c, &c.C, e[k]);
+		y[k] = c.y[0];
+	}
+	pid_StateCopyTo(&c, st);
+
+	return pidErr_Ok;
+}
+
+
+
+/* Returns the state of controller id */
+PIDErr pid_StateGet( PIDInd id, PIDState* st )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
+
+	pid_StateCopyTo(&PID[id], st);
+
+	return pidErr_Ok;
+}
+
+
+
+/* Sets the state of controller id */
+PIDErr pid_StateSet( PIDInd id, const PIDState* st )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
+
+	pid_StateCopyFrom(&PID[id], st);
+
+	return pidErr_Ok;
+}
+
+
+
+/* Returns the coefficients of controller id */
+PIDErr pid_CoeffsGet( PIDInd id, PIDCoeffs* C )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
+
+	*C = PID[id].C;
+
+	return pidErr_Ok;
+}
+
+
+
+/* Type of the products of the interpolation. With fixpoint arithmetic
+   the difference of two coefficients times the weight w < 
+   PID_FIXPOINT_FACTOR needs more than the width of PIDValue.
+*/
+#ifdef PID_FIXPOINT
+#if (defined PID_VAL_FORMAT_I64) && (defined __SIZEOF_INT128__)
+typedef __int128 PIDSchedProduct;
+#else
+typedef int64_t PIDSchedProduct;
+#endif
+#else
+typedef PIDValue PIDSchedProduct;
+#endif
+
+/* a + w*(b - a) for the weight w scaled by PID_FIXPOINT_FACTOR */
+#define PID_SCHED_LERP(a, b, w) \
+	((a) + (PIDValue)(((PIDSchedProduct)(w)*((PIDSchedProduct)(b) - (a))) PID_FIXPOINT_CORR_MUL))
+
+/* Interpolates the coefficients of the schedule S linearly at the
+   operating point s. Outside of the table the first or last block
+   is used.
+*/
+static PID_INLINE void pid_ScheduleEval( const PIDSchedule* S, PIDValue s, PIDCoeffs* C )
+{
+	const PIDCoeffs* a;
+	const PIDCoeffs* b;
+	uint32_t k;
+	PIDValue w;
+#ifdef PID_FIXPOINT
+	/* Position in the table times PID_FIXPOINT_FACTOR */
+	int64_t pos    = ((int64_t)(s - S->sMin)*((int64_t)(S->Num - 1)*PID_FIXPOINT_FACTOR))/S->Span;
+	int64_t posMax = (int64_t)(S->Num - 1)*PID_FIXPOINT_FACTOR;
+
+	pos = (pos > 0) ? pos : 0;
+	pos = (pos < posMax) ? pos : posMax;
+	k   = (uint32_t)(pos/PID_FIXPOINT_FACTOR);
+	k   = (k < S->Num - 2) ? k : S->Num - 2;
+	w   = (PIDValue)(pos - (int64_t)k*PID_FIXPOINT_FACTOR);
+#else
+	/* Position in the table, NaN is mapped to the first block */
+	PIDValue pos    = (s - S->sMin)*S->Scale;
+	PIDValue posMax = (PIDValue)(S->Num - 1);
+
+	pos = (pos > 0) ? pos : 0;
+	pos = (pos < posMax) ? pos : posMax;
+	k   = (uint32_t)pos;
+	k   = (k < S->Num - 2) ? k : S->Num - 2;
+	w   = pos - (PIDValue)k;
+#endif
+
+	a = &S->Coeffs[k];
+	b = a + 1;
+	C->Cp  = PID_SCHED_LERP(a->Cp,  b->Cp,  w);
+	C->Ci  = PID_SCHED_LERP(a->Ci,  b->Ci,  w);
+	C->Cd  = PID_SCHED_LERP(a->Cd,  b->Cd,  w);
+	C->Cdf = PID_SCHED_LERP(a->Cdf, b->Cdf, w);
+	C->Cf  = PID_SCHED_LERP(a->Cf,  b->Cf,  w);
+}
+
+
+
+/* Initializes a gain schedule */
+PIDErr pid_ScheduleInit( PIDSchedule* S, const PIDCoeffs* Coeffs, uint32_t Num, PIDValue sMin, PIDValue sMax )
+{
+	uint32_t k;
+
+	if ( (Coeffs == 0) || (Num < 2) || (sMax <= sMin) ) return pidErr_Schedule;
+
+	/* The step switches between the D-part with and without filter at
+	   Cf = 0, so an interpolation between both would make it jump
+	*/
+	for (k = 1; k < Num; k++)
+	{
+		if ( (Coeffs[k].Cf == 0) != (Coeffs[0].Cf == 0) ) return pidErr_Schedule;
+	}
+
+#ifdef PID_FIXPOINT
+	/* The wide sum of the D-filter stays in range for these Cf only */
+	for (k = 0; k < Num; k++)
+	{
+		if ( (Coeffs[k].Cf < 0) || (Coeffs[k].Cf > PID_FIXPOINT_FACTOR) ) return pidErr_Schedule;
+	}
+#endif
+
+	S->Coeffs = Coeffs;
+	S->Num    = Num;
+	S->sMin   = sMin;
+#ifdef PID_FIXPOINT
+	S->Span   = sMax - sMin;
+#else
+	S->Scale  = (PIDValue)(Num - 1)/(sMax - sMin);
+#endif
+
+	return pidErr_Ok;
+}
+
+
+
+/* Assigns the gain schedule S to the controller with index id */
+PIDErr pid_ScheduleSet( PIDInd id, const PIDSchedule* S )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+	if ( (S != 0) && (S->Num < 2) )  return pidErr_Schedule;
+#endif
+
+	PID[id].Sched = S;
+
+	return pidErr_Ok;
+}
+
+
+
+/* One step of calculation with scheduled coefficients */
+PIDErr pid_StepSched( PIDInd id, PIDValue s, PIDValue e, PIDValue* y )
+{
+	PIDCoeffs C;
+
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
+
+	if ( PID[id].Sched == 0 )
+	{
+		pid_Kernel(&PID[id], &PID[id].C, e);
+	}
+	else
+	{
+		pid_ScheduleEval(PID[id].Sched, s, &C);
+		pid_Kernel(&PID[id], &C, e);
+	}
+
+	*y = PID[id].y[0];
+
+	return pidErr_Ok;
+}
+
+
+
+/* Steps the controllers first, ..., first+n-1 with scheduled coefficients */
+PIDErr pid_StepSchedBank( PIDInd first, PIDInd n, const PIDValue s[], const PIDValue e[], PIDValue y[] )
+{
+	PIDCoeffs C;
+	PIDController* c;
+	PIDInd i;
+
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( (first >= PID_NUM_CONTROLLERS) || (n > PID_NUM_CONTROLLERS - first) ) return pidErr_Index;
+#endif
+
+	for (i = 0; i < n; i++)
+	{
+		c = &PID[first + i];
+		if ( c->Sched == 0 )
+		{
+			pid_Kernel(c, &c->C, e[i]);
+		}
+		else
+		{
+			pid_ScheduleEval(c->Sched, s[i], &C);
+			pid_Kernel(c, &C, e[i]);
+		}
+		y[i] = c->y[0];
+	}
+
+	return pidErr_Ok;
+}
+ 
+
+
+/* Loops of the batched steps with the kernel inlined */
+static PID_FORCE_INLINE void pid_StepBankLoop( PIDInd first, PIDInd n, const PIDValue e[], PIDValue y[] )
+{
+	PIDController* c;
+	PIDInd i;
+
+	for (i = 0; i < n; i++)
+	{
+		c = &PID[first + i];
+		pid_Kernel(c, &c->C, e[i]);
+		y[i] = c->y[0];
+	}
+}
+
+/* Value of the exported part of controller c */
+static PID_FORCE_INLINE PIDValue pid_ExportValue( const PIDController* c, PIDExportPart Part )
+{
+	switch ( Part )
+	{
+	case pidExp_P:	return c->P;
+	case pidExp_I:	return c->I;
+	case pidExp_D:	return c->D;
+	default:		return c->y[0];
+	}
+}
+
+/* Tests if v moved more than b away from l. Integer differences are 
+   formed in 64 bit unsigned arithmetic, which cannot overflow.
+*/
+#ifdef PID_FIXPOINT
+#define PID_EXPORT_MOVED(v, l, b) \
+	((((v) > (l)) ? (uint64_t)(v) - (uint64_t)(l) : (uint64_t)(l) - (uint64_t)(v)) > (uint64_t)(b))
+#else
+#define PID_EXPORT_MOVED(v, l, b) \
+	((((v) - (l)) > (b)) | (((l) - (v)) > (b)))
+#endif
+
+static PID_FORCE_INLINE void pid_StepBankExportLoop( PIDInd first, PIDInd n, const PIDValue e[], PIDValue y[], 
+													 PIDExport* X )
+{
+	PIDController* c;
+	PIDValue v;
+	uint32_t k;
+	PIDInd i;
+
+	for (i = 0; i < n; i++)
+	{
+		c = &PID[first + i];
+		pid_Kernel(c, &c->C, e[i]);
+		y[i] = c->y[0];
+
+		/* Mark the controller without a jump */
+		k = (uint32_t)(first + i - X->First);
+		v = pid_ExportValue(c, X->Part);
+		X->Dirty[k/64] |= (uint64_t)PID_EXPORT_MOVED(v, X->Last[k], X->Band[k]) << (k%64);
+	}
+}
+
+static PID_FORCE_INLINE void pid_StepBankStatsLoop( PIDInd first, PIDInd n, const PIDValue e[], PIDValue y[], 
+													PIDStats S[], PIDStatValue Alpha )
+{
+	PIDController* c;
+	PIDStats* st;
+	PIDStatValue x, d;
+	PIDInd i;
+
+	for (i = 0; i < n; i++)
+	{
+		c  = &PID[first + i];
+		st = &S[i];
+		pid_Kernel(c, &c->C, e[i]);
+		y[i] = c->y[0];
+
+		/* Update the statistics while the controller is in the cache */
+		x = (PIDStatValue)e[i];
+		st->Count++;
+		d = x - st->Mean;
+		st->Mean += d/(PIDStatValue)st->Count;
+		st->M2	 += d*(x - st->Mean);
+		st->MeanSq += Alpha*(x*x - st->MeanSq);
+		st->Sat	 += PID_HAS_LIMITS(c) & ((c->y[0] == c->yMax) | (c->y[0] == c->yMin));
+		if ( c->I < st->IMin ) st->IMin = c->I;
+		if ( c->I > st->IMax ) st->IMax = c->I;
+	}
+}
+
+
+
+PIDErr pid_StepBank( PIDInd first, PIDInd n, const PIDValue e[], PIDValue y[] )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( (first >= PID_NUM_CONTROLLERS) || (n > PID_NUM_CONTROLLERS - first) ) return pidErr_Index;
+#endif
+
+	pid_StepBankLoop(first, n, e, y);
+
+	return pidErr_Ok;
+}
+
+
+
+PIDErr pid_StepBankStats( PIDInd first, PIDInd n, const PIDValue e[], PIDValue y[], 
+						  PIDStats S[], PIDStatValue Alpha )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( (first >= PID_NUM_CONTROLLERS) || (n > PID_NUM_CONTROLLERS - first) ) return pidErr_Index;
+#endif
+
+	pid_StepBankStatsLoop(first, n, e, y, S, Alpha);
+
+	return pidErr_Ok;
+}
+
+
+
+PIDErr pid_StepBankExport( PIDInd first, PIDInd n, const PIDValue e[], PIDValue y[], PIDExport* X )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( (first >= PID_NUM_CONTROLLERS) || (n > PID_NUM_CONTROLLERS - first) ) return pidErr_Index;
+	if ( (first < X->First) || ((unsigned long)first + n > (unsigned long)X->First + X->Num) ) return pidErr_Index;
+#endif
+
+	pid_StepBankExportLoop(first, n, e, y, X);
+
+	return pidErr_Ok;
+}
+
+
+
+/* Number of controllers stepped by pid_StepStrided per pass. The values
+   of a pass are gathered into and scattered from arrays on the stack, 
+   so the conversion is done by one loop per type.
+*/
+#define PID_IO_CHUNK 64
+
+/* Converts m values of the type T at p, p+s, ... to PIDValue. For the
+   fixpoint formats the integers saturate to the range of PIDValue, all
+   input types fit into int64_t. The floating point values saturate as 
+   well, NaN is converted to 0. Values >= the first value above the range
+   give PID_VAL_MAX, it is exact in double unlike PID_VAL_MAX of I64.
+*/
+#define PID_IO_GATHER(T) \
+	for (j = 0; j < m; j++, p += s) v[j] = (PIDValue)*(const T*)p; \
+	break
+#ifdef PID_FIXPOINT
+#define PID_IO_VAL_TOP ((double)(PID_VAL_MAX/2 + 1)*2)
+#define PID_IO_GATHER_INT(T) \
+	for (j = 0; j < m; j++, p += s) \
+	{ \
+		x = (int64_t)*(const T*)p; \
+		v[j] = (x > (int64_t)PID_VAL_MAX) ? PID_VAL_MAX : ((x < (int64_t)PID_VAL_MIN) ? PID_VAL_MIN : (PIDValue)x); \
+	} \
+	break
+#define PID_IO_GATHER_FLOAT(T) \
+	for (j = 0; j < m; j++, p += s) \
+	{ \
+		d = (double)*(const T*)p; \
+		v[j] = (d >= PID_IO_VAL_TOP) ? PID_VAL_MAX : \
+			   ((d >= (double)PID_VAL_MIN) ? (PIDValue)d : ((d < (double)PID_VAL_MIN) ? PID_VAL_MIN : 0)); \
+	} \
+	break
+#else
+#define PID_IO_GATHER_INT(T)	PID_IO_GATHER(T)
+#define PID_IO_GATHER_FLOAT(T)	PID_IO_GATHER(T)
+#endif
+
+/* Converts m values to the type T at p, p+s, ..., saturating to the 
+   range lo, ..., hi of an integer type. Values >= top, the first value
+   above the range, give hi: top is exact in double for all types, hi is
+   not for int64_t. NaN is converted to 0.
+*/
+#define PID_IO_SCATTER(T) \
+	for (j = 0; j < m; j++, p += s) *(T*)p = (T)v[j]; \
+	break
+#define PID_IO_SCATTER_SAT(T, lo, hi, top) \
+	for (j = 0; j < m; j++, p += s) \
+		*(T*)p = ((double)v[j] >= (top)) ? (T)(hi) : \
+				 (((double)v[j] >= (double)(lo)) ? (T)v[j] : (((double)v[j] < (double)(lo)) ? (T)(lo) : 0)); \
+	break
+
+static void pid_IoGather( PIDValue v[], const char* p, ptrdiff_t s, PIDIoType t, PIDInd m )
+{
+	PIDInd j;
+#ifdef PID_FIXPOINT
+	int64_t x;
+	double d;
+#endif
+
+	switch ( t )
+	{
+	case pidIo_I8:	PID_IO_GATHER_INT(int8_t);
+	case pidIo_I16:	PID_IO_GATHER_INT(int16_t);
+	case pidIo_I32:	PID_IO_GATHER_INT(int32_t);
+	case pidIo_I64:	PID_IO_GATHER_INT(int64_t);
+	case pidIo_U8:	PID_IO_GATHER_INT(uint8_t);
+	case pidIo_U16:	PID_IO_GATHER_INT(uint16_t);
+	case pidIo_U32:	PID_IO_GATHER_INT(uint32_t);
+	case pidIo_F32:	PID_IO_GATHER_FLOAT(float);
+	case pidIo_F64:	PID_IO_GATHER_FLOAT(double);
+	default:		PID_IO_GATHER(PIDValue);
+	}
+}
+
+static void pid_IoScatter( const PIDValue v[], char* p, ptrdiff_t s, PIDIoType t, PIDInd m )
+{
+	PIDInd j;
+
+	switch ( t )
+	{
+	case pidIo_I8:	PID_IO_SCATTER_SAT(int8_t, INT8_MIN, INT8_MAX, INT8_MAX + 1.0);
+	case pidIo_I16:	PID_IO_SCATTER_SAT(int16_t, INT16_MIN, INT16_MAX, INT16_MAX + 1.0);
+	case pidIo_I32:	PID_IO_SCATTER_SAT(int32_t, INT32_MIN, INT32_MAX, INT32_MAX + 1.0);
+	case pidIo_U8:	PID_IO_SCATTER_SAT(uint8_t, 0, UINT8_MAX, UINT8_MAX + 1.0);
+	case pidIo_U16:	PID_IO_SCATTER_SAT(uint16_t, 0, UINT16_MAX, UINT16_MAX + 1.0);
+	case pidIo_U32:	PID_IO_SCATTER_SAT(uint32_t, 0, UINT32_MAX, UINT32_MAX + 1.0);
+#ifdef PID_FIXPOINT
+	case pidIo_I64:	PID_IO_SCATTER(int64_t);
+#else
+	case pidIo_I64:	PID_IO_SCATTER_SAT(int64_t, INT64_MIN, INT64_MAX, 9223372036854775808.0);
+#endif
+	case pidIo_F32:	PID_IO_SCATTER(float);
+	case pidIo_F64:	PID_IO_SCATTER(double);
+	default:		PID_IO_SCATTER(PIDValue);
+	}
+}
+
+
+
+PIDErr pid_StepStrided( PIDInd first, PIDInd n, const PIDStrided* e, const PIDStrided* y )
+{
+	PIDValue v[PID_IO_CHUNK];
+	PIDController* c;
+	const char* pe = (const char*)e->Base;
+	char* py = (char*)y->Base;
+	PIDInd i, j, m;
+
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( (first >= PID_NUM_CONTROLLERS) || (n > PID_NUM_CONTROLLERS - first) ) return pidErr_Index;
+#endif
+
+	for (i = 0; i < n; i += m)
+	{
+		m = (n - i < PID_IO_CHUNK) ? n - i : PID_IO_CHUNK;
+		pid_IoGather(v, pe, e->Stride, e->Type, m);
+		for (j = 0; j < m; j++)
+		{
+			c = &PID[first + i + j];
+			pid_Kernel(c, &c->C, v[j]);
+			v[j] = c->y[0];
+		}
+		pid_IoScatter(v, py, y->Stride, y->Type, m);
+		pe += m*e->Stride;
+		py += m*y->Stride;
+	}
+
+	return pidErr_Ok;
+}
+
+
+
+/* Converts m values of the type T at p, p+s, ... to double */
+#define PID_IO_GATHER_DOUBLE(T) \
+	for (j = 0; j < m; j++, p += s) v[j] = (double)*(const T*)p; \
+	break
+
+static void pid_IoGatherDouble( double v[], const char* p, ptrdiff_t s, PIDIoType t, PIDInd m )
+{
+	PIDInd j;
+
+	switch ( t )
+	{
+	case pidIo_I8:	PID_IO_GATHER_DOUBLE(int8_t);
+	case pidIo_I16:	PID_IO_GATHER_DOUBLE(int16_t);
+	case pidIo_I32:	PID_IO_GATHER_DOUBLE(int32_t);
+	case pidIo_I64:	PID_IO_GATHER_DOUBLE(int64_t);
+	case pidIo_U8:	PID_IO_GATHER_DOUBLE(uint8_t);
+	case pidIo_U16:	PID_IO_GATHER_DOUBLE(uint16_t);
+	case pidIo_U32:	PID_IO_GATHER_DOUBLE(uint32_t);
+	case pidIo_F32:	PID_IO_GATHER_DOUBLE(float);
+	case pidIo_F64:	PID_IO_GATHER_DOUBLE(double);
+	default:		PID_IO_GATHER_DOUBLE(PIDValue);
+	}
+}
+
+
+
+size_t pid_InputMemSize( PIDInd Num )
+{
+	return 5*(size_t)Num*sizeof(double);
+}
+
+
+
+PIDErr pid_InputInit( PIDInput* V, void* Mem, PIDInd First, PIDInd Num )
+{
+	PIDInd k;
+
+	if ( (unsigned long)First + Num > PID_NUM_CONTROLLERS ) return pidErr_Index;
+	if ( ((size_t)Mem % sizeof(double)) != 0 )				 return pidErr_Memory;
+
+	V->First	= First;
+	V->Num		= Num;
+	V->Gain		= (double*)Mem;
+	V->Offset	= V->Gain + Num;
+	V->Alpha	= V->Offset + Num;
+	V->Setpoint = V->Alpha + Num;
+	V->xf		= V->Setpoint + Num;
+
+	for (k = 0; k < Num; k++)
+	{
+		V->Gain[k]	   = 1;
+		V->Offset[k]   = 0;
+		V->Alpha[k]	   = 1;
+		V->Setpoint[k] = 0;
+		V->xf[k]	   = 0;
+	}
+
+	return pidErr_Ok;
+}
+
+
+
+PIDErr pid_InputSet( PIDInput* V, PIDInd id, double Gain, double Offset, double Alpha, double Setpoint )
+{
+	PIDInd k;
+
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( (id < V->First) || (id - V->First >= V->Num) ) return pidErr_Index;
+#endif
+
+	k = id - V->First;
+	V->Gain[k]	   = Gain;
+	V->Offset[k]   = Offset;
+	V->Alpha[k]	   = Alpha;
+	V->Setpoint[k] = Setpoint;
+	V->xf[k]	   = Setpoint;
+
+	return pidErr_Ok;
+}
+
+
+
+/* Input stages of m controllers: calibration, prefilter and control
+   difference in one loop without jumps. The arrays of the stages do
+   not overlap, so the compiler does not reload them after the stores 
+   to xf. NaN (e.g. of a NaN setpoint) gives 0, the test is stored to
+   an int and done after the conversion to keep it a select. Called with m = PID_IO_CHUNK the loop is
+   vectorized by GCC at -O2 for the floating point formats (checked with
+   -fopt-info-vec).
+*/
+static PID_FORCE_INLINE void pid_InputRun( const double* PID_RESTRICT Gain, const double* PID_RESTRICT Offset,
+										   const double* PID_RESTRICT Alpha, double* PID_RESTRICT xf,
+										   const double* PID_RESTRICT x, const double* PID_RESTRICT sp,
+										   PIDValue* PID_RESTRICT v, PIDInd m )
+{
+	double xc;
+#ifdef PID_FIXPOINT
+	double ev;
+#else
+	PIDValue vv;
+#endif
+	int nan;
+	PIDInd j;
+
+	for (j = 0; j < m; j++)
+	{
+		xc = Gain[j]*x[j] + Offset[j];
+		xf[j] = Alpha[j]*xc + (1 - Alpha[j])*xf[j];
+#ifdef PID_FIXPOINT
+		ev = (sp[j] - xf[j])*PID_FIXPOINT_FACTOR;
+		nan = (ev != ev);
+		ev = nan ? 0 : ev;
+#if (defined PID_VAL_FORMAT_I64)
+		/* 2^63 is exact in double, INT64_MAX is not */
+		ev = (ev < -9223372036854775808.0) ? -9223372036854775808.0 : ev;
+		v[j] = (ev >= 9223372036854775808.0) ? PID_VAL_MAX : (PIDValue)ev;
+#else
+		ev = (ev < (double)PID_VAL_MIN) ? (double)PID_VAL_MIN : ev;
+		v[j] = (PIDValue)((ev > (double)PID_VAL_MAX) ? (double)PID_VAL_MAX : ev);
+#endif
+#else
+		vv  = (PIDValue)(sp[j] - xf[j]);
+		nan = (vv != vv);
+		v[j] = nan ? 0 : vv;
+#endif
+	}
+}
+
+
+
+PIDErr pid_StepBankRaw( PIDInd first, PIDInd n, const PIDStrided* Raw, const PIDStrided* w, 
+						PIDInput* V, PIDValue y[] )
+{
+	double x[PID_IO_CHUNK], sp[PID_IO_CHUNK];
+	PIDValue v[PID_IO_CHUNK];
+	PIDController* c;
+	const char* pr = (const char*)Raw->Base;
+	const char* pw = (w != NULL) ? (const char*)w->Base : NULL;
+	PIDInd i, j, m, k;
+
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( (first >= PID_NUM_CONTROLLERS) || (n > PID_NUM_CONTROLLERS - first) ) return pidErr_Index;
+	if ( (first < V->First) || ((unsigned long)first + n > (unsigned long)V->First + V->Num) ) return pidErr_Index;
+#endif
+
+	for (i = 0; i < n; i += m)
+	{
+		m = (n - i < PID_IO_CHUNK) ? n - i : PID_IO_CHUNK;
+		k = first - V->First + i;
+		pid_IoGatherDouble(x, pr, Raw->Stride, Raw->Type, m);
+		if ( pw != NULL )
+		{
+			pid_IoGatherDouble(sp, pw, w->Stride, w->Type, m);
+			pw += m*w->Stride;
+		}
+
+		/* full chunks with a constant number of controllers */
+		if ( m == PID_IO_CHUNK )
+		{
+			pid_InputRun(&V->Gain[k], &V->Offset[k], &V->Alpha[k], &V->xf[k], x, 
+						 (pw != NULL) ? sp : &V->Setpoint[k], v, PID_IO_CHUNK);
+		}
+		else
+		{
+			pid_InputRun(&V->Gain[k], &V->Offset[k], &V->Alpha[k], &V->xf[k], x, 
+						 (pw != NULL) ? sp : &V->Setpoint[k], v, m);
+		}
+
+		for (j = 0; j < m; j++)
+		{
+			c = &PID[first + i + j];
+			pid_Kernel(c, &c->C, v[j]);
+			y[i + j] = c->y[0];
+		}
+		pr += m*Raw->Stride;
+	}
+
+	return pidErr_Ok;
+}
+
+
+
+void pid_StatsReset( PIDStats S[], PIDInd n )
+{
+	PIDInd i;
+
+	for (i = 0; i < n; i++)
+	{
+		S[i].Count	= 0;
+		S[i].Sat	= 0;
+		S[i].Mean	= 0;
+		S[i].M2		= 0;
+		S[i].MeanSq	= 0;
+		S[i].IMin	= PID_VAL_MAX;
+		S[i].IMax	= PID_VAL_MIN;
+	}
+}
+
+
+
+void pid_StatsRead( const PIDStats S[], PIDInd n, PIDStatsValues V[] )
+{
+	PIDInd i;
+
+	for (i = 0; i < n; i++)
+	{
+		V[i].Count	 = S[i].Count;
+		V[i].Mean	 = S[i].Mean;
+		V[i].Var	 = (S[i].Count > 1) ? S[i].M2/(PIDStatValue)(S[i].Count - 1) : 0;
+		V[i].MeanSq	 = S[i].MeanSq;
+		V[i].SatFrac = (S[i].Count > 0) ? (PIDStatValue)S[i].Sat/(PIDStatValue)S[i].Count : 0;
+		V[i].IMin	 = S[i].IMin;
+		V[i].IMax	 = S[i].IMax;
+	}
+}
+
+
+
+/* The bitmap is placed first to align it for any PIDValue type */
+size_t pid_ExportMemSize( PIDInd Num )
+{
+	return ((size_t)Num + 63)/64*sizeof(uint64_t) + 2*(size_t)Num*sizeof(PIDValue);
+}
+
+
+
+PIDErr pid_ExportInit( PIDExport* X, void* Mem, PIDInd First, PIDInd Num, PIDExportPart Part, PIDValue Band )
+{
+	size_t Words = ((size_t)Num + 63)/64, k;
+
+	if ( (unsigned long)First + Num > PID_NUM_CONTROLLERS ) return pidErr_Index;
+	if ( ((size_t)Mem % sizeof(uint64_t)) != 0 )			 return pidErr_Memory;
+
+	X->First = First;
+	X->Num	 = Num;
+	X->Part	 = Part;
+	X->Dirty = (uint64_t*)Mem;
+	X->Last	 = (PIDValue*)(X->Dirty + Words);
+	X->Band	 = X->Last + Num;
+
+	/* All controllers are exported by the first pid_ExportCollect */
+	for (k = 0; k < Num; k++)
+	{
+		X->Last[k] = 0;
+		X->Band[k] = Band;
+	}
+	for (k = 0; k < Words; k++)
+		X->Dirty[k] = ~(uint64_t)0;
+	if ( (Num % 64) != 0 )
+		X->Dirty[Words - 1] = ((uint64_t)1 << (Num % 64)) - 1;
+
+	return pidErr_Ok;
+}
+
+
+
+PIDErr pid_ExportBandSet( PIDExport* X, PIDInd id, PIDValue Band )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( (id < X->First) || (id - X->First >= X->Num) ) return pidErr_Index;
+#endif
+
+	X->Band[id - X->First] = Band;
+
+	return pidErr_Ok;
+}
+
+
+
+PIDErr pid_ExportMark( PIDExport* X, PIDInd first, PIDInd n )
+{
+	PIDValue v;
+	uint32_t k;
+	PIDInd i;
+
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( (first < X->First) || ((unsigned long)first + n > (unsigned long)X->First + X->Num) ) return pidErr_Index;
+#endif
+
+	for (i = first; i < first + n; i++)
+	{
+		k = (uint32_t)(i - X->First);
+		v = pid_ExportValue(&PID[i], X->Part);
+		X->Dirty[k/64] |= (uint64_t)PID_EXPORT_MOVED(v, X->Last[k], X->Band[k]) << (k%64);
+	}
+
+	return pidErr_Ok;
+}
+
+
+
+size_t pid_ExportCollect( PIDExport* X, PIDExportEntry Out[], size_t Max )
+{
+	size_t Words = ((size_t)X->Num + 63)/64, w, m = 0;
+	uint64_t b;
+	uint32_t k;
+
+	/* Only the set bits are visited, empty words cost one test */
+	for (w = 0; (w < Words) && (m < Max); w++)
+	{
+		for (b = X->Dirty[w]; (b != 0) && (m < Max); b &= b - 1)
+		{
+			k = (uint32_t)(w*64 + pid_Ctz64(b));
+			Out[m].Id	 = (PIDInd)(X->First + k);
+			Out[m].Value = pid_ExportValue(&PID[X->First + k], X->Part);
+			X->Last[k]	 = Out[m].Value;
+			m++;
+		}
+		X->Dirty[w] = b;
+	}
+
+	return m;
+}
+
+
+
+/* Layout of the memory of an event-triggered step: the bitmap first to
+   align it for any PIDValue type */
+size_t pid_EventMemSize( PIDInd Num )
+{
+	return 2*(((size_t)Num + 63)/64)*sizeof(uint64_t) + 2*(size_t)Num*sizeof(PIDValue) + (size_t)Num*sizeof(uint16_t);
+}
+
+
+
+PIDErr pid_EventInit( PIDEvent* V, void* Mem, PIDInd First, PIDInd Num, PIDValue Thr, uint16_t MaxSkip )
+{
+	size_t Words = ((size_t)Num + 63)/64, k;
+
+	if ( (unsigned long)First + Num > PID_NUM_CONTROLLERS ) return pidErr_Index;
+	if ( ((size_t)Mem % sizeof(uint64_t)) != 0 )			 return pidErr_Memory;
+
+	V->First   = First;
+	V->Num	   = Num;
+	V->MaxSkip = MaxSkip;
+	V->Active  = (uint64_t*)Mem;
+	V->Quiet   = V->Active + Words;
+	V->eHeld   = (PIDValue*)(V->Quiet + Words);
+	V->Thr	   = V->eHeld + Num;
+	V->Skipped = (uint16_t*)(V->Thr + Num);
+	V->Steps   = 0;
+	V->Skips   = 0;
+	V->Forced  = 0;
+
+	for (k = 0; k < Words; k++)
+	{
+		V->Active[k] = 0;
+		V->Quiet[k]	 = 0;
+	}
+	for (k = 0; k < Num; k++)
+	{
+		V->eHeld[k]	  = PID[First + k].e[0];
+		V->Thr[k]	  = Thr;
+		V->Skipped[k] = 0;
+	}
+
+	return pidErr_Ok;
+}
+
+
+
+PIDErr pid_EventThrSet( PIDEvent* V, PIDInd id, PIDValue Thr )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( (id < V->First) || (id - V->First >= V->Num) ) return pidErr_Index;
+#endif
+
+	V->Thr[id - V->First] = Thr;
+
+	return pidErr_Ok;
+}
+
+
+
+/* Applies s skipped steps with the held control difference e[0] to 
+   controller c: P is unchanged, the I-part grows by s increments, and
+   the D-part decays with Cf^s (it is 0 without filter). Cf^s is formed
+   by repeated squaring, so pidcontrol.c needs no math library. If anti-windup
+   could have stopped the I-part during these steps, i.e. if the output
+   may have reached a limit, the steps are repeated one by one.
+*/
+static void pid_EventCatchUp( PIDController* c, PIDValue eh, uint32_t s )
+{
+	const PIDCoeffs* C = &c->C;
+	PIDValue dI, IOld = c->I, INew, DNew, DPrev;
+	uint32_t j;
+#ifdef PID_FIXPOINT_SATURATE
+	unsigned char Ovf = 0;
+#endif
+
+	/* Increment of the I-part per step */
+#if (defined PID_FIXPOINT_SATURATE) && (defined PID_INTALGO_RECT)
+	dI = pid_SatMul(C->Ci, eh, &Ovf);
+#elif (defined PID_FIXPOINT_SATURATE)
+	dI = pid_SatMul(C->Ci, pid_SatAdd(eh, eh, &Ovf), &Ovf);
+#elif (defined PID_INTALGO_RECT)
+	dI = (C->Ci*eh) PID_FIXPOINT_CORR_MUL;
+#else
+	dI = (C->Ci*(eh + eh)) PID_FIXPOINT_CORR_MUL;
+#endif
+#ifdef PID_FIXPOINT_SATURATE
+	INew = pid_SatNarrow((PIDWideValue)dI*s + c->I, &Ovf);
+#else
+	INew = c->I + (PIDValue)((int64_t)s*dI);
+#endif
+
+	/* D-part after s steps without change of e */
+	if ( C->Cf == 0 )
+	{
+		DNew = 0;
+	}
+	else
+	{
+#ifdef PID_FIXPOINT
+		/* The truncation of each product is reproduced, the loop ends
+		   when D does not change anymore */
+		DNew = c->D;
+		for (j = 0; j < s; j++)
+		{
+			DPrev = DNew;
+#ifdef PID_FIXPOINT_SATURATE
+			DNew  = pid_SatNarrow(((PIDWideValue)C->Cf*DNew) PID_FIXPOINT_CORR_MUL, &Ovf);
+#else
+			DNew  = (C->Cf*DNew) PID_FIXPOINT_CORR_MUL;
+#endif
+			if ( DNew == DPrev ) break;
+		}
+#else
+		/* Cf^s by repeated squaring */
+		DPrev = 1;
+		DNew  = C->Cf;
+		for (j = s; j > 0; j >>= 1)
+		{
+			if ( j & 1 ) DPrev *= DNew;
+			DNew *= DNew;
+		}
+		DNew = c->D*DPrev;
+#endif
+	}
+	(void)DPrev;
+
+	/* The output moves monotonically between the values before and after
+	   the skipped steps, check if it may have reached a limit */
+	if ( (c->Arw == pidArw_On) && PID_HAS_LIMITS(c) &&
+		 ( (c->P + ((INew > IOld) ? INew : IOld) + ((DNew > c->D) ? DNew : c->D) >= c->yMax) ||
+		   (c->P + ((INew < IOld) ? INew : IOld) + ((DNew < c->D) ? DNew : c->D) <= c->yMin) ) )
+	{
+		for (j = 0; j < s; j++)
+			pid_Kernel(c, C, eh);
+		return;
+	}
+
+#ifdef PID_INTEGRATOR_COMPENSATED
+	pid_IAdd(c, (PIDValue)((int64_t)s*dI));
+#else
+	c->I = INew;
+#endif
+	c->D	= DNew;
+	c->e[1] = eh;
+#ifdef PID_FIXPOINT_OVERFLOW_FLAG
+	c->Ovf |= Ovf;
+#endif
+}
+
+
+
+PIDErr pid_StepBankEvent( PIDInd first, PIDInd n, const PIDValue e[], PIDValue y[], PIDEvent* V )
+{
+	PIDController* c;
+	uint64_t b, Mask, Bit;
+	uint32_t k0, k, w, act, mov, Forced = 0, Active = 0;
+	PIDInd i;
+
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( (first >= PID_NUM_CONTROLLERS) || (n > PID_NUM_CONTROLLERS - first) ) return pidErr_Index;
+	if ( (first < V->First) || ((unsigned long)first + n > (unsigned long)V->First + V->Num) ) return pidErr_Index;
+#endif
+
+	/* Build the active set from the side arrays only, without touching
+	   the controllers. A controller is skipped only if its last step 
+	   was quiet as well, so that the D-part of a change of e has decayed
+	   (without filter) before the output is held.
+	*/
+	k0 = (uint32_t)(first - V->First);
+	for (i = 0; i < n; i++)
+	{
+		k	= k0 + i;
+		Bit = (uint64_t)1 << (k%64);
+		mov = PID_EXPORT_MOVED(e[i], V->eHeld[k], V->Thr[k]);
+		act = mov | ((V->Quiet[k/64] & Bit) == 0) | (V->Skipped[k] >= V->MaxSkip);
+		Forced += (V->Skipped[k] >= V->MaxSkip) & !mov;
+		V->Skipped[k] += (uint16_t)!act;
+		V->Active[k/64] = (V->Active[k/64] & ~Bit) | ((uint64_t)act << (k%64));
+		V->Quiet[k/64]	= (V->Quiet[k/64] & ~Bit) | ((uint64_t)!mov << (k%64));
+	}
+
+	/* Step the active controllers, catching up the skipped steps */
+	for (w = k0/64; w*64 < k0 + n; w++)
+	{
+		Mask = ~(uint64_t)0;
+		if ( w*64 < k0 )			Mask &= ~(uint64_t)0 << (k0 - w*64);
+		if ( (w + 1)*64 > k0 + n )	Mask &= ~(uint64_t)0 >> ((w + 1)*64 - (k0 + n));
+
+		for (b = V->Active[w] & Mask; b != 0; b &= b - 1)
+		{
+			k = w*64 + pid_Ctz64(b);
+			c = &PID[V->First + k];
+			if ( V->Skipped[k] != 0 )
+				pid_EventCatchUp(c, V->eHeld[k], V->Skipped[k]);
+			pid_Kernel(c, &c->C, e[k - k0]);
+			y[k - k0]	  = c->y[0];
+			V->eHeld[k]	  = e[k - k0];
+			V->Skipped[k] = 0;
+			Active++;
+		}
+	}
+
+	V->Steps  += Active;
+	V->Skips  += n - Active;
+	V->Forced += Forced;
+
+	return pidErr_Ok;
+}
+
+
+
+void pid_EventStatsRead( const PIDEvent* V, PIDEventStats* S )
+{
+	S->Steps	= V->Steps;
+	S->Skips	= V->Skips;
+	S->Forced	= V->Forced;
+	S->SkipFrac = (V->Steps + V->Skips > 0) ? (double)V->Skips/(double)(V->Steps + V->Skips) : 0;
+}
+
+
+
+#ifdef PID_OUTPUT_STAGE
+/* Attaches an output stage to controller id */
+PIDErr pid_OutStageSet( PIDInd id, const PIDOutStage* S )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
+
+	PID[id].Out = S;
+
+	return pidErr_Ok;
+}
+
+
+
+/* Applies the output stage S to the output of controller c after a step
+   and returns the actuator code. The slew-limited output is stored in
+   c->y[0], so the next step is limited from it. The differences are
+   formed in double, which cannot overflow. A NaN output gives the code
+   of the output 0.
+*/
+static PID_FORCE_INLINE int32_t pid_OutStage( PIDController* c, const PIDOutStage* S )
+{
+	PIDValue y = c->y[0];
+	double d, x;
+
+	if ( S->Slew > 0 )
+	{
+		d = (double)y - (double)c->y[1];
+		if ( d > (double)S->Slew )			y = c->y[1] + S->Slew;
+		else if ( d < -(double)S->Slew )	y = c->y[1] - S->Slew;
+		c->y[0] = y;
+	}
+
+	x = ( (y <= S->Band) && (y >= -S->Band) ) ? S->Offset : S->Gain*(double)y + S->Offset;
+	if ( x != x ) x = S->Offset;
+	x = (x < (double)S->uMin) ? (double)S->uMin : ((x > (double)S->uMax) ? (double)S->uMax : x);
+
+	/* Round half away from zero */
+	return (int32_t)((x < 0) ? x - 0.5 : x + 0.5);
+}
+
+
+
+PIDErr pid_StepBankOut( PIDInd first, PIDInd n, const PIDValue e[], PIDValue y[], int32_t u[] )
+{
+	PIDController* c;
+	unsigned char held;
+	double x;
+	PIDInd i;
+
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( (first >= PID_NUM_CONTROLLERS) || (n > PID_NUM_CONTROLLERS - first) ) return pidErr_Index;
+#endif
+
+	for (i = 0; i < n; i++)
+	{
+		c = &PID[first + i];
+		held = pid_KernelCalc(c, &c->C, e[i]);
+		if ( c->Out != NULL )
+		{
+			u[i] = pid_OutStage(c, c->Out);
+		}
+		else
+		{
+			x	 = (double)c->y[0];
+			u[i] = (x < INT32_MIN) ? INT32_MIN : ((x > INT32_MAX) ? INT32_MAX : ((x == x) ? (int32_t)x : 0));
+		}
+#ifdef PID_FLIGHT_RECORDER
+		/* The recorder sees the output applied to the actuator */
+		if ( c->Rec != NULL ) pid_Record(c, c->Rec, held);
+		c->Held = held;
+#else
+		(void)held;
+#endif
+		if ( y != NULL ) y[i] = c->y[0];
+	}
+
+	return pidErr_Ok;
+}
+#endif
+
+
+
+/* Sets the I-part of controller with index id to the value I */
+PIDErr pid_IPartSet( PIDInd id, PIDValue I )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
+	PID[id].I = I;
+#ifdef PID_INTEGRATOR_COMPENSATED
+	PID[id].Ic = 0;
+#endif
+
+	return pidErr_Ok;
 }
 
 
@@ -487,6 +2291,15 @@ PIDErr pid_Reset( PIDInd id )
 	PID[id].P		= 0;
 	PID[id].I		= 0;
 	PID[id].D		= 0;
+#ifdef PID_INTEGRATOR_COMPENSATED
+	PID[id].Ic		= 0;
+#endif
+#ifdef PID_FIXPOINT_OVERFLOW_FLAG
+	PID[id].Ovf		= 0;
+#endif
+#ifdef PID_FLIGHT_RECORDER
+	PID[id].Held	= 0;
+#endif
 
 	for (j = 0; j < 2; j++) 
 	{
@@ -512,3 +2325,305 @@ PIDErr pid_PartsGet( PIDInd id, PIDValue* P, PIDValue* I, PIDValue* D )
 
 	return pidErr_Ok;
 }
+
+
+
+/* Finds the next run of consecutive controllers of group G at or after
+   the position *Pos within the group. Returns 0 if there is none, else
+   the run Start, ..., Start+Len-1 and advances *Pos behind it.
+*/
+static PID_INLINE int pid_GroupRun( const PIDGroup* G, uint32_t* Pos, PIDInd* Start, PIDInd* Len )
+{
+	uint32_t k = *Pos, e;
+	uint64_t w;
+
+	if ( G->Bits == NULL )
+	{
+		if ( k >= G->Num ) return 0;
+		*Start = G->First;
+		*Len   = G->Num;
+		*Pos   = G->Num;
+		return 1;
+	}
+
+	/* First set bit */
+	for (;;)
+	{
+		if ( k >= G->Num ) return 0;
+		w = G->Bits[k/64] >> (k%64);
+		if ( w != 0 ) break;
+		k = (k/64 + 1)*64;
+	}
+	k += pid_Ctz64(w);
+	if ( k >= G->Num ) return 0;
+
+	/* First clear bit behind it */
+	e = k;
+	for (;;)
+	{
+		if ( e >= G->Num ) break;
+		w = ~G->Bits[e/64] >> (e%64);
+		if ( w != 0 ) { e += pid_Ctz64(w); break; }
+		e = (e/64 + 1)*64;
+	}
+	if ( e > G->Num ) e = G->Num;
+
+	*Start = (PIDInd)(G->First + k);
+	*Len   = (PIDInd)(e - k);
+	*Pos   = e;
+	return 1;
+}
+
+#ifdef PID_INDEX_BOUND_CHECK
+#define PID_GROUP_CHECK(G) \
+	if ( (unsigned long)(G)->First + (G)->Num > PID_NUM_CONTROLLERS ) return pidErr_Index;
+#else
+#define PID_GROUP_CHECK(G)
+#endif
+
+
+
+/* Defines a group of controllers */
+PIDErr pid_GroupInit( PIDGroup* G, const char* Name, PIDInd First, PIDInd Num, const uint64_t* Bits )
+{
+	if ( (unsigned long)First + Num > PID_NUM_CONTROLLERS ) return pidErr_Index;
+
+	G->Name  = Name;
+	G->First = First;
+	G->Num   = Num;
+	G->Bits  = Bits;
+
+	return pidErr_Ok;
+}
+
+
+
+/* Returns the number of controllers of a group */
+size_t pid_GroupSize( const PIDGroup* G )
+{
+	uint32_t Pos = 0;
+	PIDInd Start, Len;
+	size_t Size = 0;
+
+	while ( pid_GroupRun(G, &Pos, &Start, &Len) )
+		Size += Len;
+
+	return Size;
+}
+
+
+
+/* Resets all controllers of a group */
+PIDErr pid_GroupReset( const PIDGroup* G )
+{
+	uint32_t Pos = 0;
+	PIDInd Start, Len, i;
+
+	PID_GROUP_CHECK(G)
+
+	while ( pid_GroupRun(G, &Pos, &Start, &Len) )
+	{
+		for (i = Start; i < Start + Len; i++)
+		{
+			PID[i].P	= 0;
+			PID[i].I	= 0;
+			PID[i].D	= 0;
+#ifdef PID_INTEGRATOR_COMPENSATED
+			PID[i].Ic	= 0;
+#endif
+#ifdef PID_FIXPOINT_OVERFLOW_FLAG
+			PID[i].Ovf	= 0;
+#endif
+			PID[i].e[0] = 0;
+			PID[i].e[1] = 0;
+			PID[i].y[0] = 0;
+			PID[i].y[1] = 0;
+		}
+	}
+
+	return pidErr_Ok;
+}
+
+
+
+/* Sets the output limits of all controllers of a group */
+PIDErr pid_GroupLimitsSet( const PIDGroup* G, PIDValue yMin, PIDValue yMax )
+{
+	uint32_t Pos = 0;
+	PIDInd Start, Len, i;
+
+	PID_GROUP_CHECK(G)
+
+	while ( pid_GroupRun(G, &Pos, &Start, &Len) )
+	{
+		for (i = Start; i < Start + Len; i++)
+		{
+			PID[i].yMin = yMin;
+			PID[i].yMax = yMax;
+#ifdef PID_LAZY_INIT
+			PID[i].Limits = 1;
+#endif
+		}
+	}
+
+	return pidErr_Ok;
+}
+
+
+
+/* Sets Anti-Windup for all controllers of a group */
+PIDErr pid_GroupArwSet( const PIDGroup* G, PIDArw Arw )
+{
+	uint32_t Pos = 0;
+	PIDInd Start, Len, i;
+
+	PID_GROUP_CHECK(G)
+
+	while ( pid_GroupRun(G, &Pos, &Start, &Len) )
+	{
+		for (i = Start; i < Start + Len; i++)
+			PID[i].Arw = Arw;
+	}
+
+	return pidErr_Ok;
+}
+
+
+
+/* Sets the I-part of all controllers of a group */
+PIDErr pid_GroupIPartSet( const PIDGroup* G, PIDValue I )
+{
+	uint32_t Pos = 0;
+	PIDInd Start, Len, i;
+
+	PID_GROUP_CHECK(G)
+
+	while ( pid_GroupRun(G, &Pos, &Start, &Len) )
+	{
+		for (i = Start; i < Start + Len; i++)
+		{
+			PID[i].I  = I;
+#ifdef PID_INTEGRATOR_COMPENSATED
+			PID[i].Ic = 0;
+#endif
+		}
+	}
+
+	return pidErr_Ok;
+}
+
+
+
+/* Returns the P, I, and D parts of all controllers of a group */
+PIDErr pid_GroupPartsGet( const PIDGroup* G, PIDValue P[], PIDValue I[], PIDValue D[] )
+{
+	uint32_t Pos = 0;
+	PIDInd Start, Len, i;
+	size_t k = 0;
+
+	PID_GROUP_CHECK(G)
+
+	while ( pid_GroupRun(G, &Pos, &Start, &Len) )
+	{
+		for (i = Start; i < Start + Len; i++, k++)
+		{
+			P[k] = PID[i].P;
+			I[k] = PID[i].I;
+			D[k] = PID[i].D;
+		}
+	}
+
+	return pidErr_Ok;
+}
+
+
+
+#ifdef PID_FIXPOINT_OVERFLOW_FLAG
+/* Returns and clears the overflow flag of the controller with index id */
+PIDErr pid_OverflowGet( PIDInd id, unsigned char* Ovf )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
+
+	*Ovf = PID[id].Ovf;
+	PID[id].Ovf = 0;
+
+	return pidErr_Ok;
+}
+#endif
+
+
+
+#ifdef PID_FLIGHT_RECORDER
+/* Initializes a flight recorder */
+PIDErr pid_RecInit( PIDRecorder* R, PIDRecSample* Buf, uint32_t Num, uint32_t Post, 
+					unsigned char Mask, PIDRecPredicate Pred, void* Ctx )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( Buf == NULL || Num == 0 ) return pidErr_Memory;
+	if ( Post >= Num ) return pidErr_Index;
+#endif
+
+	R->Buf	= Buf;
+	R->Num	= Num;
+	R->Post	= Post;
+	R->Mask	= Mask;
+	R->Pred	= Pred;
+	R->Ctx	= Ctx;
+	pid_RecArm(R);
+
+	return pidErr_Ok;
+}
+
+
+
+/* Attaches a flight recorder to controller id */
+PIDErr pid_RecSet( PIDInd id, PIDRecorder* R )
+{
+#ifdef PID_INDEX_BOUND_CHECK
+	if ( id >= PID_NUM_CONTROLLERS ) return pidErr_Index;
+#endif
+
+	PID[id].Rec = R;
+
+	return pidErr_Ok;
+}
+
+
+
+/* Clears a flight recorder and restarts the recording */
+void pid_RecArm( PIDRecorder* R )
+{
+	R->Pos		= 0;
+	R->Count	= 0;
+	R->PostLeft	= 0;
+	R->Event	= 0;
+	PID_REC_STORE(R->Frozen, 0);
+}
+
+
+
+/* Returns the events which froze the recorder */
+unsigned char pid_RecFrozen( const PIDRecorder* R )
+{
+	return PID_REC_LOAD(R->Frozen) ? R->Event : 0;
+}
+
+
+
+/* Copies the newest Max samples of the recorder, the oldest first */
+uint32_t pid_RecRead( const PIDRecorder* R, PIDRecSample s[], uint32_t Max )
+{
+	uint32_t n = (R->Count < Max) ? R->Count : Max;
+	uint32_t k, i = (R->Pos + R->Num - n) % R->Num;
+
+	for (k = 0; k < n; k++)
+	{
+		s[k] = R->Buf[i];
+		i = (i + 1 == R->Num) ? 0 : i + 1;
+	}
+
+	return n;
+}
+#endif
@@ -11,14 +11,67 @@
 * The library provides the following functions:
 *
 * pid_Init			-> Initialize the library
+* pid_InitRange		-> Initialize a range of controllers
+* pid_BankSize		-> Returns the size of the memory of all controllers
+* pid_BankSet		-> Places the controllers in other memory (PID_BANK_RELOCATABLE)
 * pid_ParaSet_T		-> Sets controller parameters in the form Kr,Tn,Tv
 * pid_ParaSet_K		-> Sets controller parameters in the form Kp,Ki,Kd
 * pid_LimitsSet		-> Sets boundary values
+* pid_LimitsGet		-> Returns the boundary values
 * pid_ArwSet		-> Sets Anti-Windup
+* pid_ArwGet		-> Returns if Anti-Windup is enabled
 * pid_Step			-> Performs one step of calculations
+* pid_StepDt		-> Performs one step of calculations for a varying sample time
+* pid_StepBlock		-> Performs the steps for a block of samples
+* pid_StepBlockParts	-> Performs the steps for a block of samples, returns the parts
+* pid_StepBlockState	-> Performs the steps for a block of samples on a separate state
+* pid_StateGet		-> Returns the internal state (history, P, I, and D part)
+* pid_StateSet		-> Sets the internal state
 * pid_IPartSet		-> Sets the value of the I-part to a certain value
 * pid_Reset         -> Resets the controller (for restarting it)
 * pid_PartsGet		-> Returns the current P, I and D part separately
+* pid_OverflowGet	-> Returns if saturation took place (PID_FIXPOINT_OVERFLOW_FLAG)
+* pid_GroupInit		-> Defines a group of controllers (range or bitset)
+* pid_GroupSize		-> Returns the number of controllers of a group
+* pid_GroupReset	-> Resets all controllers of a group
+* pid_GroupLimitsSet	-> Sets the boundary values of all controllers of a group
+* pid_GroupArwSet	-> Sets Anti-Windup for all controllers of a group
+* pid_GroupIPartSet	-> Sets the I-part of all controllers of a group
+* pid_GroupPartsGet	-> Returns the P, I and D parts of all controllers of a group
+* pid_CoeffsCalc_T	-> Computes the coefficients for parameters Kr,Tn,Tv
+* pid_CoeffsCalc_K	-> Computes the coefficients for parameters Kp,Ki,Kd
+* pid_CoeffsGet		-> Returns the coefficients of a controller
+* pid_ScheduleInit	-> Initializes a gain schedule from a coefficient table
+* pid_ScheduleSet	-> Assigns a gain schedule to a controller
+* pid_StepSched		-> Performs one step with scheduled coefficients
+* pid_StepSchedBank	-> Performs one step with scheduled coefficients for several controllers
+* pid_StepBank		-> Performs one step for several controllers
+* pid_StepBankStats	-> Performs one step for several controllers and updates their statistics
+* pid_StepStrided	-> Performs one step for several controllers on application structs
+* pid_StepBankRaw	-> Performs one step for several controllers from raw sensor samples
+* pid_InputMemSize	-> Returns the memory needed by the input stages
+* pid_InputInit		-> Initializes the input stages of several controllers
+* pid_InputSet		-> Sets the calibration, prefilter and setpoint of an input stage
+* pid_StatsReset	-> Resets the statistics of several controllers
+* pid_StatsRead		-> Returns the statistics of several controllers
+* pid_StepBankExport	-> Performs one step for several controllers and marks the changed outputs
+* pid_ExportMemSize	-> Returns the memory needed by the change tracking of an export
+* pid_ExportInit	-> Initializes the change tracking of an export
+* pid_ExportBandSet	-> Sets the deadband of a controller of an export
+* pid_ExportMark	-> Marks the changed controllers of an export
+* pid_ExportCollect	-> Returns the changed values of an export
+* pid_StepBankEvent	-> Performs one step for the controllers whose control difference changed
+* pid_EventMemSize	-> Returns the memory needed by the event-triggered step
+* pid_EventInit		-> Initializes the event-triggered step of several controllers
+* pid_EventThrSet	-> Sets the threshold of a controller of the event-triggered step
+* pid_EventStatsRead	-> Returns the skip rate of the event-triggered step
+* pid_OutStageSet	-> Attaches an output stage to a controller (PID_OUTPUT_STAGE)
+* pid_StepBankOut	-> Performs one step for several controllers incl. their output stages
+* pid_RecInit		-> Initializes a flight recorder (PID_FLIGHT_RECORDER)
+* pid_RecSet		-> Attaches a flight recorder to a controller
+* pid_RecArm		-> Clears a flight recorder and restarts recording
+* pid_RecFrozen		-> Returns the events which froze a flight recorder
+* pid_RecRead		-> Copies the samples of a flight recorder
 *
 *
 * Copyright (c) 2014 Jan Winkler, Matthias Schfer, Oscar Rivera
@@ -60,10 +113,15 @@
 #ifndef PIDCONTROL_H
 #define PIDCONTROL_H
 
+#include <stddef.h>
 #include "piddefs.h"
 
 /* Data type for accessing the controllers via an index */
+#if PID_NUM_CONTROLLERS <= 255
 typedef unsigned char PIDInd;
+#else
+typedef uint32_t PIDInd;
+#endif
 
 
 /* Possible error codes returned by the functions */
@@ -74,10 +132,324 @@ typedef enum
 	pidErr_TSample,		/* Passed sample time <= 0 */
 	pidErr_Tn,			/* Passed value for Tn <= 0 */
 	pidErr_Tv,			/* Passed value for Tv <= 0 */
-	pidErr_Tf			/* Passed value for Tf < sample time */
+	pidErr_Tf,			/* Passed value for Tf < sample time */
+	pidErr_Schedule,	/* Passed gain schedule is invalid */
+	pidErr_Memory,		/* Passed memory is invalid or could not be allocated */
+	pidErr_Io,			/* Writing or reading data failed or data is invalid */
+	pidErr_Unsupported	/* Requested feature is not supported by the processor or build */
 } PIDErr;
 
 
+/* The coefficients for the difference equations resulting 
+   from the controller parameters 
+*/
+typedef struct
+{
+	PIDValue Cp;	/* Proportional (Kp)*/
+	PIDValue Ci;	/* Integration rectengular approx. (Ki*TSample) or (Ki*TSample/2)*/
+	PIDValue Cd;	/* Differentiation without filtering (Kd/TSample)*/
+	PIDValue Cdf;	/* Differentiation with filtering, diff. part (Kd/Tf)*/
+	PIDValue Cf;	/* Differentiation with filtering, filt. part (1-Ta/Tf)*/
+} PIDCoeffs;
+
+
+/* The internal state of a controller: the history of input and output 
+   (newest value at position 0), the current P, I, and D part, and with
+   PID_INTEGRATOR_COMPENSATED the rounding error of the I-part not yet
+   added to it
+*/
+typedef struct
+{
+	PIDValue e[2];
+	PIDValue y[2];
+	PIDValue P;
+	PIDValue I;
+	PIDValue D;
+#ifdef PID_INTEGRATOR_COMPENSATED
+	PIDValue Ic;
+#endif
+} PIDState;
+
+
+/* Gain schedule: Coefficient blocks at Num equidistant operating points
+   sMin, ..., sMax of a scheduling variable s. Between the points the
+   coefficients are interpolated linearly. Initialize it by pid_ScheduleInit
+   or statically by PID_SCHEDULE.
+*/
+typedef struct
+{
+	const PIDCoeffs* Coeffs;	/* Table with Num coefficient blocks */
+	uint32_t         Num;		/* Number of operating points (at least 2) */
+	PIDValue         sMin;		/* Operating point of Coeffs[0] */
+#ifdef PID_FIXPOINT
+	PIDValue         Span;		/* sMax - sMin */
+#else
+	PIDValue         Scale;		/* (Num-1)/(sMax - sMin) */
+#endif
+} PIDSchedule;
+
+
+#ifdef PID_FLIGHT_RECORDER
+/* One sample of the flight recorder: values after a step */
+typedef struct
+{
+	PIDValue e;
+	PIDValue P;
+	PIDValue I;
+	PIDValue D;
+	PIDValue y;
+} PIDRecSample;
+
+
+/* Events which trigger the flight recorder (may be combined) */
+typedef enum
+{
+	pidRec_SatMax	= 0x01,		/* Output reaches the upper limit */
+	pidRec_SatMin	= 0x02,		/* Output reaches the lower limit */
+	pidRec_Arw		= 0x04,		/* Anti-windup starts to drop changes of the I-part */
+	pidRec_User		= 0x08		/* User predicate returns nonzero */
+} PIDRecEvent;
+
+
+/* User predicate, called for each recorded sample */
+typedef int (*PIDRecPredicate)( const PIDRecSample* s, void* Ctx );
+
+
+/* Flight recorder: circular buffer of the last Num samples of a
+   controller. Initialize it by pid_RecInit, the members are private.
+*/
+typedef struct
+{
+	PIDRecSample*	Buf;		/* Buffer of Num samples */
+	uint32_t		Num;
+	uint32_t		Pos;		/* Position of the next sample */
+	uint32_t		Count;		/* Number of valid samples */
+	uint32_t		Post;		/* Samples recorded after the trigger */
+	uint32_t		PostLeft;
+	PIDRecPredicate	Pred;
+	void*			Ctx;
+	unsigned char	Mask;		/* Enabled events */
+	unsigned char	Event;		/* Events which triggered the recorder */
+	unsigned char	Frozen;
+} PIDRecorder;
+#endif
+
+
+/* Type of the accumulators of the online statistics. The squares of 
+   the integers of I16 and wider exceed the 24 bit mantissa of float, 
+   hence only F32 accumulates in float
+*/
+#if (defined PID_VAL_FORMAT_F32)
+typedef float PIDStatValue;
+#else
+typedef double PIDStatValue;
+#endif
+
+
+/* Online statistics of a controller, updated by pid_StepBankStats. The
+   application keeps one per controller in a side array, initialize 
+   them by pid_StatsReset. The members are private, see pid_StatsRead.
+*/
+typedef struct
+{
+	uint32_t		Count;		/* Number of steps */
+	uint32_t		Sat;		/* Number of steps with the output at a limit */
+	PIDStatValue	Mean;		/* Mean of e (Welford) */
+	PIDStatValue	M2;			/* Sum of squared deviations of e from the mean */
+	PIDStatValue	MeanSq;		/* Exponentially weighted mean of e^2 */
+	PIDValue		IMin;		/* Range of the I-part */
+	PIDValue		IMax;
+} PIDStats;
+
+
+/* Statistics of a controller as returned by pid_StatsRead */
+typedef struct
+{
+	uint32_t		Count;		/* Number of steps */
+	PIDStatValue	Mean;		/* Mean of e */
+	PIDStatValue	Var;		/* Sample variance of e (0 for less than 2 steps) */
+	PIDStatValue	MeanSq;		/* Exponentially weighted mean of e^2 (square of the RMS) */
+	PIDStatValue	SatFrac;	/* Fraction of the steps with the output at a limit */
+	PIDValue		IMin;		/* Minimum and maximum of the I-part */
+	PIDValue		IMax;
+} PIDStatsValues;
+
+
+/* Input stages of the controllers First, ..., First+Num-1 used by
+   pid_StepBankRaw, initialized by pid_InputInit. The arrays of the 
+   calibration, prefilter and setpoints are kept separately, so that the
+   stages of many controllers are computed by one vectorizable loop. The
+   members are private, see pid_InputSet.
+*/
+typedef struct
+{
+	PIDInd			First;
+	PIDInd			Num;
+	double*			Gain;		/* Engineering units per count */
+	double*			Offset;		/* Engineering units at count 0 */
+	double*			Alpha;		/* Coefficients of the prefilters */
+	double*			Setpoint;	/* Setpoints if no setpoint source is passed */
+	double*			xf;			/* States of the prefilters */
+} PIDInput;
+
+
+/* Value of the controllers tracked by a PIDExport */
+typedef enum
+{
+	pidExp_Y,		/* Output */
+	pidExp_P,		/* P-part */
+	pidExp_I,		/* I-part */
+	pidExp_D		/* D-part */
+} PIDExportPart;
+
+
+/* Change tracking of the controllers First, ..., First+Num-1 for the 
+   export of telemetry, initialized by pid_ExportInit. A controller is 
+   marked dirty when its value moved more than its deadband away from 
+   the last exported value. The members are private.
+*/
+typedef struct
+{
+	PIDInd			First;
+	PIDInd			Num;
+	PIDExportPart	Part;
+	uint64_t*		Dirty;		/* Bit k%64 of Dirty[k/64] for controller First+k */
+	PIDValue*		Last;		/* Last exported values */
+	PIDValue*		Band;		/* Deadbands */
+} PIDExport;
+
+
+/* A changed value returned by pid_ExportCollect */
+typedef struct
+{
+	PIDInd			Id;
+	PIDValue		Value;
+} PIDExportEntry;
+
+
+/* State of the event-triggered step of the controllers First, ...,
+   First+Num-1 (see pid_StepBankEvent), initialized by pid_EventInit.
+   The members are private, see pid_EventStatsRead.
+*/
+typedef struct
+{
+	PIDInd			First;
+	PIDInd			Num;
+	uint16_t		MaxSkip;	/* Maximum number of successively skipped steps */
+	uint64_t*		Active;		/* Controllers stepped by the last call */
+	uint64_t*		Quiet;		/* Controllers whose last step was below the threshold */
+	PIDValue*		eHeld;		/* Control differences of the last steps */
+	PIDValue*		Thr;		/* Thresholds */
+	uint16_t*		Skipped;	/* Numbers of skipped steps since the last steps */
+	uint64_t		Steps;		/* Statistics */
+	uint64_t		Skips;
+	uint64_t		Forced;
+} PIDEvent;
+
+
+/* Statistics of an event-triggered step as returned by pid_EventStatsRead */
+typedef struct
+{
+	uint64_t		Steps;		/* Number of performed steps */
+	uint64_t		Skips;		/* Number of skipped steps */
+	uint64_t		Forced;		/* Steps performed due to MaxSkip only */
+	double			SkipFrac;	/* Fraction of the skipped steps (= saved kernel calls) */
+} PIDEventStats;
+
+
+#ifdef PID_OUTPUT_STAGE
+/* Output stage of a controller applied by pid_StepBankOut: the output
+   is rate limited, set to 0 within a deadband and converted to the
+   integer code of an actuator (DAC, PWM, ...):
+
+   y = min(max(y, y_prev - Slew), y_prev + Slew)
+   u = round(Gain*y + Offset) limited to uMin, ..., uMax, Offset for |y| <= Band
+
+   One stage may be shared by several controllers.
+*/
+typedef struct
+{
+	PIDValue		Slew;		/* Maximum change of the output per step, 0 = no limit */
+	PIDValue		Band;		/* Deadband around 0 */
+	double			Gain;		/* Actuator units per output unit */
+	double			Offset;		/* Code of the output 0 */
+	int32_t			uMin;		/* Range of the codes */
+	int32_t			uMax;
+} PIDOutStage;
+#endif
+
+
+/* Types of the values addressed by a PIDStrided descriptor */
+typedef enum
+{
+	pidIo_Value,	/* PIDValue, no conversion */
+	pidIo_I8,		/* int8_t */
+	pidIo_I16,		/* int16_t */
+	pidIo_I32,		/* int32_t */
+	pidIo_I64,		/* int64_t */
+	pidIo_U8,		/* uint8_t */
+	pidIo_U16,		/* uint16_t */
+	pidIo_U32,		/* uint32_t */
+	pidIo_F32,		/* float */
+	pidIo_F64		/* double */
+} PIDIoType;
+
+
+/* Values in application memory: value i is at (char*)Base + i*Stride and
+   has the type Type, e.g. a member of an array of structs:
+   { &Sensors[0].Error, sizeof(Sensors[0]), pidIo_F32 }
+*/
+typedef struct
+{
+	void*		Base;
+	ptrdiff_t	Stride;		/* Distance of the values in bytes */
+	PIDIoType	Type;
+} PIDStrided;
+
+
+/* A group of controllers for the bulk operations pid_GroupXxx, e.g. all
+   loops of a production line. It contains the controllers First, ...,
+   First+Num-1, or, if Bits is not NULL, those of them whose bit is set
+   (controller First+k: bit k%64 of Bits[k/64]). Define it by pid_GroupInit.
+*/
+typedef struct
+{
+	const char*		Name;		/* For the application, not used by the library */
+	PIDInd			First;
+	PIDInd			Num;
+	const uint64_t*	Bits;		/* NULL for all controllers of the range */
+} PIDGroup;
+
+
+/* Static initializers for coefficient tables and gain schedules. They use
+   the same formulas as pid_CoeffsCalc_K, so a table of operating points
+   can be computed by the compiler instead of at runtime:
+
+   static const PIDCoeffs Table[3] = { PID_COEFFS_K(2.0f, 0.5f, 2.0f, 2.0f, 0.5f), ... };
+   static const PIDSchedule Sched  = PID_SCHEDULE(Table, 3, 0.0f, 100.0f);
+
+   Please note that the arguments are not checked and that the expressions
+   are evaluated in the precision of the passed arguments.
+*/
+#if (defined PID_INTALGO_RECT)
+	#define PID_COEFF_CI_K(Ki, TSample)	((Ki)*(TSample))
+#else
+	#define PID_COEFF_CI_K(Ki, TSample)	((Ki)*(TSample)/2)
+#endif
+
+#ifdef PID_FIXPOINT
+	#define PID_COEFF_CF(Tf, TSample)	(((Tf) == 0) ? 0 : (PID_FIXPOINT_FACTOR*((Tf) - (TSample)))/(((Tf) == 0) ? 1 : (Tf)))
+	#define PID_SCHEDULE(Coeffs, Num, sMin, sMax)	{ (Coeffs), (Num), (sMin), (sMax) - (sMin) }
+#else
+	#define PID_COEFF_CF(Tf, TSample)	(((Tf) == 0) ? 0 : 1 - (TSample)/(((Tf) == 0) ? 1 : (Tf)))
+	#define PID_SCHEDULE(Coeffs, Num, sMin, sMax)	{ (Coeffs), (Num), (sMin), (PIDValue)((Num) - 1)/((sMax) - (sMin)) }
+#endif
+
+#define PID_COEFFS_K(Kp, Ki, Kd, Tf, TSample)	\
+	{ (Kp), PID_COEFF_CI_K(Ki, TSample), (Kd)/(TSample), \
+	  ((Tf) == 0) ? 0 : (Kd)/(((Tf) == 0) ? 1 : (Tf)), PID_COEFF_CF(Tf, TSample) }
+
+
 /* Defines wether to use anti windup or not */
 typedef enum
 {
@@ -92,11 +464,51 @@ typedef enum
    to zero except the sample time which is set to 1 and the lower and upper limits which
    are set to the lowest/ largest possible value for the chosen value type. 
    Anti-windup is disabled and trapezoidal integration is used.
+   With PID_LAZY_INIT this state is represented by all-zero memory, hence
+   pid_Init does not touch the controllers of a new bank (the static one
+   or zeroed memory passed to pid_BankSet) and takes constant time. It
+   marks the bank in its first controller, called again for a marked bank
+   it resets all controllers. To re-initialize some of the controllers
+   only, use pid_InitRange.
 */
 void   pid_Init( void );
 
 
 
+/* Initializes the controllers first, ..., first+n-1 like pid_Init.
+   Calling it from the thread which steps the controllers afterwards
+   places their memory on the NUMA node of that thread (first touch).
+   With PID_LAZY_INIT the memory is simply zeroed.
+
+   first -> Index of the first controller
+   n	 -> Number of controllers
+*/
+PIDErr pid_InitRange( PIDInd first, PIDInd n );
+
+
+
+/* Returns the size of the memory holding all controllers in bytes, i.e.
+   the minimum size of the memory passed to pid_BankSet.
+*/
+size_t pid_BankSize( void );
+
+
+
+#ifdef PID_BANK_RELOCATABLE
+/* Places the controllers in the memory Mem of pid_BankSize() bytes, e.g.
+   memory allocated on huge pages or on a certain NUMA node (see 
+   pidbank.h). The memory is used as it is, initialize it by pid_Init or
+   pid_InitRange. With PID_LAZY_INIT zeroed memory needs no initialization.
+   The previous memory is not copied or released.
+   Pass NULL to return to the default bank of the library.
+
+   Mem	-> The new memory of the controllers (aligned to 16 bytes)
+*/
+PIDErr pid_BankSet( void* Mem );
+#endif
+
+
+
 /* Sets the parameters of the controller in time constant form
   
    id	-> Index of the controller to be accessed
@@ -170,6 +582,16 @@ PIDErr pid_LimitsSet( PIDInd id, PIDValue yMin, PIDValue yMax );
 
 
 
+/* Returns the lower and upper boundary of the controller output
+ 
+   id	-> Index of the controller to be accessed
+   *yMin -> Address to which the lower boundary is written
+   *yMax -> Address to which the upper boundary is written
+ */
+PIDErr pid_LimitsGet( PIDInd id, PIDValue* yMin, PIDValue* yMax );
+
+
+
 /* Enables/ disbales the anti-windup mechanism
  
    id	-> Index of the controller to be accessed
@@ -183,6 +605,15 @@ PIDErr pid_ArwSet( PIDInd id, PIDArw Arw );
 
 
 
+/* Returns the setting of the anti-windup mechanism
+ 
+   id	-> Index of the controller to be accessed
+   *Arw -> Address to which the setting is written
+*/
+PIDErr pid_ArwGet( PIDInd id, PIDArw* Arw );
+
+
+
 /* Performs one step of calculation. This function has to be called
    cyclically at the sample time steps by your application.
 
@@ -194,6 +625,53 @@ PIDErr pid_Step( PIDInd id, PIDValue e, PIDValue* y );
 
 
 
+/* Performs one step of calculations like pid_Step for a sample time dt
+   which may differ from the one passed to pid_ParaSet_X, e.g. for 
+   samples arriving with jitter. The I- and D-part are scaled to the
+   elapsed time, the D-filter vanishes if dt exceeds Tf. The controller
+   keeps its parameters, a gain schedule is not used.
+   dt = TSample uses the coefficients of pid_ParaSet_X and gives the 
+   results of pid_Step. For other dt the coefficients are derived from
+   factors precomputed by pid_ParaSet_X. With fixpoint arithmetic they
+   may deviate by one digit from the ones pid_ParaSet_X computes for
+   TSample = dt.
+
+   id	-> Index of the controller to be used
+   e	-> The control difference
+   dt	-> Time elapsed since the last step (same unit as TSample, > 0)
+   y	-> Address to which the controller output is written
+*/
+PIDErr pid_StepDt( PIDInd id, PIDValue e, PIDValue dt, PIDValue* y );
+
+
+
+/* Performs n steps of calculation for a block of samples. The results
+   are identical to n calls of pid_Step, but the state of the controller
+   is only loaded once before and stored once after the block.
+
+   id	-> Index of the controller to be accessed
+   e	-> The control differences of the n steps
+   y	-> Array to which the n controller outputs are written
+   n	-> Number of samples
+*/
+PIDErr pid_StepBlock( PIDInd id, const PIDValue e[], PIDValue y[], size_t n );
+
+
+
+/* Same as pid_StepBlock, but additionally returns the P, the I, and the
+   D part of each step. Pass NULL for the parts which are not required.
+
+   id	-> Index of the controller to be accessed
+   e	-> The control differences of the n steps
+   y	-> Array to which the n controller outputs are written
+   P, I, D -> Arrays to which the n values of the parts are written (or NULL)
+   n	-> Number of samples
+*/
+PIDErr pid_StepBlockParts( PIDInd id, const PIDValue e[], PIDValue y[], 
+						   PIDValue P[], PIDValue I[], PIDValue D[], size_t n );
+
+
+
 /* Sets the I-part of the controller to a new value
 
    id	-> Index of the controller to be accessed
@@ -222,5 +700,520 @@ PIDErr pid_Reset( PIDInd id );
  */
 PIDErr pid_PartsGet( PIDInd id, PIDValue* P, PIDValue* I, PIDValue* D );
 
+
+
+/* Defines a group of controllers. The range is checked here once, the
+   bulk operations only check it again with PID_INDEX_BOUND_CHECK. The
+   bitset is referenced, not copied, changes of it change the group.
+
+   G	 -> The group to be defined
+   Name	 -> Name of the group (may be NULL)
+   First -> Index of the first controller of the range
+   Num	 -> Number of controllers of the range
+   Bits	 -> Bitset of (Num+63)/64 words selecting members of the range, NULL for all
+*/
+PIDErr pid_GroupInit( PIDGroup* G, const char* Name, PIDInd First, PIDInd Num, const uint64_t* Bits );
+
+
+
+/* Returns the number of controllers of group G */
+size_t pid_GroupSize( const PIDGroup* G );
+
+
+
+/* Bulk versions of pid_Reset, pid_LimitsSet, pid_ArwSet and pid_IPartSet
+   for all controllers of group G. The controllers are processed as runs 
+   of consecutive indices, so ranges and dense bitsets are swept without
+   a call per controller.
+*/
+PIDErr pid_GroupReset( const PIDGroup* G );
+PIDErr pid_GroupLimitsSet( const PIDGroup* G, PIDValue yMin, PIDValue yMax );
+PIDErr pid_GroupArwSet( const PIDGroup* G, PIDArw Arw );
+PIDErr pid_GroupIPartSet( const PIDGroup* G, PIDValue I );
+
+
+
+/* Bulk version of pid_PartsGet. The parts of the k-th controller of the
+   group (in ascending order of the indices) are written to P[k], I[k], 
+   and D[k], the arrays need pid_GroupSize(G) elements.
+*/
+PIDErr pid_GroupPartsGet( const PIDGroup* G, PIDValue P[], PIDValue I[], PIDValue D[] );
+
+
+#ifdef PID_FIXPOINT_OVERFLOW_FLAG
+/* Returns if an intermediate result of pid_Step had to be saturated
+   since the last call of this function (or pid_Reset). The flag is
+   cleared by reading it. Only available if PID_FIXPOINT_SATURATE and
+   PID_FIXPOINT_OVERFLOW_FLAG are defined.
+
+   id	-> Index of the controller to be accessed
+   Ovf	-> Address to which the flag (1 = saturated, 0 = not saturated) is written
+ */
+PIDErr pid_OverflowGet( PIDInd id, unsigned char* Ovf );
 #endif
 
+
+
+
+/* Same as pid_StepBlock, but the state is taken from and written back
+   to st instead of the controller. Coefficients, limits, and anti-windup
+   of the controller are used, the controller itself is not modified.
+   Hence, the function may be called for the same controller from 
+   several threads at once, each thread with its own state. The steps
+   are not recorded by a flight recorder.
+
+   id	-> Index of the controller whose parameters are used
+   st	-> The state to start from, the final state is written to it
+   e	-> The control differences of the n steps
+   y	-> Array to which the n controller outputs are written
+   n	-> Number of samples
+*/
+PIDErr pid_StepBlockState( PIDInd id, PIDState* st, const PIDValue e[], PIDValue y[], size_t n );
+
+
+
+/* Returns the internal state of the controller
+
+   id	-> Index of the controller to be accessed
+   st	-> Address to which the state is written
+*/
+PIDErr pid_StateGet( PIDInd id, PIDState* st );
+
+
+
+/* Sets the internal state of the controller, e.g. for restoring a 
+   state returned by pid_StateGet
+
+   id	-> Index of the controller to be accessed
+   st	-> The new state
+*/
+PIDErr pid_StateSet( PIDInd id, const PIDState* st );
+
+
+
+/* Returns the coefficients of the difference equations of the controller
+
+   id	-> Index of the controller to be accessed
+   C	-> Address to which the coefficients are written
+*/
+PIDErr pid_CoeffsGet( PIDInd id, PIDCoeffs* C );
+
+
+
+/* Computes the coefficients of the difference equations for parameters 
+   in time constant form without assigning them to a controller. Use
+   this to build the tables of a gain schedule at runtime.
+
+   Kr, Tn, Tv, Tf, TSample -> See pid_ParaSet_T
+   C	-> Address to which the coefficients are written
+*/
+PIDErr pid_CoeffsCalc_T( PIDValue Kr, PIDValue Tn, PIDValue Tv, PIDValue Tf, PIDValue TSample, PIDCoeffs* C );
+
+
+
+/* Computes the coefficients of the difference equations for parameters 
+   in gain form without assigning them to a controller. Use this to 
+   build the tables of a gain schedule at runtime.
+
+   Kp, Ki, Kd, Tf, TSample -> See pid_ParaSet_K
+   C	-> Address to which the coefficients are written
+*/
+PIDErr pid_CoeffsCalc_K( PIDValue Kp, PIDValue Ki, PIDValue Kd, PIDValue Tf, PIDValue TSample, PIDCoeffs* C );
+
+
+
+/* Initializes a gain schedule. Either all blocks of the table have a 
+   D-filter (Cf != 0) or none, mixed tables give pidErr_Schedule. With
+   fixpoint arithmetic Cf has to be within 0..PID_FIXPOINT_FACTOR (as
+   given by pid_CoeffsCalc_*), otherwise the result is pidErr_Schedule.
+
+   S		-> Address of the schedule to be initialized
+   Coeffs	-> Table of Num coefficient blocks (has to stay valid while the schedule is used)
+   Num		-> Number of operating points (at least 2)
+   sMin		-> Value of the scheduling variable belonging to Coeffs[0]
+   sMax		-> Value of the scheduling variable belonging to Coeffs[Num-1]
+*/
+PIDErr pid_ScheduleInit( PIDSchedule* S, const PIDCoeffs* Coeffs, uint32_t Num, PIDValue sMin, PIDValue sMax );
+
+
+
+/* Assigns a gain schedule to a controller. Several controllers may share
+   one schedule. The coefficients set by pid_ParaSet_T/ pid_ParaSet_K 
+   are kept and still used by pid_Step.
+
+   id	-> Index of the controller to be accessed
+   S	-> The schedule (set to NULL to remove the schedule)
+*/
+PIDErr pid_ScheduleSet( PIDInd id, const PIDSchedule* S );
+
+
+
+/* Performs one step of calculation with the coefficients interpolated
+   from the gain schedule of the controller at the operating point s.
+   Controllers without schedule use their own coefficients.
+
+   id	-> Index of the controller to be accessed
+   s	-> The actual value of the scheduling variable
+   e	-> The actual control difference
+   *y   -> Address to which the controller output is written
+*/
+PIDErr pid_StepSched( PIDInd id, PIDValue s, PIDValue e, PIDValue* y );
+
+
+
+/* Performs pid_StepSched for the controllers first, ..., first+n-1 in 
+   one sweep.
+
+   first -> Index of the first controller
+   n	 -> Number of controllers
+   s	 -> Values of the scheduling variable, one per controller
+   e	 -> Control differences, one per controller
+   y	 -> Array to which the n controller outputs are written
+*/
+PIDErr pid_StepSchedBank( PIDInd first, PIDInd n, const PIDValue s[], const PIDValue e[], PIDValue y[] );
+
+
+
+/* Performs pid_Step for the controllers first, ..., first+n-1 in one
+   sweep.
+
+   first -> Index of the first controller
+   n	 -> Number of controllers
+   e	 -> Control differences, one per controller
+   y	 -> Array to which the n controller outputs are written
+*/
+PIDErr pid_StepBank( PIDInd first, PIDInd n, const PIDValue e[], PIDValue y[] );
+
+
+
+/* Performs pid_StepBank and updates the online statistics of each 
+   controller in the same sweep: mean and variance of e (Welford), the
+   exponentially weighted mean of e^2, the number of steps with the output
+   at a limit and the range of the I-part. This avoids reading the 
+   controllers again after the step.
+
+   first -> Index of the first controller
+   n	 -> Number of controllers
+   e	 -> Control differences, one per controller
+   y	 -> Array to which the n controller outputs are written
+   S	 -> Statistics of the n controllers, S[i] belongs to controller first+i
+   Alpha -> Weight of the newest sample in the mean of e^2 (0 < Alpha <= 1)
+*/
+PIDErr pid_StepBankStats( PIDInd first, PIDInd n, const PIDValue e[], PIDValue y[], 
+						  PIDStats S[], PIDStatValue Alpha );
+
+
+
+/* Performs pid_StepBank with the control differences read from and the
+   outputs written to application memory of any layout, e.g. the members
+   of arrays of structs, without copying them to arrays of PIDValue. The
+   values are converted by C casts, outputs to integer types saturate at
+   the limits of the type (NaN gives 0).
+
+   first -> Index of the first controller
+   n	 -> Number of controllers
+   e	 -> Control differences of the n controllers
+   y	 -> Outputs of the n controllers
+*/
+PIDErr pid_StepStrided( PIDInd first, PIDInd n, const PIDStrided* e, const PIDStrided* y );
+
+
+
+/* Performs pid_StepBank starting from raw sensor samples, e.g. ADC 
+   counts of any integer type. For each controller the input stage V
+   computes in double precision
+
+   x  = Gain*raw + Offset				(calibration)
+   xf = Alpha*x + (1 - Alpha)*xf		(first order prefilter, Alpha = 1: none)
+   e  = w - xf							(control difference)
+
+   and converts e to PIDValue (fixpoint: e*PID_FIXPOINT_FACTOR truncated
+   and saturated, NaN gives 0) before the step. The controllers are 
+   processed in chunks whose input stages are computed by one loop 
+   without jumps. A conversion loop of the application for its own raw
+   type followed by pid_StepBank stays the faster path (pidbench: 
+   In/2pass, a few percent), this function saves that code for any raw
+   type and stride.
+
+   first -> Index of the first controller
+   n	 -> Number of controllers
+   Raw	 -> Raw samples of the n controllers
+   w	 -> Setpoints of the n controllers in engineering units, NULL for
+			the ones of pid_InputSet
+   V	 -> Input stages (have to contain the controllers)
+   y	 -> Outputs of the n controllers
+*/
+PIDErr pid_StepBankRaw( PIDInd first, PIDInd n, const PIDStrided* Raw, const PIDStrided* w, 
+						PIDInput* V, PIDValue y[] );
+
+
+
+/* Returns the size of the memory in bytes needed by pid_InputInit for
+   Num controllers */
+size_t pid_InputMemSize( PIDInd Num );
+
+
+
+/* Initializes the input stages V of the controllers First, ..., 
+   First+Num-1 with Gain = 1, Offset = 0, no prefilter and setpoint 0.
+
+   V	 -> The input stages to be initialized
+   Mem	 -> Memory of pid_InputMemSize(Num) bytes (aligned to 8 bytes)
+   First -> Index of the first controller
+   Num	 -> Number of controllers
+*/
+PIDErr pid_InputInit( PIDInput* V, void* Mem, PIDInd First, PIDInd Num );
+
+
+
+/* Sets the input stage of the controller with index id. The state of
+   the prefilter starts at the setpoint.
+
+   V		-> The input stages
+   id		-> Index of the controller
+   Gain		-> Engineering units per count
+   Offset	-> Engineering units at count 0
+   Alpha	-> Coefficient of the prefilter (0 < Alpha <= 1, 1 = no filter),
+			   e.g. TSample/(Tf + TSample) for the time constant Tf
+   Setpoint -> Setpoint used if pid_StepBankRaw gets no setpoint source
+*/
+PIDErr pid_InputSet( PIDInput* V, PIDInd id, double Gain, double Offset, double Alpha, double Setpoint );
+
+
+
+/* Resets the online statistics S[0], ..., S[n-1] */
+void pid_StatsReset( PIDStats S[], PIDInd n );
+
+
+
+/* Evaluates the online statistics S[0], ..., S[n-1]. The RMS of e is 
+   the square root of MeanSq, which is left to the application so that the
+   library does not need the math library.
+
+   S	-> Statistics of n controllers
+   n	-> Number of controllers
+   V	-> Array to which the n evaluated statistics are written
+*/
+void pid_StatsRead( const PIDStats S[], PIDInd n, PIDStatsValues V[] );
+
+
+
+/* Performs pid_StepBank and marks the controllers whose exported value
+   (see pid_ExportInit) moved more than their deadband since it was 
+   exported last. The controllers have to belong to the export X.
+
+   first -> Index of the first controller
+   n	 -> Number of controllers
+   e	 -> Control differences of the n controllers
+   y	 -> Outputs of the n controllers
+   X	 -> Change tracking to be updated
+*/
+PIDErr pid_StepBankExport( PIDInd first, PIDInd n, const PIDValue e[], PIDValue y[], PIDExport* X );
+
+
+
+/* Returns the size of the memory in bytes needed by pid_ExportInit for
+   Num controllers */
+size_t pid_ExportMemSize( PIDInd Num );
+
+
+
+/* Initializes the change tracking X of the controllers First, ...,
+   First+Num-1. All controllers are marked, so the first call of
+   pid_ExportCollect returns all of them.
+
+   X	 -> The change tracking to be initialized
+   Mem	 -> Memory of pid_ExportMemSize(Num) bytes (aligned to 8 bytes)
+   First -> Index of the first controller
+   Num	 -> Number of controllers
+   Part	 -> Value to be exported (output, P, I, or D-part)
+   Band	 -> Deadband of all controllers (0 = every change is exported)
+*/
+PIDErr pid_ExportInit( PIDExport* X, void* Mem, PIDInd First, PIDInd Num, PIDExportPart Part, PIDValue Band );
+
+
+
+/* Sets the deadband of the controller with index id */
+PIDErr pid_ExportBandSet( PIDExport* X, PIDInd id, PIDValue Band );
+
+
+
+/* Marks the controllers first, ..., first+n-1 whose value moved more
+   than their deadband, for controllers stepped by other functions than
+   pid_StepBankExport.
+*/
+PIDErr pid_ExportMark( PIDExport* X, PIDInd first, PIDInd n );
+
+
+
+/* Writes the current values of at most Max marked controllers in
+   ascending order of their indices to Out, clears their marks and takes 
+   the values as the last exported ones. The bitmap is scanned word by 
+   word, so the time depends on the number of marked controllers and 
+   only slightly on the number of all controllers. Controllers left 
+   over due to Max stay marked. Returns the number of entries written.
+*/
+size_t pid_ExportCollect( PIDExport* X, PIDExportEntry Out[], size_t Max );
+
+
+
+/* Performs pid_StepBank only for the controllers whose control 
+   difference moved more than their threshold away from the one of their
+   last performed step, whose last step was such a move, or which skipped
+   MaxSkip steps in a row. The active set is determined from the side arrays of V before any 
+   controller is touched, the skipped controllers keep their state and
+   their values in y are not written, hence y has to hold the outputs of
+   the previous call. Before a controller is stepped again its skipped
+   steps are applied in closed form with the held control difference eh:
+   the I-part grows by s increments, the D-part decays by Cf^s. With
+   floating point Cf^s is formed by repeated squaring instead of pow,
+   which rounds at most 2*log2(s) times. With anti-windup and an output
+   which may have reached a limit meanwhile the skipped steps are 
+   performed one by one instead.
+
+   Deviation from pid_StepBank (linear range, without limits): during 
+   the skipped steps the control difference differs by at most Thr from
+   eh. Hence the I-part differs by less than 2*|Ci|*Thr (|Ci|*Thr with
+   PID_INTALGO_RECT) per skipped step, the P-part by less than |Cp|*Thr 
+   and the D-part by less than 2*|Cd|*Thr (|Cdf|*Thr/(1-Cf) filtered). 
+   The held output additionally lags behind by the growth of the I-part
+   of at most MaxSkip steps, i.e. MaxSkip*2*|Ci*eh|, and by the decay of 
+   a filtered D-part. With Thr = 0 only steps with an unchanged control 
+   difference are skipped and the results equal the ones of pid_StepBank
+   up to rounding.
+
+   first -> Index of the first controller
+   n	 -> Number of controllers
+   e	 -> Control differences of the n controllers
+   y	 -> Outputs of the n controllers, written for the stepped ones
+   V	 -> State of the event-triggered step (has to contain the controllers)
+*/
+PIDErr pid_StepBankEvent( PIDInd first, PIDInd n, const PIDValue e[], PIDValue y[], PIDEvent* V );
+
+
+
+/* Returns the size of the memory in bytes needed by pid_EventInit for
+   Num controllers */
+size_t pid_EventMemSize( PIDInd Num );
+
+
+
+/* Initializes the event-triggered step V of the controllers First, ...,
+   First+Num-1. The last control differences of the controllers are 
+   taken as the held ones.
+
+   V	   -> The state to be initialized
+   Mem	   -> Memory of pid_EventMemSize(Num) bytes (aligned to 8 bytes)
+   First   -> Index of the first controller
+   Num	   -> Number of controllers
+   Thr	   -> Threshold of all controllers (e.g. the noise band of the sensors)
+   MaxSkip -> Maximum number of successively skipped steps (0 = never skip)
+*/
+PIDErr pid_EventInit( PIDEvent* V, void* Mem, PIDInd First, PIDInd Num, PIDValue Thr, uint16_t MaxSkip );
+
+
+
+/* Sets the threshold of the controller with index id */
+PIDErr pid_EventThrSet( PIDEvent* V, PIDInd id, PIDValue Thr );
+
+
+
+/* Returns the statistics of the event-triggered step V */
+void pid_EventStatsRead( const PIDEvent* V, PIDEventStats* S );
+
+
+
+#ifdef PID_OUTPUT_STAGE
+/* Attaches the output stage S to the controller id, NULL detaches the
+   current stage. Only available if PID_OUTPUT_STAGE is defined.
+
+   id	-> Index of the controller
+   S	-> The output stage or NULL
+*/
+PIDErr pid_OutStageSet( PIDInd id, const PIDOutStage* S );
+
+
+
+/* Performs pid_StepBank and applies the output stages of the 
+   controllers in the same pass, writing the actuator codes. The stored
+   output of a controller is the slew-limited one, the limits and the
+   anti-windup of the step act on the output before the slew limit.
+   Without an output stage the output is converted to int32_t by a 
+   saturating cast, NaN gives 0. A flight recorder of the controller
+   records the slew-limited output.
+
+   first -> Index of the first controller
+   n	 -> Number of controllers
+   e	 -> Control differences of the n controllers
+   y	 -> Outputs of the n controllers after the slew limit (may be NULL)
+   u	 -> Actuator codes of the n controllers
+*/
+PIDErr pid_StepBankOut( PIDInd first, PIDInd n, const PIDValue e[], PIDValue y[], int32_t u[] );
+#endif
+
+
+
+#ifdef PID_FLIGHT_RECORDER
+/* Initializes the flight recorder R. After being attached to a
+   controller by pid_RecSet it records the values of each step of the
+   controller into the buffer Buf, overwriting the oldest sample. On the
+   first of the events in Mask it records Post further samples and
+   freezes. The controller keeps running, the frozen samples can be 
+   read by pid_RecRead (e.g. by another thread polling pid_RecFrozen),
+   afterwards pid_RecArm restarts the recording.
+
+   R	-> The recorder to be initialized
+   Buf	-> Buffer for the samples, provided by the application
+   Num	-> Number of samples in Buf (> 0)
+   Post	-> Number of samples recorded after the event (< Num)
+   Mask	-> Events which trigger the recorder (pidRec_SatMax | ...), 0 
+		   for recording without trigger
+   Pred	-> Predicate for the event pidRec_User, may be NULL
+   Ctx	-> Context passed to the predicate
+*/
+PIDErr pid_RecInit( PIDRecorder* R, PIDRecSample* Buf, uint32_t Num, uint32_t Post, 
+					unsigned char Mask, PIDRecPredicate Pred, void* Ctx );
+
+
+
+/* Attaches the flight recorder R to the controller id, NULL detaches
+   the current recorder. A recorder must not be attached to more than
+   one controller.
+
+   id	-> Index of the controller
+   R	-> The recorder or NULL
+*/
+PIDErr pid_RecSet( PIDInd id, PIDRecorder* R );
+
+
+
+/* Clears the flight recorder R and restarts the recording 
+
+   R	-> The recorder
+*/
+void pid_RecArm( PIDRecorder* R );
+
+
+
+/* Returns the events which froze the flight recorder R, 0 if it is
+   still recording. Safe to call from another thread than the one
+   stepping the controller.
+
+   R	-> The recorder
+*/
+unsigned char pid_RecFrozen( const PIDRecorder* R );
+
+
+
+/* Copies the samples of the flight recorder R, the oldest first. Call
+   it only while the recorder is frozen if the controller is stepped by
+   another thread. Returns the number of samples copied.
+
+   R	-> The recorder
+   s	-> Array to which the samples are written
+   Max	-> Size of the array s
+*/
+uint32_t pid_RecRead( const PIDRecorder* R, PIDRecSample s[], uint32_t Max );
+#endif
+
+#endif
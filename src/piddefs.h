@@ -81,11 +81,69 @@
 #endif
 
 
-#if !(defined PID_VAL_FORMAT_F32) && !(defined PID_VAL_FORMAT_F64)
+#if !(defined PID_VAL_FORMAT_F32) && !(defined PID_VAL_FORMAT_F64) && !(defined PID_FIXPOINT)
 	#define PID_FIXPOINT
 #endif
 
 
+/* The additions of fixpoint values are exact, no compensation needed */
+#if (defined PID_FIXPOINT) && (defined PID_INTEGRATOR_COMPENSATED)
+	#undef PID_INTEGRATOR_COMPENSATED
+#endif
+
+
+/* Smallest and largest value of the chosen value type */
+#if (defined PID_VAL_FORMAT_I8)
+	#define PID_VAL_MIN INT8_MIN
+	#define PID_VAL_MAX INT8_MAX
+#elif (defined PID_VAL_FORMAT_I16)
+	#define PID_VAL_MIN INT16_MIN
+	#define PID_VAL_MAX INT16_MAX
+#elif (defined PID_VAL_FORMAT_I32)
+	#define PID_VAL_MIN INT32_MIN
+	#define PID_VAL_MAX INT32_MAX
+#elif (defined PID_VAL_FORMAT_I64)
+	#define PID_VAL_MIN INT64_MIN
+	#define PID_VAL_MAX INT64_MAX
+#elif (defined PID_VAL_FORMAT_F32)
+	#define PID_VAL_MIN (-FLT_MAX)
+	#define PID_VAL_MAX FLT_MAX
+#else
+	#define PID_VAL_MIN (-DBL_MAX)
+	#define PID_VAL_MAX DBL_MAX
+#endif
+
+
+/* Keyword for inline functions (not known to older Microsoft compilers in C mode) */
+#ifdef _MSC_VER
+	#define PID_INLINE __inline
+#else
+	#define PID_INLINE inline
+#endif
+
+/* Keyword for functions which have to be inlined, e.g. the step kernel
+   into the loops over many controllers
+*/
+#if (defined _MSC_VER)
+	#define PID_FORCE_INLINE __forceinline
+#elif (defined __GNUC__)
+	#define PID_FORCE_INLINE __attribute__((always_inline)) inline
+#else
+	#define PID_FORCE_INLINE PID_INLINE
+#endif
+
+/* Keyword for pointers through which no other pointer of a function
+   accesses the same memory, e.g. for loops the compiler should vectorize
+*/
+#if (defined _MSC_VER)
+	#define PID_RESTRICT __restrict
+#elif (defined __GNUC__)
+	#define PID_RESTRICT __restrict__
+#else
+	#define PID_RESTRICT
+#endif
+
+
 #ifdef PID_FIXPOINT
 
 	#if (defined PID_VAL_FORMAT_I8) && (PID_INTEGER_PRECISION > 2)
@@ -141,9 +199,33 @@
 	#define PID_FIXPOINT_CORR_MUL /PID_FIXPOINT_FACTOR
 	#define PID_FIXPOINT_CORR_DIV *PID_FIXPOINT_FACTOR
 
+	/* Integer type of double width used for saturating arithmetic */
+	#ifdef PID_FIXPOINT_SATURATE
+		#if (defined PID_VAL_FORMAT_I8)
+			typedef int16_t     PIDWideValue;
+		#elif (defined PID_VAL_FORMAT_I16)
+			typedef int32_t     PIDWideValue;
+		#elif (defined PID_VAL_FORMAT_I32)
+			typedef int64_t     PIDWideValue;
+		#elif (defined __SIZEOF_INT128__)
+			typedef __int128    PIDWideValue;
+		#else
+			#error "PID_FIXPOINT_SATURATE with PID_VAL_FORMAT_I64 requires a compiler with 128bit integers!"
+		#endif
+	#endif
+
 #else  /* Floating point calculation */
 	#define PID_FIXPOINT_CORR_MUL
 	#define PID_FIXPOINT_CORR_DIV
+
+	/* Saturation is only meaningful for fixpoint arithmetic */
+	#undef PID_FIXPOINT_SATURATE
+	#undef PID_FIXPOINT_OVERFLOW_FLAG
+#endif
+
+
+#if (defined PID_FIXPOINT_OVERFLOW_FLAG) && !(defined PID_FIXPOINT_SATURATE)
+	#error "PID_FIXPOINT_OVERFLOW_FLAG requires PID_FIXPOINT_SATURATE!"
 #endif
 
 #endif
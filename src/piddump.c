@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "pidlog.h"
+
+/* Converts a binary log of pidlog.c to text. Each tick is printed as
+ * one line: the time followed by the values of all controllers,
+ * separated by tabs ("%.8f\t"), like the data files of the Python and
+ * Matlab scripts. Blocks outside of the requested time range are
+ * skipped by their headers without decoding them.
+ * Command Line Options: piddump logfile [tFrom [tTo]]
+ * tFrom, tTo = range of the printed ticks (default: all)
+ * */
+
+int main(int argc, char* argv[])
+{
+	unsigned char head[PID_LOG_FILE_HEADER];
+	unsigned char* data = NULL;
+	unsigned char* grown;
+	size_t dataSize = 0, len, pos;
+	int64_t* q;
+	uint32_t Num, i, k;
+	double Scale, TSample, t, tFrom = -1e300, tTo = 1e300;
+	PIDLogBlock B;
+	FILE* f;
+	int ret = 0;
+
+	if (argc < 2 || argc > 4) {
+		puts("Usage ./piddump logfile [tFrom [tTo]]");
+		return 1;
+	}
+	if (argc > 2) tFrom = strtod(argv[2], NULL);
+	if (argc > 3) tTo = strtod(argv[3], NULL);
+
+	f = fopen(argv[1], "rb");
+	if (f == NULL) {
+		printf("Cannot open %s\n", argv[1]);
+		return 1;
+	}
+	if (fread(head, 1, sizeof(head), f) != sizeof(head) ||
+		pid_LogHeaderParse(head, &Num, &Scale, &TSample) != pidErr_Ok) {
+		printf("%s is no log of pidlog.c\n", argv[1]);
+		fclose(f);
+		return 1;
+	}
+	q = calloc(Num, sizeof(int64_t));
+	if (q == NULL && Num > 0) {
+		fputs("out of memory\n", stderr);
+		fclose(f);
+		return 1;
+	}
+
+	while (fread(head, 1, PID_LOG_BLOCK_HEADER, f) == PID_LOG_BLOCK_HEADER)
+	{
+		if (pid_LogBlockParse(head, &B) != pidErr_Ok) {
+			fputs("invalid block header\n", stderr);
+			ret = 1;
+			break;
+		}
+
+		/* Seek over the blocks before the range, stop after it */
+		if (B.Time > tTo) break;
+		if (B.Time + (B.Ticks - 1)*TSample < tFrom) {
+			if (fseek(f, B.Len, SEEK_CUR) != 0) break;
+			continue;
+		}
+
+		if (B.Len > dataSize) {
+			grown = realloc(data, B.Len);
+			if (grown == NULL) {
+				fputs("out of memory\n", stderr);
+				ret = 1;
+				break;
+			}
+			data = grown;
+			dataSize = B.Len;
+		}
+		if (fread(data, 1, B.Len, f) != B.Len) {
+			fputs("truncated block\n", stderr);
+			ret = 1;
+			break;
+		}
+
+		for (i = 0; i < Num; i++)
+			q[i] = 0;
+		for (k = 0, pos = 0; k < B.Ticks; k++, pos += len)
+		{
+			len = pid_LogTickDecode(data + pos, data + B.Len, Num, q);
+			if (len == 0) {
+				fputs("truncated tick\n", stderr);
+				ret = 1;
+				break;
+			}
+			t = (double)(B.Tick + k)*TSample;
+			if (t < tFrom || t > tTo) continue;
+			printf("%.8f", t);
+			for (i = 0; i < Num; i++)
+				printf("\t%.8f", (double)q[i]/Scale);
+			printf("\n");
+		}
+		if (ret) break;
+	}
+
+	free(data);
+	free(q);
+	fclose(f);
+	return ret;
+}
@@ -0,0 +1,446 @@
+/*********************************************************************
+* File: pidexec.c
+*
+* Implementation of the cyclic executor. Compile this file together
+* with pidcontrol.c and link with -pthread.
+*
+* Refer to the header for more information
+*
+*
+* Copyright (c) 2014 Jan Winkler, Matthias Schfer, Oscar Rivera
+* Institut fr Regelungs- und Steuerungstheorie
+* Technische Universitt Dresden / Dresden University of Technology
+* D-01062 Dresden, Germany
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+*     Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*
+*     Redistributions in binary form must not misrepresent the orignal
+*     source in the documentation and/or other materials provided
+*     with the distribution.
+*
+*     The names of the authors nor its contributors may be used to
+*     endorse or promote products derived from this software without
+*     specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+* OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Jan.Winkler@tu-dresden.de
+* 04.06.2014
+*********************************************************************/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "pidexec.h"
+
+
+/* Stack touched per call of pid_ExecPrefault */
+#define PID_EXEC_PREFAULT_CHUNK 4096
+
+/* Size of an array in the memory of the executor, a multiple of 8 bytes
+   to keep the following array aligned */
+#define PID_EXEC_ARRAY(Num, Type) (((size_t)(Num)*sizeof(Type) + 7) & ~(size_t)7)
+
+/* Tick of a controller which was not stepped yet */
+#define PID_EXEC_NEVER UINT64_MAX
+
+
+
+static PIDExecTime pid_ExecRealNow( void* Ctx )
+{
+	struct timespec ts;
+
+	(void)Ctx;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (PIDExecTime)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+
+
+/* Absolute sleep: the wake-up does not depend on the time the caller
+   needed before, a signal only restarts the same sleep
+*/
+static void pid_ExecRealSleepUntil( void* Ctx, PIDExecTime t )
+{
+	struct timespec ts;
+
+	(void)Ctx;
+	ts.tv_sec  = (time_t)(t/1000000000);
+	ts.tv_nsec = (long)(t%1000000000);
+	while ( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR )
+		;
+}
+
+
+
+static PIDExecTime pid_ExecSimNow( void* Ctx )
+{
+	return ((PIDExecSimClock*)Ctx)->Time;
+}
+
+
+
+static void pid_ExecSimSleepUntil( void* Ctx, PIDExecTime t )
+{
+	PIDExecSimClock* S = (PIDExecSimClock*)Ctx;
+
+	if ( t > S->Time ) S->Time = t;
+}
+
+
+
+void pid_ExecClockReal( PIDExecClock* C )
+{
+	C->Now		  = pid_ExecRealNow;
+	C->SleepUntil = pid_ExecRealSleepUntil;
+	C->Ctx		  = NULL;
+}
+
+
+
+void pid_ExecClockSim( PIDExecClock* C, PIDExecSimClock* S )
+{
+	C->Now		  = pid_ExecSimNow;
+	C->SleepUntil = pid_ExecSimSleepUntil;
+	C->Ctx		  = S;
+}
+
+
+
+size_t pid_ExecMemSize( PIDInd Num )
+{
+	return PID_EXEC_ARRAY(Num, uint64_t) + 2*PID_EXEC_ARRAY(Num, PIDValue) + PID_EXEC_ARRAY(Num, uint32_t);
+}
+
+
+
+PIDErr pid_ExecInit( PIDExec* X, void* Mem, PIDInd First, PIDInd Num, double TimeUnit,
+					 const PIDExecClock* Clock )
+{
+	PIDValue TSample;
+	PIDExecTime Period, a, b, r;
+	PIDInd k;
+
+	if ( (unsigned long)First + Num > PID_NUM_CONTROLLERS || Num == 0 ) return pidErr_Index;
+	if ( ((size_t)Mem % sizeof(uint64_t)) != 0 )						 return pidErr_Memory;
+
+	X->First   = First;
+	X->Num	   = Num;
+	X->Last	   = (uint64_t*)Mem;
+	X->e	   = (PIDValue*)((char*)Mem + PID_EXEC_ARRAY(Num, uint64_t));
+	X->y	   = (PIDValue*)((char*)X->e + PID_EXEC_ARRAY(Num, PIDValue));
+	X->Div	   = (uint32_t*)((char*)X->y + PID_EXEC_ARRAY(Num, PIDValue));
+	X->Clock   = *Clock;
+	X->Sense   = NULL;
+	X->Actuate = NULL;
+	X->Ctx	   = NULL;
+	X->Policy  = pidOvr_Skip;
+	X->Limit   = 1;
+	X->Recover = 1;
+	X->Rate	   = 1;
+	X->Good	   = 0;
+	X->Rec	   = NULL;
+	X->RecSize = 0;
+	X->Started = 0;
+	X->Stop	   = 0;
+	X->Origin  = 0;
+	X->Tick	   = 0;
+	X->Stats.Cycles		= 0;
+	X->Stats.Misses		= 0;
+	X->Stats.Late		= 0;
+	X->Stats.Skipped	= 0;
+	X->Stats.Degraded	= 0;
+	X->Stats.Steps		= 0;
+	X->Stats.LatencyMin = INT64_MAX;
+	X->Stats.LatencyMax = 0;
+	X->Stats.LatencySum = 0;
+	X->Stats.ExecMax	= 0;
+	X->Stats.ExecSum	= 0;
+
+	/* The base period is the greatest common divisor of the sample times,
+	   the periods are kept in Div until it is known
+	*/
+	X->Base = 0;
+	for (k = 0; k < Num; k++)
+	{
+		pid_ParaGet_K(First + k, NULL, NULL, NULL, NULL, &TSample);
+		Period = (PIDExecTime)llround((double)TSample*TimeUnit*1e9);
+		if ( Period <= 0 ) return pidErr_TSample;
+
+		for (a = X->Base, b = Period; b != 0; a = b, b = r)
+			r = a % b;
+		X->Base	   = a;
+		X->Last[k] = PID_EXEC_NEVER;
+		X->e[k]	   = 0;
+		X->y[k]	   = 0;
+	}
+	for (k = 0; k < Num; k++)
+	{
+		pid_ParaGet_K(First + k, NULL, NULL, NULL, NULL, &TSample);
+		Period = (PIDExecTime)llround((double)TSample*TimeUnit*1e9);
+		if ( X->Base < PID_EXEC_MIN_BASE )	 return pidErr_TSample;
+		if ( Period/X->Base > UINT32_MAX ) return pidErr_TSample;
+		X->Div[k] = (uint32_t)(Period/X->Base);
+	}
+
+	return pidErr_Ok;
+}
+
+
+
+PIDErr pid_ExecIoSet( PIDExec* X, PIDExecSense Sense, PIDExecActuate Actuate, void* Ctx )
+{
+	X->Sense   = Sense;
+	X->Actuate = Actuate;
+	X->Ctx	   = Ctx;
+	return pidErr_Ok;
+}
+
+
+
+PIDErr pid_ExecPolicySet( PIDExec* X, PIDExecOverrun Policy, unsigned Limit, unsigned Recover )
+{
+	X->Policy  = Policy;
+	X->Limit   = (Limit > 0) ? Limit : 1;
+	X->Recover = (Recover > 0) ? Recover : 1;
+	X->Good	   = 0;
+	if ( Policy != pidOvr_Degrade ) X->Rate = 1;
+	return pidErr_Ok;
+}
+
+
+
+PIDErr pid_ExecRecordSet( PIDExec* X, PIDExecCycle* Rec, size_t Size )
+{
+	X->Rec	   = (Size > 0) ? Rec : NULL;
+	X->RecSize = Size;
+	return pidErr_Ok;
+}
+
+
+
+/* Steps the controllers due at Tick in runs of consecutive controllers,
+   returns the number of controllers stepped. A run whose controllers
+   were all stepped one sample time before is stepped by pid_StepBank, 
+   otherwise each controller by pid_StepDt with its elapsed time.
+*/
+static uint32_t pid_ExecCycle( PIDExec* X, uint64_t Tick )
+{
+	PIDInd a, b, k, id;
+	PIDValue TSample;
+	uint64_t Periods;
+	uint32_t Stepped = 0;
+
+	for (a = 0; a < X->Num; a = b)
+	{
+		/* Run [a, b) of due controllers */
+		while ( a < X->Num && Tick % ((uint64_t)X->Div[a]*X->Rate) != 0 ) a++;
+		for (b = a; b < X->Num && Tick % ((uint64_t)X->Div[b]*X->Rate) == 0; b++)
+			;
+		if ( a == b ) break;
+
+		if ( X->Sense != NULL ) X->Sense(X->Ctx, Tick, X->First + a, b - a, &X->e[a]);
+		for (k = a; k < b && (X->Last[k] == PID_EXEC_NEVER || Tick - X->Last[k] == X->Div[k]); k++)
+			;
+		if ( k == b )
+		{
+			pid_StepBank(X->First + a, b - a, &X->e[a], &X->y[a]);
+		}
+		else
+		{
+			for (k = a; k < b; k++)
+			{
+				id = X->First + k;
+				Periods = (X->Last[k] == PID_EXEC_NEVER) ? 1 : (Tick - X->Last[k])/X->Div[k];
+				if ( Periods == 1 )
+				{
+					pid_Step(id, X->e[k], &X->y[k]);
+				}
+				else
+				{
+					pid_ParaGet_K(id, NULL, NULL, NULL, NULL, &TSample);
+					pid_StepDt(id, X->e[k], TSample*(PIDValue)Periods, &X->y[k]);
+				}
+			}
+		}
+		for (k = a; k < b; k++)
+			X->Last[k] = Tick;
+		if ( X->Actuate != NULL ) X->Actuate(X->Ctx, Tick, X->First + a, b - a, &X->y[a]);
+		Stepped += b - a;
+	}
+	return Stepped;
+}
+
+
+
+PIDErr pid_ExecRun( PIDExec* X, uint64_t Ticks )
+{
+	PIDExecCycle c;
+	PIDExecTime Release, Start, End;
+	uint64_t Last = (Ticks == 0) ? UINT64_MAX : X->Tick + Ticks, Passed, Drop;
+
+	if ( !X->Started )
+	{
+		X->Origin  = X->Clock.Now(X->Clock.Ctx);
+		X->Started = 1;
+	}
+
+	while ( X->Tick < Last )
+	{
+		if ( __atomic_load_n(&X->Stop, __ATOMIC_ACQUIRE) )
+		{
+			__atomic_store_n(&X->Stop, 0, __ATOMIC_RELAXED);
+			break;
+		}
+
+		Release = X->Origin + (PIDExecTime)X->Tick*X->Base;
+		X->Clock.SleepUntil(X->Clock.Ctx, Release);
+		Start = X->Clock.Now(X->Clock.Ctx);
+
+		c.Tick	  = X->Tick;
+		c.Flags	  = (X->Rate > 1) ? PID_EXEC_DEGRADED : 0;
+		c.Stepped = pid_ExecCycle(X, X->Tick);
+		End		  = X->Clock.Now(X->Clock.Ctx);
+		c.Latency = Start - Release;
+		c.Exec	  = End - Start;
+		if ( c.Latency > X->Base ) c.Flags |= PID_EXEC_LATE;
+
+		X->Tick++;
+		if ( End > Release + X->Base )
+		{
+			/* Missed deadline, the releases up to End have passed */
+			c.Flags |= PID_EXEC_MISS;
+			Passed = (uint64_t)((End - Release)/X->Base);
+			X->Good = 0;
+
+			switch ( X->Policy )
+			{
+			case pidOvr_CatchUp:
+				Drop = (Passed > X->Limit) ? Passed - X->Limit : 0;
+				break;
+			case pidOvr_Degrade:
+				if ( 2*X->Rate <= X->Limit ) X->Rate *= 2;
+				Drop = Passed;
+				break;
+			default:
+				Drop = Passed;
+				break;
+			}
+			X->Tick += Drop;
+			X->Stats.Skipped += Drop;
+		}
+		else if ( X->Rate > 1 && ++X->Good >= X->Recover )
+		{
+			X->Rate /= 2;
+			X->Good  = 0;
+		}
+
+		if ( X->Rec != NULL ) X->Rec[X->Stats.Cycles % X->RecSize] = c;
+		X->Stats.Cycles++;
+		X->Stats.Steps += c.Stepped;
+		if ( c.Flags & PID_EXEC_MISS )	   X->Stats.Misses++;
+		if ( c.Flags & PID_EXEC_LATE )	   X->Stats.Late++;
+		if ( c.Flags & PID_EXEC_DEGRADED ) X->Stats.Degraded++;
+		if ( c.Latency < X->Stats.LatencyMin ) X->Stats.LatencyMin = c.Latency;
+		if ( c.Latency > X->Stats.LatencyMax ) X->Stats.LatencyMax = c.Latency;
+		if ( c.Exec > X->Stats.ExecMax )	   X->Stats.ExecMax	   = c.Exec;
+		X->Stats.LatencySum += c.Latency;
+		X->Stats.ExecSum	+= c.Exec;
+	}
+
+	return pidErr_Ok;
+}
+
+
+
+void pid_ExecStop( PIDExec* X )
+{
+	__atomic_store_n(&X->Stop, 1, __ATOMIC_RELEASE);
+}
+
+
+
+PIDErr pid_ExecStatsRead( const PIDExec* X, PIDExecStats* S )
+{
+	*S = X->Stats;
+	if ( S->Cycles == 0 ) S->LatencyMin = 0;
+	return pidErr_Ok;
+}
+
+
+
+/* Touches n bytes of the stack, PID_EXEC_PREFAULT_CHUNK per call. The
+   access after the recursion keeps the frames from being reused.
+*/
+static int pid_ExecPrefault( size_t n )
+{
+	volatile unsigned char buf[PID_EXEC_PREFAULT_CHUNK];
+	size_t k;
+
+	for (k = 0; k < sizeof(buf); k += 64)
+		buf[k] = 0;
+	if ( n > sizeof(buf) ) buf[1] = (unsigned char)pid_ExecPrefault(n - sizeof(buf));
+	return buf[0] + buf[1];
+}
+
+
+
+PIDErr pid_ExecRtSetup( const PIDExecRt* Rt, unsigned* Applied )
+{
+	struct sched_param sp;
+	cpu_set_t set;
+	unsigned Done = 0, Want = 0;
+
+	if ( Rt->Cpu >= CPU_SETSIZE ) return pidErr_Index;
+
+	if ( Rt->LockMemory )
+	{
+		Want |= PID_EXEC_RT_LOCK;
+		if ( mlockall(MCL_CURRENT | MCL_FUTURE) == 0 ) Done |= PID_EXEC_RT_LOCK;
+	}
+
+	/* After mlockall the touched stack stays resident */
+	if ( Rt->StackPrefault > 0 )
+	{
+		pid_ExecPrefault(Rt->StackPrefault);
+		Want |= PID_EXEC_RT_PREFAULT;
+		Done |= PID_EXEC_RT_PREFAULT;
+	}
+
+	if ( Rt->Cpu >= 0 )
+	{
+		Want |= PID_EXEC_RT_PIN;
+		CPU_ZERO(&set);
+		CPU_SET(Rt->Cpu, &set);
+		if ( pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ) Done |= PID_EXEC_RT_PIN;
+	}
+
+	if ( Rt->Priority > 0 )
+	{
+		Want |= PID_EXEC_RT_FIFO;
+		sp.sched_priority = Rt->Priority;
+		if ( pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0 ) Done |= PID_EXEC_RT_FIFO;
+	}
+
+	if ( Applied != NULL ) *Applied = Done;
+	return (Done == Want) ? pidErr_Ok : pidErr_Unsupported;
+}
@@ -0,0 +1,350 @@
+/*********************************************************************
+* File: pidexec.h
+*
+* Cyclic executor for Linux which calls the controllers of a range of
+* the bank at their sample times. The executor runs on a base period,
+* the greatest common divisor of the sample times, and steps each
+* controller at every k-th base cycle. The cycles are released at
+* absolute times (clock_nanosleep with TIMER_ABSTIME on CLOCK_MONOTONIC),
+* so the phase does not drift by the execution time and the wake-up
+* latency of each cycle is measured. Cycles whose work ends after the
+* release of the next cycle miss their deadline; what happens to the
+* releases passed meanwhile is set by the overrun policy. For tests the
+* executor runs on a simulated clock which only advances when told.
+* The thread can be set up for real-time operation (SCHED_FIFO, CPU
+* pinning, locked and prefaulted memory) by pid_ExecRtSetup.
+*
+* The file needs POSIX threads and clock_nanosleep (link with -pthread).
+*
+* pid_ExecMemSize		-> Memory needed by an executor for a range of controllers
+* pid_ExecInit			-> Initializes an executor from the sample times of the controllers
+* pid_ExecIoSet			-> Sets the functions reading the inputs and writing the outputs
+* pid_ExecPolicySet		-> Sets the policy for overruns
+* pid_ExecRecordSet		-> Sets a ring buffer for the records of the cycles
+* pid_ExecRun			-> Runs the executor for a number of base periods
+* pid_ExecStop			-> Makes pid_ExecRun return after the current cycle
+* pid_ExecStatsRead		-> Reads the statistics of the cycles
+* pid_ExecClockReal		-> Clock of the system (CLOCK_MONOTONIC)
+* pid_ExecClockSim		-> Simulated clock for tests
+* pid_ExecRtSetup		-> Real-time setup of the calling thread
+*
+*
+* Copyright (c) 2014 Jan Winkler, Matthias Schfer, Oscar Rivera
+* Institut fr Regelungs- und Steuerungstheorie
+* Technische Universitt Dresden / Dresden University of Technology
+* D-01062 Dresden, Germany
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+*     Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*
+*     Redistributions in binary form must not misrepresent the orignal
+*     source in the documentation and/or other materials provided
+*     with the distribution.
+*
+*     The names of the authors nor its contributors may be used to
+*     endorse or promote products derived from this software without
+*     specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+* OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Jan.Winkler@tu-dresden.de
+* 04.06.2014
+*********************************************************************/
+#ifndef PIDEXEC_H
+#define PIDEXEC_H
+
+#include <stddef.h>
+#include <signal.h>
+#include "pidcontrol.h"
+
+
+/* Times of the executor in nanoseconds */
+typedef int64_t PIDExecTime;
+
+
+/* Clock of an executor. Now returns the current time, SleepUntil
+   returns at the time t at the earliest (immediately if t has passed).
+   Initialize it by pid_ExecClockReal or pid_ExecClockSim.
+*/
+typedef struct
+{
+	PIDExecTime	(*Now)( void* Ctx );
+	void		(*SleepUntil)( void* Ctx, PIDExecTime t );
+	void*		Ctx;
+} PIDExecClock;
+
+
+/* Simulated clock: the time only advances by SleepUntil and by the
+   application, which adds the simulated execution time of its
+   functions to Time.
+*/
+typedef struct
+{
+	PIDExecTime	Time;
+} PIDExecSimClock;
+
+
+/* What the executor does with the releases which passed while a cycle
+   missed its deadline
+*/
+typedef enum
+{
+	pidOvr_Skip,		/* Drop them, continue with the next release in the future */
+	pidOvr_CatchUp,		/* Run them back to back without sleeping (at most Limit) */
+	pidOvr_Degrade		/* Drop them and halve the rates of all controllers (at
+						   most down to 1/Limit, rounded to a power of 2) until
+						   Recover cycles in a row met their deadlines, then 
+						   double the rates again */
+} PIDExecOverrun;
+
+
+/* Smallest base period in nanoseconds. Sample times whose greatest
+   common divisor is smaller (e.g. sample times which are not multiples
+   of a microsecond) are rejected, the executor would wake up for every
+   base period
+*/
+#ifndef PID_EXEC_MIN_BASE
+#define PID_EXEC_MIN_BASE	1000
+#endif
+
+
+/* Flags of a cycle */
+#define PID_EXEC_MISS		0x01	/* The cycle ended after the next release */
+#define PID_EXEC_LATE		0x02	/* The cycle started after the next release (catch-up) */
+#define PID_EXEC_DEGRADED	0x04	/* The rates were reduced during the cycle */
+
+
+/* Record of a cycle */
+typedef struct
+{
+	uint64_t	Tick;		/* Index of the base period of the release */
+	PIDExecTime	Latency;	/* Start of the cycle - release */
+	PIDExecTime	Exec;		/* End of the cycle - start */
+	uint32_t	Stepped;	/* Number of controllers stepped */
+	uint32_t	Flags;		/* PID_EXEC_MISS, ... */
+} PIDExecCycle;
+
+
+/* Statistics of the cycles run by an executor */
+typedef struct
+{
+	uint64_t	Cycles;		/* Cycles run */
+	uint64_t	Misses;		/* Cycles which ended after the next release */
+	uint64_t	Late;		/* Cycles which started after the next release */
+	uint64_t	Skipped;	/* Releases dropped by the overrun policy */
+	uint64_t	Degraded;	/* Cycles run with reduced rates */
+	uint64_t	Steps;		/* Controller steps */
+	PIDExecTime	LatencyMin;	/* Wake-up latency, the jitter of the */
+	PIDExecTime	LatencyMax;	/* release is LatencyMax - LatencyMin */
+	PIDExecTime	LatencySum;
+	PIDExecTime	ExecMax;	/* Execution time of a cycle */
+	PIDExecTime	ExecSum;
+} PIDExecStats;
+
+
+/* Function reading the control differences e[0], ..., e[n-1] of the
+   controllers first, ..., first+n-1 which are stepped in the cycle of
+   the base period Tick. It is called for each run of consecutive
+   controllers due in a cycle.
+*/
+typedef void (*PIDExecSense)( void* Ctx, uint64_t Tick, PIDInd first, PIDInd n, PIDValue e[] );
+
+/* Function writing the outputs y[0], ..., y[n-1] of the controllers
+   first, ..., first+n-1, called after the step of each run
+*/
+typedef void (*PIDExecActuate)( void* Ctx, uint64_t Tick, PIDInd first, PIDInd n, const PIDValue y[] );
+
+
+/* Executor of a range of controllers, initialize it by pid_ExecInit.
+   The members are private.
+*/
+typedef struct
+{
+	PIDInd			First;
+	PIDInd			Num;
+	PIDExecTime		Base;		/* Base period */
+	uint64_t*		Last;		/* Tick of the last step of each controller */
+	uint32_t*		Div;		/* Sample time of each controller in base periods */
+	PIDValue*		e;
+	PIDValue*		y;
+	PIDExecClock	Clock;
+	PIDExecSense	Sense;
+	PIDExecActuate	Actuate;
+	void*			Ctx;
+	PIDExecOverrun	Policy;
+	unsigned		Limit;
+	unsigned		Recover;
+	unsigned		Rate;		/* Divisor of the rates, 1 if not degraded */
+	unsigned		Good;		/* Cycles in a row which met their deadlines */
+	PIDExecCycle*	Rec;
+	size_t			RecSize;
+	int				Started;
+	volatile sig_atomic_t Stop;
+	PIDExecTime		Origin;		/* Release of tick 0 */
+	uint64_t		Tick;		/* Next tick to release */
+	PIDExecStats	Stats;
+} PIDExec;
+
+
+/* Real-time setup of a thread for pid_ExecRtSetup */
+typedef struct
+{
+	int		Priority;		/* Priority of SCHED_FIFO, 0 keeps the policy */
+	int		Cpu;			/* CPU the thread is pinned to, -1 for no pinning */
+	int		LockMemory;		/* Lock all current and future pages (mlockall) */
+	size_t	StackPrefault;	/* Bytes of stack touched in advance, e.g. 65536 */
+} PIDExecRt;
+
+/* Parts of the real-time setup which were applied */
+#define PID_EXEC_RT_FIFO		0x01
+#define PID_EXEC_RT_PIN			0x02
+#define PID_EXEC_RT_LOCK		0x04
+#define PID_EXEC_RT_PREFAULT	0x08
+
+
+
+/* Returns the size of the memory needed by pid_ExecInit for Num
+   controllers
+*/
+size_t pid_ExecMemSize( PIDInd Num );
+
+
+
+/* Initializes the executor X for the controllers First, ..., First+Num-1
+   from their sample times, which have to be set before. The base period
+   is the greatest common divisor of the sample times in nanoseconds,
+   pidErr_TSample is returned if it is below PID_EXEC_MIN_BASE.
+   The policy is pidOvr_Skip, no functions for the inputs and outputs
+   are set (the controllers are stepped with e = 0).
+
+   X		-> The executor
+   Mem		-> Memory of pid_ExecMemSize(Num) bytes, aligned for 8 bytes
+   First	-> Index of the first controller
+   Num		-> Number of controllers
+   TimeUnit	-> Seconds per unit of the sample times, 1 if the sample times
+			   are given in seconds, e.g. 0.1 for the fixpoint sample time
+			   5 = 0.5 s
+   Clock	-> Clock of the executor, copied
+*/
+PIDErr pid_ExecInit( PIDExec* X, void* Mem, PIDInd First, PIDInd Num, double TimeUnit,
+					 const PIDExecClock* Clock );
+
+
+
+/* Sets the functions reading the inputs and writing the outputs of the
+   controllers. Actuate may be NULL, then the outputs are only stepped.
+
+   X		-> The executor
+   Sense	-> Function reading the control differences
+   Actuate	-> Function writing the outputs
+   Ctx		-> Context passed to both
+*/
+PIDErr pid_ExecIoSet( PIDExec* X, PIDExecSense Sense, PIDExecActuate Actuate, void* Ctx );
+
+
+
+/* Sets the policy for overruns
+
+   X		-> The executor
+   Policy	-> pidOvr_Skip, pidOvr_CatchUp or pidOvr_Degrade
+   Limit	-> pidOvr_CatchUp: maximal number of releases run back to back
+			   after a miss, the older ones are dropped;
+			   pidOvr_Degrade: maximal divisor of the rates, the rates
+			   are divided by the powers of 2 up to Limit
+   Recover	-> pidOvr_Degrade: cycles in a row which have to meet their
+			   deadlines before the rates are doubled again
+*/
+PIDErr pid_ExecPolicySet( PIDExec* X, PIDExecOverrun Policy, unsigned Limit, unsigned Recover );
+
+
+
+/* Sets a ring buffer which holds the records of the last Size cycles.
+   The record of cycle c (counted by Stats.Cycles from 0) is Rec[c % Size].
+
+   X		-> The executor
+   Rec		-> Ring buffer, NULL for no records
+   Size		-> Number of records in Rec
+*/
+PIDErr pid_ExecRecordSet( PIDExec* X, PIDExecCycle* Rec, size_t Size );
+
+
+
+/* Runs the executor for Ticks base periods from its last release on,
+   the dropped releases included. The first call releases tick 0 at the
+   current time. In each cycle the controllers which are due are
+   stepped in runs of consecutive controllers: Sense, pid_StepBank,
+   Actuate. A controller whose last step lies more than one sample time
+   back, e.g. due to dropped releases or reduced rates (pidOvr_Degrade),
+   is stepped by pid_StepDt with the time elapsed since that step.
+
+   X		-> The executor
+   Ticks	-> Number of base periods, 0 runs until pid_ExecStop is called
+*/
+PIDErr pid_ExecRun( PIDExec* X, uint64_t Ticks );
+
+
+
+/* Makes pid_ExecRun return after the current cycle, can be called by
+   another thread, a signal handler or the functions of the executor
+
+   X		-> The executor
+*/
+void pid_ExecStop( PIDExec* X );
+
+
+
+/* Reads the statistics of the cycles
+
+   X		-> The executor
+   S		-> The statistics are written here
+*/
+PIDErr pid_ExecStatsRead( const PIDExec* X, PIDExecStats* S );
+
+
+
+/* Sets C to the clock of the system: CLOCK_MONOTONIC, the sleep is
+   clock_nanosleep with TIMER_ABSTIME
+*/
+void pid_ExecClockReal( PIDExecClock* C );
+
+
+
+/* Sets C to the simulated clock S
+
+   C		-> The clock of the executor
+   S		-> The simulated clock, starts at S->Time
+*/
+void pid_ExecClockSim( PIDExecClock* C, PIDExecSimClock* S );
+
+
+
+/* Sets up the calling thread for real-time operation: locks the memory,
+   touches StackPrefault bytes of the stack, pins the thread to a CPU and
+   sets SCHED_FIFO. Call it before pid_ExecRun in the thread which runs
+   the executor. Returns pidErr_Unsupported if a part could not be set up
+   (e.g. missing privileges), the other parts are applied anyway, and
+   pidErr_Index without setting up anything if Cpu is not below
+   CPU_SETSIZE.
+
+   Rt		-> The setup
+   Applied	-> If not NULL, the parts which were applied are written to
+			   it (PID_EXEC_RT_FIFO, ...)
+*/
+PIDErr pid_ExecRtSetup( const PIDExecRt* Rt, unsigned* Applied );
+
+#endif
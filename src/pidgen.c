@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+/* Generates reference data for pidtest without Matlab or Python. The
+ * excitation e(t) is the sum of the given signal components, the
+ * outputs of the P-, PI- and PID-controller are calculated in double
+ * precision with the discrete transfer functions of
+ * python/generateDataFromPython.py, independently of the library. With
+ * -i RECT the I-part is the rectangular sum of the library
+ * (PID_INTALGO_RECT, I_k = I_{k-1} + Ki*TSample*e_{k-1}) instead of the
+ * trapezoidal one, with Tf <= 0 the D-part is unfiltered (Tf = 0 of the
+ * library). The text format equals the data files of the Python and
+ * Matlab scripts: one row per sample with t, e, yP, yPI, yPID ("%.8f",
+ * separated by tabs). The binary format writes the same rows as 5
+ * doubles in native byte order.
+ * Command Line Options: pidgen [options] [signal ...]
+ * -n N             number of samples (default: 61)
+ * -t TSample       sample time (default: 0.5)
+ * -k Kp,Ki,Kd,Tf   controller parameters (default: 2,0.5,2,2 as pidtest)
+ * -i TRAPZ|RECT    integration algorithm (default: TRAPZ)
+ * -r seed          seed of prbs and noise (default: 1)
+ * -b               binary output
+ * -o file          output file (default: stdout)
+ * signal           sine:A:w[:phase]  A*sin(w*t + phase)
+ *                  step:A:t0         A for t >= t0
+ *                  chirp:A:w0:w1     linear sweep from w0 to w1 (rad/s)
+ *                                    over all samples
+ *                  prbs:A:hold       +-A, maximum length sequence of
+ *                                    2^15-1 bits, hold samples per bit
+ *                  noise:sigma       gaussian noise
+ * The default signal is the one of the data files,
+ * sine:1:1:0.785398163397 sine:2:0.25
+ * */
+
+#define GEN_MAX_SIGNALS 32
+#define GEN_BUF_SIZE (1 << 20)
+
+typedef enum { sig_Sine, sig_Step, sig_Chirp, sig_Prbs, sig_Noise } GenSigType;
+
+typedef struct {
+	GenSigType Type;
+	double A, p1, p2;
+	uint32_t Lfsr;
+} GenSignal;
+
+/* Seeded generator of the noise (xorshift64*), no rand() to produce
+ * the same data on all platforms */
+static uint64_t gen_Seed = 1;
+
+static double gen_Uniform(void)
+{
+	gen_Seed ^= gen_Seed >> 12;
+	gen_Seed ^= gen_Seed << 25;
+	gen_Seed ^= gen_Seed >> 27;
+	return ((gen_Seed*0x2545F4914F6CDD1DULL) >> 11)*(1.0/9007199254740992.0);
+}
+
+/* Box-Muller, one of the two values is dropped */
+static double gen_Gauss(void)
+{
+	double u = gen_Uniform();
+
+	while (u <= 0) u = gen_Uniform();
+	return sqrt(-2*log(u))*cos(2*3.14159265358979323846*gen_Uniform());
+}
+
+static int gen_SignalParse(const char* s, GenSignal* g)
+{
+	static const char* const names[] = { "sine", "step", "chirp", "prbs", "noise" };
+	static const int nargs[] = { 2, 2, 3, 2, 1 };
+	double v[3] = { 0, 0, 0 };
+	const char* c = strchr(s, ':');
+	char* end;
+	int k, n = 0;
+
+	if (c == NULL) return 0;
+	for (k = 0; k < 5; k++)
+		if (strlen(names[k]) == (size_t)(c - s) && strncmp(s, names[k], c - s) == 0) break;
+	if (k == 5) return 0;
+
+	while (*c == ':' && n < 3) {
+		v[n++] = strtod(c + 1, &end);
+		if (end == c + 1) return 0;
+		c = end;
+	}
+	/* the phase of sine is optional */
+	if (*c != 0 || (n != nargs[k] && !(k == sig_Sine && n == 3))) return 0;
+	if (k == sig_Prbs && v[1] < 1) return 0;
+
+	g->Type = (GenSigType)k;
+	g->A = v[0];
+	g->p1 = v[1];
+	g->p2 = v[2];
+	g->Lfsr = 1;
+	return 1;
+}
+
+/* Sample k of the signal at time t, tEnd = time of the last sample */
+static double gen_SignalValue(GenSignal* g, uint64_t k, double t, double tEnd)
+{
+	int bit;
+
+	switch (g->Type) {
+	case sig_Sine:
+		return g->A*sin(g->p1*t + g->p2);
+	case sig_Step:
+		return t >= g->p1 ? g->A : 0;
+	case sig_Chirp:
+		return g->A*sin(g->p1*t + (tEnd > 0 ? (g->p2 - g->p1)*t*t/(2*tEnd) : 0));
+	case sig_Prbs:
+		/* x^15 + x^14 + 1 */
+		if (k > 0 && k % (uint64_t)g->p1 == 0) {
+			bit = ((g->Lfsr >> 14) ^ (g->Lfsr >> 13)) & 1;
+			g->Lfsr = ((g->Lfsr << 1) | bit) & 0x7fff;
+		}
+		return (g->Lfsr & 1) ? g->A : -g->A;
+	default:
+		return g->A*gen_Gauss();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	GenSignal sig[GEN_MAX_SIGNALS];
+	int nsig = 0, binary = 0, rect = 0, i;
+	uint64_t N = 61, k;
+	double TSample = 0.5, Kp = 2, Ki = 0.5, Kd = 2, Tf = 2;
+	double a0, a1, Kn, b[3], a[3], tEnd, t, e;
+	double e1 = 0, e2 = 0, yPI = 0, yPID1 = 0, yPID2 = 0, yPID, row[5];
+	const char* outname = NULL;
+	char* buf;
+	char* p;
+	FILE* f = stdout;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-b") == 0) {
+			binary = 1;
+		} else if (argv[i][0] == '-' && argv[i][1] != 0 && argv[i][2] == 0 && i + 1 < argc) {
+			switch (argv[i][1]) {
+			case 'n': N = strtoull(argv[++i], NULL, 10); break;
+			case 't': TSample = strtod(argv[++i], NULL); break;
+			case 'r': gen_Seed = strtoull(argv[++i], NULL, 10); break;
+			case 'o': outname = argv[++i]; break;
+			case 'i':
+				i++;
+				if (strcmp(argv[i], "RECT") == 0) rect = 1;
+				else if (strcmp(argv[i], "TRAPZ") != 0) N = 0;
+				break;
+			case 'k':
+				if (sscanf(argv[++i], "%lf,%lf,%lf,%lf", &Kp, &Ki, &Kd, &Tf) != 4) N = 0;
+				break;
+			default: N = 0;
+			}
+		} else if (nsig < GEN_MAX_SIGNALS && gen_SignalParse(argv[i], &sig[nsig])) {
+			nsig++;
+		} else {
+			N = 0;
+		}
+		if (N == 0) break;
+	}
+	if (N == 0 || TSample <= 0) {
+		puts("Usage ./pidgen [-n N] [-t TSample] [-k Kp,Ki,Kd,Tf] [-i TRAPZ|RECT] [-r seed] [-b] [-o file] [signal ...]");
+		puts("signal: sine:A:w[:phase] step:A:t0 chirp:A:w0:w1 prbs:A:hold noise:sigma");
+		return 1;
+	}
+	if (gen_Seed == 0) gen_Seed = 1;
+	if (nsig == 0) {
+		gen_SignalParse("sine:1:1", &sig[0]);
+		sig[0].p2 = 3.14159265358979323846/4;
+		gen_SignalParse("sine:2:0.25", &sig[1]);
+		nsig = 2;
+	}
+	buf = malloc(GEN_BUF_SIZE);
+	if (buf == NULL) {
+		puts("Memory allocation failed");
+		return 1;
+	}
+	if (outname != NULL && (f = fopen(outname, binary ? "wb" : "w")) == NULL) {
+		printf("Cannot open %s\n", outname);
+		free(buf);
+		return 1;
+	}
+
+	/* PI: (a1 z + a0)/(z - 1), PID with the filter of the D-part
+	 * Kn = 1/Tf: b/a, both as in generateDataFromPython.py. The
+	 * rectangular I-part Ki*TSample/(z - 1) moves the whole Ki*TSample
+	 * to a0. The filter with Tf = TSample is the plain difference
+	 * Kd/TSample*(z - 1)/z of the unfiltered D-part */
+	Kn = Tf > 0 ? 1/Tf : 1/TSample;
+	a1 = Kp + (rect ? 0 : Ki*TSample/2);
+	a0 = (rect ? Ki*TSample : Ki*TSample/2) - Kp;
+	b[0] = a1 + Kd*Kn;
+	b[1] = -a1 + Kn*TSample*a1 + a0 - 2*Kd*Kn;
+	b[2] = -a0 + Kn*TSample*a0 + Kd*Kn;
+	a[1] = Kn*TSample - 2;
+	a[2] = -Kn*TSample + 1;
+
+	p = buf;
+	tEnd = (double)(N - 1)*TSample;
+	for (k = 0; k < N; k++)
+	{
+		t = (double)k*TSample;
+		for (i = 0, e = 0; i < nsig; i++)
+			e += gen_SignalValue(&sig[i], k, t, tEnd);
+
+		/* zero initial state like control.forced_response */
+		yPI += a1*e + a0*e1;
+		yPID = b[0]*e + b[1]*e1 + b[2]*e2 - a[1]*yPID1 - a[2]*yPID2;
+		e2 = e1;
+		e1 = e;
+		yPID2 = yPID1;
+		yPID1 = yPID;
+
+		row[0] = t;
+		row[1] = e;
+		row[2] = Kp*e;
+		row[3] = yPI;
+		row[4] = yPID;
+		if (binary) {
+			memcpy(p, row, sizeof(row));
+			p += sizeof(row);
+		} else {
+			for (i = 0; i < 5; i++)
+				p += snprintf(p, GEN_BUF_SIZE - (p - buf), "%.8f%c", row[i], i < 4 ? '\t' : '\n');
+		}
+		/* a text row has at most 5*(sprintf("%.8f") of 1e308) chars */
+		if (p - buf > GEN_BUF_SIZE - 5*330 || k == N - 1) {
+			if (fwrite(buf, 1, p - buf, f) != (size_t)(p - buf)) {
+				fputs("write error\n", stderr);
+				break;
+			}
+			p = buf;
+		}
+	}
+
+	free(buf);
+	if (f != stdout) fclose(f);
+	return k == N ? 0 : 1;
+}
@@ -0,0 +1,388 @@
+/*********************************************************************
+* File: pidhalf.c
+*
+* Implementation of the compact controller bank in half precision.
+* The controllers are stepped in blocks of PID_HALF_BLOCK, the
+* coefficients of a block are converted to float first (F16C if the
+* processor supports it), then the block is computed without jumps.
+*
+* Refer to the header for more information
+*
+*
+* Copyright (c) 2014 Jan Winkler, Matthias Schfer, Oscar Rivera
+* Institut fr Regelungs- und Steuerungstheorie
+* Technische Universitt Dresden / Dresden University of Technology
+* D-01062 Dresden, Germany
+*
+* Redistribution and use in source and binary forms, with or without 
+* modification, are permitted provided that the following conditions 
+* are met:
+*
+*     Redistributions of source code must retain the above copyright 
+*     notice, this list of conditions and the following disclaimer. 
+*
+*     Redistributions in binary form must not misrepresent the orignal
+*     source in the documentation and/or other materials provided 
+*     with the distribution. 
+*
+*     The names of the authors nor its contributors may be used to 
+*     endorse or promote products derived from this software without 
+*     specific prior written permission. 
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+* OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Jan.Winkler@tu-dresden.de
+* 04.06.2014
+*********************************************************************/
+#include <string.h>
+#include <math.h>
+#include "pidhalf.h"
+
+#ifndef PID_FIXPOINT
+
+#if (defined __GNUC__) && ((defined __x86_64__) || (defined __i386__))
+	#include <immintrin.h>
+	#define PID_HALF_F16C
+#endif
+
+/* Number of controllers stepped together, the arrays are padded to it */
+#define PID_HALF_BLOCK 8
+
+/* Number of coefficient arrays: Cp, Ci, Cdx, Cf, yMin, yMax */
+#define PID_HALF_NCOEFFS 6
+
+
+/* Bit patterns of float values */
+static uint32_t pid_FloatBits( float x )
+{
+	uint32_t u;
+	memcpy(&u, &x, sizeof(u));
+	return u;
+}
+
+static float pid_BitsFloat( uint32_t u )
+{
+	float x;
+	memcpy(&x, &u, sizeof(x));
+	return x;
+}
+
+
+/* Converts x to half precision, rounding to nearest even */
+static uint16_t pid_FloatToF16( float x )
+{
+	uint32_t f = pid_FloatBits(x);
+	uint32_t sign = f & 0x80000000u;
+	uint16_t h;
+
+	f ^= sign;
+	if ( f >= 0x47800000u )			/* Overflow, infinity, NaN */
+	{
+		h = (f > 0x7f800000u) ? 0x7e00 : 0x7c00;
+	}
+	else if ( f < 0x38800000u )		/* Subnormal or zero: rounded by the addition of 0.5 */
+	{
+		h = (uint16_t)(pid_FloatBits(pid_BitsFloat(f) + 0.5f) - 0x3f000000u);
+	}
+	else							/* Normal: rebias the exponent and round */
+	{
+		f += ((uint32_t)(15 - 127) << 23) + 0xfff + ((f >> 13) & 1);
+		h = (uint16_t)(f >> 13);
+	}
+	return h | (uint16_t)(sign >> 16);
+}
+
+
+/* Converts the half precision value h to float */
+static PID_INLINE float pid_F16ToFloat( uint16_t h )
+{
+	uint32_t u = (uint32_t)(h & 0x7fff) << 13;
+	uint32_t exp = u & 0x0f800000u;
+
+	u += (uint32_t)(127 - 15) << 23;
+	if ( exp == 0x0f800000u )		/* Infinity, NaN */
+	{
+		u += (uint32_t)(128 - 16) << 23;
+	}
+	else if ( exp == 0 )			/* Subnormal or zero */
+	{
+		u = pid_FloatBits(pid_BitsFloat(u + (1u << 23)) - 6.10351562e-05f);
+	}
+	return pid_BitsFloat(u | ((uint32_t)(h & 0x8000) << 16));
+}
+
+
+/* Converts x to bfloat16, rounding to nearest even */
+static uint16_t pid_FloatToBF16( float x )
+{
+	uint32_t f = pid_FloatBits(x);
+
+	if ( (f & 0x7fffffffu) > 0x7f800000u ) return (uint16_t)((f >> 16) | 0x40);
+	f += 0x7fffu + ((f >> 16) & 1);
+	return (uint16_t)(f >> 16);
+}
+
+
+static uint16_t pid_HalfFrom( PIDHalfFormat Format, PIDValue x )
+{
+	return (Format == pidHalf_F16) ? pid_FloatToF16((float)x) : pid_FloatToBF16((float)x);
+}
+
+
+
+size_t pid_HalfSize( size_t Num )
+{
+	size_t NumPad = (Num + PID_HALF_BLOCK - 1) & ~(size_t)(PID_HALF_BLOCK - 1);
+
+	return NumPad*(3*sizeof(float) + PID_HALF_NCOEFFS*sizeof(uint16_t) + sizeof(unsigned char));
+}
+
+
+
+PIDErr pid_HalfInit( PIDHalfBank* H, void* Mem, size_t Num, PIDHalfFormat Format )
+{
+	size_t NumPad = (Num + PID_HALF_BLOCK - 1) & ~(size_t)(PID_HALF_BLOCK - 1);
+	float* f = (float*)Mem;
+	uint16_t* h;
+	size_t i;
+
+	if ( (Mem == NULL) || (((uintptr_t)Mem & 15) != 0) ) return pidErr_Memory;
+
+	memset(Mem, 0, pid_HalfSize(Num));
+	H->Format = Format;
+	H->Num	  = Num;
+	H->e1	  = f;
+	H->I	  = f + NumPad;
+	H->D	  = f + 2*NumPad;
+	h		  = (uint16_t*)(f + 3*NumPad);
+	H->Cp	  = h;
+	H->Ci	  = h + NumPad;
+	H->Cdx	  = h + 2*NumPad;
+	H->Cf	  = h + 3*NumPad;
+	H->yMin	  = h + 4*NumPad;
+	H->yMax	  = h + 5*NumPad;
+	H->Arw	  = (unsigned char*)(h + 6*NumPad);
+
+	/* Zero is zero in both formats, the limits are set to infinity */
+	for (i = 0; i < NumPad; i++)
+	{
+		H->yMin[i] = (Format == pidHalf_F16) ? 0xfc00 : 0xff80;
+		H->yMax[i] = (Format == pidHalf_F16) ? 0x7c00 : 0x7f80;
+	}
+
+	return pidErr_Ok;
+}
+
+
+
+PIDErr pid_HalfSet( PIDHalfBank* H, size_t i, const PIDCoeffs* C, PIDValue yMin, PIDValue yMax, PIDArw Arw )
+{
+	if ( i >= H->Num ) return pidErr_Index;
+
+	H->Cp[i]   = pid_HalfFrom(H->Format, C->Cp);
+	H->Ci[i]   = pid_HalfFrom(H->Format, C->Ci);
+	H->Cdx[i]  = pid_HalfFrom(H->Format, (C->Cf == 0) ? C->Cd : C->Cdf);
+	H->Cf[i]   = pid_HalfFrom(H->Format, C->Cf);
+	H->yMin[i] = pid_HalfFrom(H->Format, yMin);
+	H->yMax[i] = pid_HalfFrom(H->Format, yMax);
+	H->Arw[i]  = (Arw == pidArw_On);
+
+	return pid_HalfReset(H, i, 1);
+}
+
+
+
+PIDErr pid_HalfReset( PIDHalfBank* H, size_t first, size_t n )
+{
+	size_t i;
+
+	if ( (first > H->Num) || (n > H->Num - first) ) return pidErr_Index;
+
+	for (i = first; i < first + n; i++)
+	{
+		H->e1[i] = 0;
+		H->I[i]	 = 0;
+		H->D[i]	 = 0;
+	}
+
+	return pidErr_Ok;
+}
+
+
+
+/* Steps the m <= PID_HALF_BLOCK controllers whose states start at e1,
+   Ip, and Dp with the coefficients c converted to float. The lanes are
+   independent and the limits and the anti-windup are applied by 
+   selects, so the loop has no jumps. Called with m = PID_HALF_BLOCK it 
+   is vectorized by GCC at -O2 (checked with -fopt-info-vec).
+*/
+static PID_FORCE_INLINE void pid_HalfBlockRun( float* PID_RESTRICT e1, float* PID_RESTRICT Ip,
+											   float* PID_RESTRICT Dp, const int32_t* PID_RESTRICT Arw,
+											   size_t m, float c[PID_HALF_NCOEFFS][PID_HALF_BLOCK],
+											   const PIDValue* PID_RESTRICT e, PIDValue* PID_RESTRICT y )
+{
+	float x, x1, I0, I, D, yv;
+	int hi, lo, arw;
+	size_t j;
+
+	for (j = 0; j < m; j++)
+	{
+		x  = (float)e[j];
+		x1 = e1[j];
+		I0 = Ip[j];
+#if (defined PID_INTALGO_RECT)
+		I  = I0 + c[1][j]*x1;
+#else
+		I  = I0 + c[1][j]*(x + x1);
+#endif
+		D  = c[2][j]*(x - x1) + c[3][j]*Dp[j];
+		yv = c[0][j]*x + I + D;
+
+		/* Limits and anti-windup in the order of pid_Step. The quiet
+		   comparisons cannot trap, so the compiler may evaluate both 
+		   sides of the selects.
+		*/
+		hi  = isgreater(yv, c[5][j]);
+		lo  = isless(yv, c[4][j]);
+		yv  = hi ? c[5][j] : yv;
+		yv  = (lo & !hi) ? c[4][j] : yv;
+		arw = Arw[j] & ((yv == c[5][j]) | (yv == c[4][j]));
+
+		e1[j] = x;
+		Ip[j] = arw ? I0 : I;
+		Dp[j] = D;
+		y[j]  = (PIDValue)yv;
+	}
+}
+
+/* Steps the controllers p, ..., p+m-1, full blocks with a constant
+   number of lanes
+*/
+static PID_FORCE_INLINE void pid_HalfBlock( PIDHalfBank* H, size_t p, size_t m, 
+											float c[PID_HALF_NCOEFFS][PID_HALF_BLOCK],
+											const PIDValue e[], PIDValue y[] )
+{
+	int32_t Arw[PID_HALF_BLOCK];
+	size_t j;
+
+	/* The flags are widened to the size of the floats */
+	for (j = 0; j < m; j++) Arw[j] = H->Arw[p + j];
+
+	if ( m == PID_HALF_BLOCK )
+		pid_HalfBlockRun(H->e1 + p, H->I + p, H->D + p, Arw, PID_HALF_BLOCK, c, e, y);
+	else
+		pid_HalfBlockRun(H->e1 + p, H->I + p, H->D + p, Arw, m, c, e, y);
+}
+
+
+/* Pointers to the coefficient arrays in the order of the rows of c */
+#define PID_HALF_ARRAYS(H) { (H)->Cp, (H)->Ci, (H)->Cdx, (H)->Cf, (H)->yMin, (H)->yMax }
+
+
+/* Steps the controllers first, ..., first+n-1 with the coefficients
+   converted in C. The arrays are padded, so the coefficients of the
+   blocks inside them are converted with a constant number of lanes.
+*/
+static void pid_HalfStepGeneric( PIDHalfBank* H, size_t first, size_t n, const PIDValue e[], PIDValue y[] )
+{
+	const uint16_t* a[PID_HALF_NCOEFFS] = PID_HALF_ARRAYS(H);
+	float c[PID_HALF_NCOEFFS][PID_HALF_BLOCK];
+	size_t NumPad = (H->Num + PID_HALF_BLOCK - 1) & ~(size_t)(PID_HALF_BLOCK - 1);
+	size_t p, m, j;
+	int k;
+
+	for (p = first; p < first + n; p += m)
+	{
+		m = (first + n - p < PID_HALF_BLOCK) ? first + n - p : PID_HALF_BLOCK;
+		for (k = 0; k < PID_HALF_NCOEFFS; k++)
+		{
+			if ( (H->Format == pidHalf_BF16) && (p + PID_HALF_BLOCK <= NumPad) )
+				for (j = 0; j < PID_HALF_BLOCK; j++) c[k][j] = pid_BitsFloat((uint32_t)a[k][p + j] << 16);
+			else if ( H->Format == pidHalf_BF16 )
+				for (j = 0; j < m; j++) c[k][j] = pid_BitsFloat((uint32_t)a[k][p + j] << 16);
+			else
+				for (j = 0; j < m; j++) c[k][j] = pid_F16ToFloat(a[k][p + j]);
+		}
+		pid_HalfBlock(H, p, m, c, &e[p - first], &y[p - first]);
+	}
+}
+
+
+#ifdef PID_HALF_F16C
+/* pid_HalfStepGeneric for the format pidHalf_F16 with the conversion by
+   the F16C instruction vcvtph2ps. The arrays are padded, so the last
+   block may load the coefficients of the padding.
+*/
+__attribute__((target("avx,f16c")))
+static void pid_HalfStepF16C( PIDHalfBank* H, size_t first, size_t n, const PIDValue e[], PIDValue y[] )
+{
+	const uint16_t* a[PID_HALF_NCOEFFS] = PID_HALF_ARRAYS(H);
+	float c[PID_HALF_NCOEFFS][PID_HALF_BLOCK];
+	size_t NumPad = (H->Num + PID_HALF_BLOCK - 1) & ~(size_t)(PID_HALF_BLOCK - 1);
+	size_t p, m, j;
+	int k;
+
+	for (p = first; p < first + n; p += m)
+	{
+		m = (first + n - p < PID_HALF_BLOCK) ? first + n - p : PID_HALF_BLOCK;
+		for (k = 0; k < PID_HALF_NCOEFFS; k++)
+		{
+			if ( p + PID_HALF_BLOCK <= NumPad )
+				_mm256_storeu_ps(c[k], _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)&a[k][p])));
+			else
+				for (j = 0; j < m; j++) c[k][j] = pid_F16ToFloat(a[k][p + j]);
+		}
+		pid_HalfBlock(H, p, m, c, &e[p - first], &y[p - first]);
+	}
+}
+
+
+static int pid_HalfHasF16C( void )
+{
+	static int has = -1;
+
+	if ( has < 0 ) has = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+	return has;
+}
+#endif
+
+
+
+PIDErr pid_HalfStep( PIDHalfBank* H, size_t first, size_t n, const PIDValue e[], PIDValue y[] )
+{
+	if ( (first > H->Num) || (n > H->Num - first) ) return pidErr_Index;
+
+#ifdef PID_HALF_F16C
+	if ( (H->Format == pidHalf_F16) && pid_HalfHasF16C() )
+	{
+		pid_HalfStepF16C(H, first, n, e, y);
+		return pidErr_Ok;
+	}
+#endif
+	pid_HalfStepGeneric(H, first, n, e, y);
+
+	return pidErr_Ok;
+}
+
+
+
+const char* pid_HalfKernel( const PIDHalfBank* H )
+{
+#ifdef PID_HALF_F16C
+	if ( (H->Format == pidHalf_F16) && pid_HalfHasF16C() ) return "f16c";
+#endif
+	return "generic";
+}
+
+#endif
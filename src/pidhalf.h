@@ -0,0 +1,147 @@
+/*********************************************************************
+* File: pidhalf.h
+*
+* Declaration of the compact controller bank in half precision. The
+* coefficients and limits of each controller are stored as IEEE 754
+* half precision (fp16) or bfloat16 values, the state as float. This
+* reduces the memory traffic of very large banks at the cost of the
+* accuracy of the coefficients. Only available for floating point
+* value formats (PID_VAL_FORMAT_F32, PID_VAL_FORMAT_F64).
+*
+*
+* Copyright (c) 2014 Jan Winkler, Matthias Schfer, Oscar Rivera
+* Institut fr Regelungs- und Steuerungstheorie
+* Technische Universitt Dresden / Dresden University of Technology
+* D-01062 Dresden, Germany
+*
+* Redistribution and use in source and binary forms, with or without 
+* modification, are permitted provided that the following conditions 
+* are met:
+*
+*     Redistributions of source code must retain the above copyright 
+*     notice, this list of conditions and the following disclaimer. 
+*
+*     Redistributions in binary form must not misrepresent the orignal
+*     source in the documentation and/or other materials provided 
+*     with the distribution. 
+*
+*     The names of the authors nor its contributors may be used to 
+*     endorse or promote products derived from this software without 
+*     specific prior written permission. 
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+* OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Jan.Winkler@tu-dresden.de
+* 04.06.2014
+*********************************************************************/
+#ifndef PIDHALF_H
+#define PIDHALF_H
+
+#include "pidcontrol.h"
+
+#ifndef PID_FIXPOINT
+
+/* Storage format of the coefficients and limits */
+typedef enum
+{
+	pidHalf_F16,	/* IEEE 754 half precision, 11 bit mantissa, |x| <= 65504 */
+	pidHalf_BF16	/* bfloat16, 8 bit mantissa, range of float */
+} PIDHalfFormat;
+
+
+/* Compact bank of Num controllers. The arrays are placed in the memory
+   passed to pid_HalfInit, the members are private.
+*/
+typedef struct
+{
+	PIDHalfFormat	Format;
+	size_t			Num;
+	float*			e1;		/* Last control difference */
+	float*			I;		/* I-part */
+	float*			D;		/* D-part */
+	uint16_t*		Cp;		/* Coefficients in the format Format */
+	uint16_t*		Ci;
+	uint16_t*		Cdx;	/* Cd if Cf = 0, else Cdf */
+	uint16_t*		Cf;
+	uint16_t*		yMin;	/* Limits in the format Format */
+	uint16_t*		yMax;
+	unsigned char*	Arw;	/* Anti-windup enabled */
+} PIDHalfBank;
+
+
+
+/* Returns the size of the memory for a compact bank of Num controllers.
+   Divided by Num this is the number of bytes per controller.
+*/
+size_t pid_HalfSize( size_t Num );
+
+
+
+/* Initializes the compact bank H in the memory Mem. All controllers
+   get vanishing coefficients, no limits and anti-windup disabled.
+
+   H		-> The bank to be initialized
+   Mem		-> Memory of pid_HalfSize(Num) bytes, aligned to 16 bytes
+   Num		-> Number of controllers
+   Format	-> Storage format of the coefficients and limits
+*/
+PIDErr pid_HalfInit( PIDHalfBank* H, void* Mem, size_t Num, PIDHalfFormat Format );
+
+
+
+/* Sets the coefficients, limits, and anti-windup of controller i of the
+   bank H and resets its state. The values are rounded to the nearest
+   value of the format. With pidHalf_F16 limits beyond 65504 become 
+   infinite, i.e. they are dropped.
+
+   H	-> The bank
+   i	-> Index of the controller in the bank
+   C	-> Coefficients, e.g. of pid_CoeffsCalc_K or pid_CoeffsGet
+   yMin	-> Lower limit of the output
+   yMax -> Upper limit of the output
+   Arw	-> Anti-windup
+*/
+PIDErr pid_HalfSet( PIDHalfBank* H, size_t i, const PIDCoeffs* C, PIDValue yMin, PIDValue yMax, PIDArw Arw );
+
+
+
+/* Resets the state of the controllers first, ..., first+n-1 of bank H */
+PIDErr pid_HalfReset( PIDHalfBank* H, size_t first, size_t n );
+
+
+
+/* Performs one step of calculation for the controllers first, ...,
+   first+n-1 of the bank H. The step equals the one of pid_Step with 
+   PID_STEP_BRANCHFREE, computed in float with the coefficients converted
+   from the storage format.
+
+   H	 -> The bank
+   first -> Index of the first controller
+   n	 -> Number of controllers
+   e	 -> Control differences, one per controller
+   y	 -> Array to which the n controller outputs are written
+*/
+PIDErr pid_HalfStep( PIDHalfBank* H, size_t first, size_t n, const PIDValue e[], PIDValue y[] );
+
+
+
+/* Returns the name of the conversion used by pid_HalfStep for the format
+   of bank H: "f16c" for the F16C instructions of x86 processors, which
+   are used if the processor supports them, else "generic".
+*/
+const char* pid_HalfKernel( const PIDHalfBank* H );
+
+#endif
+
+#endif
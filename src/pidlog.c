@@ -0,0 +1,273 @@
+/*********************************************************************
+* File: pidlog.c
+*
+* Implementation of the compact binary log of controller values.
+*
+* Refer to the header for more information
+*
+*
+* Copyright (c) 2014 Jan Winkler, Matthias Schfer, Oscar Rivera
+* Institut fr Regelungs- und Steuerungstheorie
+* Technische Universitt Dresden / Dresden University of Technology
+* D-01062 Dresden, Germany
+*
+* Redistribution and use in source and binary forms, with or without 
+* modification, are permitted provided that the following conditions 
+* are met:
+*
+*     Redistributions of source code must retain the above copyright 
+*     notice, this list of conditions and the following disclaimer. 
+*
+*     Redistributions in binary form must not misrepresent the orignal
+*     source in the documentation and/or other materials provided 
+*     with the distribution. 
+*
+*     The names of the authors nor its contributors may be used to 
+*     endorse or promote products derived from this software without 
+*     specific prior written permission. 
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+* OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Jan.Winkler@tu-dresden.de
+* 04.06.2014
+*********************************************************************/
+#include <string.h>
+#include "pidlog.h"
+
+
+static const unsigned char pid_LogMagic[8] = { 'P', 'I', 'D', 'L', 'O', 'G', '1', 0 };
+static const unsigned char pid_LogBlockMagic[4] = { 'P', 'I', 'D', 'B' };
+
+
+/* Little endian numbers */
+static void pid_LogPut32( unsigned char* p, uint32_t x )
+{
+	p[0] = (unsigned char)x;
+	p[1] = (unsigned char)(x >> 8);
+	p[2] = (unsigned char)(x >> 16);
+	p[3] = (unsigned char)(x >> 24);
+}
+
+static void pid_LogPut64( unsigned char* p, uint64_t x )
+{
+	pid_LogPut32(p, (uint32_t)x);
+	pid_LogPut32(p + 4, (uint32_t)(x >> 32));
+}
+
+static void pid_LogPutDouble( unsigned char* p, double x )
+{
+	uint64_t u;
+	memcpy(&u, &x, sizeof(u));
+	pid_LogPut64(p, u);
+}
+
+static uint32_t pid_LogGet32( const unsigned char* p )
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t pid_LogGet64( const unsigned char* p )
+{
+	return (uint64_t)pid_LogGet32(p) | ((uint64_t)pid_LogGet32(p + 4) << 32);
+}
+
+static double pid_LogGetDouble( const unsigned char* p )
+{
+	uint64_t u = pid_LogGet64(p);
+	double x;
+	memcpy(&x, &u, sizeof(x));
+	return x;
+}
+
+
+
+size_t pid_LogMemSize( uint32_t Num, size_t BlockBytes )
+{
+	/* A block has room for at least one tick of maximal size */
+	if ( BlockBytes < (size_t)Num*PID_LOG_VARINT_MAX ) BlockBytes = (size_t)Num*PID_LOG_VARINT_MAX;
+
+	return Num*sizeof(int64_t) + PID_LOG_BLOCK_HEADER + BlockBytes;
+}
+
+
+
+PIDErr pid_LogOpen( PIDLogEncoder* L, void* Mem, uint32_t Num, size_t BlockBytes, double Scale, 
+					double TSample, PIDLogWrite Write, void* Ctx )
+{
+	unsigned char h[PID_LOG_FILE_HEADER];
+
+	if ( (Mem == NULL) || (((uintptr_t)Mem & (sizeof(int64_t) - 1)) != 0) ) return pidErr_Memory;
+	if ( Num == 0 ) return pidErr_Index;
+	if ( TSample <= 0 ) return pidErr_TSample;
+
+	L->Write	= Write;
+	L->Ctx		= Ctx;
+	L->Num		= Num;
+	L->Scale	= Scale;
+	L->TSample	= TSample;
+	L->Prev		= (int64_t*)Mem;
+	L->Buf		= (unsigned char*)Mem + Num*sizeof(int64_t);
+	L->Size		= pid_LogMemSize(Num, BlockBytes) - Num*sizeof(int64_t);
+	L->Len		= PID_LOG_BLOCK_HEADER;
+	L->Ticks	= 0;
+	L->Tick		= 0;
+	memset(L->Prev, 0, Num*sizeof(int64_t));
+
+	memcpy(h, pid_LogMagic, sizeof(pid_LogMagic));
+	pid_LogPut32(h + 8, Num);
+	pid_LogPut32(h + 12, 0);
+	pid_LogPutDouble(h + 16, Scale);
+	pid_LogPutDouble(h + 24, TSample);
+
+	return (Write(Ctx, h, sizeof(h)) == 0) ? pidErr_Ok : pidErr_Io;
+}
+
+
+
+PIDErr pid_LogTick( PIDLogEncoder* L, const PIDValue y[] )
+{
+	unsigned char* p;
+	int64_t q, d;
+	uint64_t z;
+#ifndef PID_FIXPOINT
+	double x;
+#endif
+	uint32_t i;
+	PIDErr err;
+
+	if ( L->Len + (size_t)L->Num*PID_LOG_VARINT_MAX > L->Size )
+	{
+		err = pid_LogFlush(L);
+		if ( err != pidErr_Ok ) return err;
+	}
+
+	p = L->Buf + L->Len;
+	for (i = 0; i < L->Num; i++)
+	{
+		/* Quantize, fixpoint values are stored as they are. Floating
+		   point values saturate at the range of int64_t, NaN gives 0. */
+#ifdef PID_FIXPOINT
+		q = (int64_t)y[i];
+#else
+		x = (double)y[i]*L->Scale;
+		if ( x >= 9223372036854775808.0 )
+			q = INT64_MAX;
+		else if ( x <= -9223372036854775808.0 )
+			q = INT64_MIN;
+		else if ( x == x )
+			q = (int64_t)(x + ((x < 0) ? -0.5 : 0.5));
+		else
+			q = 0;
+#endif
+		d = (int64_t)((uint64_t)q - (uint64_t)L->Prev[i]);
+		L->Prev[i] = q;
+
+		/* Zig-zag: small magnitudes of both signs get short codes */
+		z = ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+		while ( z >= 0x80 )
+		{
+			*p++ = (unsigned char)(z | 0x80);
+			z >>= 7;
+		}
+		*p++ = (unsigned char)z;
+	}
+	L->Len = (size_t)(p - L->Buf);
+	L->Ticks++;
+	L->Tick++;
+
+	return pidErr_Ok;
+}
+
+
+
+PIDErr pid_LogFlush( PIDLogEncoder* L )
+{
+	uint64_t first = L->Tick - L->Ticks;
+
+	if ( L->Ticks == 0 ) return pidErr_Ok;
+
+	memcpy(L->Buf, pid_LogBlockMagic, sizeof(pid_LogBlockMagic));
+	pid_LogPut32(L->Buf + 4, (uint32_t)(L->Len - PID_LOG_BLOCK_HEADER));
+	pid_LogPut32(L->Buf + 8, L->Ticks);
+	pid_LogPut32(L->Buf + 12, 0);
+	pid_LogPut64(L->Buf + 16, first);
+	pid_LogPutDouble(L->Buf + 24, (double)first*L->TSample);
+
+	/* The next block starts with absolute values */
+	L->Len	 = PID_LOG_BLOCK_HEADER;
+	L->Ticks = 0;
+	memset(L->Prev, 0, L->Num*sizeof(int64_t));
+
+	return (L->Write(L->Ctx, L->Buf, PID_LOG_BLOCK_HEADER + pid_LogGet32(L->Buf + 4)) == 0) ? pidErr_Ok : pidErr_Io;
+}
+
+
+
+int pid_LogWriteFile( void* Ctx, const void* Data, size_t Len )
+{
+	return (fwrite(Data, 1, Len, (FILE*)Ctx) == Len) ? 0 : -1;
+}
+
+
+
+PIDErr pid_LogHeaderParse( const unsigned char* p, uint32_t* Num, double* Scale, double* TSample )
+{
+	if ( memcmp(p, pid_LogMagic, sizeof(pid_LogMagic)) != 0 ) return pidErr_Io;
+
+	*Num	 = pid_LogGet32(p + 8);
+	*Scale	 = pid_LogGetDouble(p + 16);
+	*TSample = pid_LogGetDouble(p + 24);
+
+	return pidErr_Ok;
+}
+
+
+
+PIDErr pid_LogBlockParse( const unsigned char* p, PIDLogBlock* B )
+{
+	if ( memcmp(p, pid_LogBlockMagic, sizeof(pid_LogBlockMagic)) != 0 ) return pidErr_Io;
+
+	B->Len	 = pid_LogGet32(p + 4);
+	B->Ticks = pid_LogGet32(p + 8);
+	B->Tick	 = pid_LogGet64(p + 16);
+	B->Time	 = pid_LogGetDouble(p + 24);
+
+	return pidErr_Ok;
+}
+
+
+
+size_t pid_LogTickDecode( const unsigned char* p, const unsigned char* end, uint32_t Num, int64_t q[] )
+{
+	const unsigned char* start = p;
+	uint64_t z;
+	unsigned s;
+	uint32_t i;
+
+	for (i = 0; i < Num; i++)
+	{
+		z = 0;
+		s = 0;
+		do
+		{
+			if ( (p == end) || (s > 63) ) return 0;
+			z |= (uint64_t)(*p & 0x7f) << s;
+			s += 7;
+		} while ( *p++ & 0x80 );
+
+		q[i] = (int64_t)((uint64_t)q[i] + ((z >> 1) ^ (0 - (z & 1))));
+	}
+
+	return (size_t)(p - start);
+}
@@ -0,0 +1,194 @@
+/*********************************************************************
+* File: pidlog.h
+*
+* Declaration of the compact binary log for the outputs (or any other
+* values) of many controllers. Each tick the values of Num controllers
+* are quantized, delta encoded against the previous tick of the same
+* controller and written as zig-zag varints. The ticks are framed into
+* blocks, each block starts with absolute values and carries its tick
+* index and time, so a reader can seek to a block without decoding the
+* ones before it. The tool piddump converts a log back to text.
+*
+* Layout (all numbers little endian):
+*   File header:  "PIDLOG1\0", uint32 Num, uint32 reserved,
+*                 double Scale, double TSample (32 bytes)
+*   Block header: "PIDB", uint32 Len (bytes of the ticks), uint32 Ticks,
+*                 uint32 reserved, uint64 Tick (index of the first
+*                 tick), double Time (32 bytes)
+*   Tick:         Num varints zigzag(q[i] - q_prev[i]), q_prev = 0 at
+*                 the start of a block
+* The value of a controller is q/Scale.
+*
+*
+* Copyright (c) 2014 Jan Winkler, Matthias Schfer, Oscar Rivera
+* Institut fr Regelungs- und Steuerungstheorie
+* Technische Universitt Dresden / Dresden University of Technology
+* D-01062 Dresden, Germany
+*
+* Redistribution and use in source and binary forms, with or without 
+* modification, are permitted provided that the following conditions 
+* are met:
+*
+*     Redistributions of source code must retain the above copyright 
+*     notice, this list of conditions and the following disclaimer. 
+*
+*     Redistributions in binary form must not misrepresent the orignal
+*     source in the documentation and/or other materials provided 
+*     with the distribution. 
+*
+*     The names of the authors nor its contributors may be used to 
+*     endorse or promote products derived from this software without 
+*     specific prior written permission. 
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+* OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Jan.Winkler@tu-dresden.de
+* 04.06.2014
+*********************************************************************/
+#ifndef PIDLOG_H
+#define PIDLOG_H
+
+#include <stdio.h>
+#include "pidcontrol.h"
+
+
+/* Sizes of the headers of the log */
+#define PID_LOG_FILE_HEADER		32
+#define PID_LOG_BLOCK_HEADER	32
+
+/* Maximal size of an encoded value */
+#define PID_LOG_VARINT_MAX		10
+
+
+/* Function to which the encoder passes the finished blocks, returns 0 on
+   success. E.g. pid_LogWriteFile or a function queueing the data for a
+   writer thread.
+*/
+typedef int (*PIDLogWrite)( void* Ctx, const void* Data, size_t Len );
+
+
+/* Encoder of a log, initialize it by pid_LogOpen. The members are private. */
+typedef struct
+{
+	PIDLogWrite		Write;
+	void*			Ctx;
+	uint32_t		Num;		/* Number of values per tick */
+	double			Scale;		/* Quantization: q = round(value*Scale) */
+	double			TSample;	/* Time between two ticks */
+	int64_t*		Prev;		/* Last quantized value of each controller */
+	unsigned char*	Buf;		/* Current block incl. header */
+	size_t			Size;		/* Size of Buf */
+	size_t			Len;		/* Bytes used in Buf */
+	uint32_t		Ticks;		/* Ticks in the current block */
+	uint64_t		Tick;		/* Index of the next tick */
+} PIDLogEncoder;
+
+
+/* Header of a block as returned by pid_LogBlockParse */
+typedef struct
+{
+	uint32_t	Len;			/* Bytes of the encoded ticks after the header */
+	uint32_t	Ticks;			/* Number of ticks */
+	uint64_t	Tick;			/* Index of the first tick */
+	double		Time;			/* Time of the first tick */
+} PIDLogBlock;
+
+
+
+/* Returns the size of the memory needed by pid_LogOpen for Num values
+   per tick and blocks of at most BlockBytes bytes of encoded ticks. A
+   block holds at least one tick.
+*/
+size_t pid_LogMemSize( uint32_t Num, size_t BlockBytes );
+
+
+
+/* Initializes the encoder L and writes the file header
+
+   L		 -> The encoder
+   Mem		 -> Memory of pid_LogMemSize(Num, BlockBytes) bytes, aligned 
+				for int64_t
+   Num		 -> Number of values per tick
+   BlockBytes -> Size of the blocks, e.g. 65536
+   Scale	 -> Values are quantized to multiples of 1/Scale. Fixpoint 
+				values are stored exactly, Scale only tells the reader 
+				their factor (e.g. PID_FIXPOINT_FACTOR).
+   TSample	 -> Time between two ticks
+   Write	 -> Function taking the encoded data
+   Ctx		 -> Context passed to Write
+*/
+PIDErr pid_LogOpen( PIDLogEncoder* L, void* Mem, uint32_t Num, size_t BlockBytes, double Scale, 
+					double TSample, PIDLogWrite Write, void* Ctx );
+
+
+
+/* Encodes one tick, i.e. the values y[0], ..., y[Num-1]. Writes the
+   current block if it is full. Floating point values are rounded to 
+   y*Scale, values beyond the range of int64_t (and infinity) are stored
+   as INT64_MIN or INT64_MAX, NaN is stored as 0.
+
+   L	-> The encoder
+   y	-> Num values, e.g. the outputs of pid_StepBank
+*/
+PIDErr pid_LogTick( PIDLogEncoder* L, const PIDValue y[] );
+
+
+
+/* Writes the current block, the next tick starts a new block. Call it
+   after the last tick.
+
+   L	-> The encoder
+*/
+PIDErr pid_LogFlush( PIDLogEncoder* L );
+
+
+
+/* Write function for a FILE* passed as Ctx */
+int pid_LogWriteFile( void* Ctx, const void* Data, size_t Len );
+
+
+
+/* Parses the file header at p
+
+   p		-> PID_LOG_FILE_HEADER bytes
+   *Num		-> Number of values per tick
+   *Scale	-> Quantization factor
+   *TSample -> Time between two ticks
+*/
+PIDErr pid_LogHeaderParse( const unsigned char* p, uint32_t* Num, double* Scale, double* TSample );
+
+
+
+/* Parses the block header at p
+
+   p	-> PID_LOG_BLOCK_HEADER bytes
+   B	-> The header is written here
+*/
+PIDErr pid_LogBlockParse( const unsigned char* p, PIDLogBlock* B );
+
+
+
+/* Decodes one tick of Num values starting at p. The values q are the
+   ones of the previous tick on entry (all 0 at the start of a block)
+   and the ones of this tick on return. Returns the number of bytes 
+   read, 0 if the data ends before the tick.
+
+   p	-> Encoded ticks
+   end	-> End of the encoded ticks
+   Num	-> Number of values per tick
+   q	-> Quantized values, divide them by Scale
+*/
+size_t pid_LogTickDecode( const unsigned char* p, const unsigned char* end, uint32_t Num, int64_t q[] );
+
+#endif
@@ -0,0 +1,343 @@
+/*********************************************************************
+* File: pidscan.c
+*
+* Implementation of the parallel evaluation of a long trace. Compile
+* this file together with pidcontrol.c and link with -pthread.
+*
+* Refer to the header for more information
+*
+*
+* Copyright (c) 2014 Jan Winkler, Matthias Schfer, Oscar Rivera
+* Institut fr Regelungs- und Steuerungstheorie
+* Technische Universitt Dresden / Dresden University of Technology
+* D-01062 Dresden, Germany
+*
+* Redistribution and use in source and binary forms, with or without 
+* modification, are permitted provided that the following conditions 
+* are met:
+*
+*     Redistributions of source code must retain the above copyright 
+*     notice, this list of conditions and the following disclaimer. 
+*
+*     Redistributions in binary form must not misrepresent the orignal
+*     source in the documentation and/or other materials provided 
+*     with the distribution. 
+*
+*     The names of the authors nor its contributors may be used to 
+*     endorse or promote products derived from this software without 
+*     specific prior written permission. 
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+* OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Jan.Winkler@tu-dresden.de
+* 04.06.2014
+*********************************************************************/
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "pidscan.h"
+
+
+/* The predictions are calculated with the same integer products as the
+   calculation step so that the I-part is predicted exactly. With 
+   saturating arithmetic the products and differences of the inputs are
+   saturated like in pid_Step, only a saturation of the parts themselves
+   causes a deviation.
+*/
+#ifdef PID_FIXPOINT_SATURATE
+#define PID_SCAN_WIDE(x) ((PIDWideValue)(x))
+#define PID_SCAN_SAT(x)  pid_ScanSat(x)
+
+static PIDValue pid_ScanSat( PIDWideValue x )
+{
+	return (x > PID_VAL_MAX) ? PID_VAL_MAX : ((x < PID_VAL_MIN) ? PID_VAL_MIN : (PIDValue)x);
+}
+#else
+#define PID_SCAN_WIDE(x) (x)
+#define PID_SCAN_SAT(x)  (x)
+#endif
+
+
+/* Data shared by all threads working on a trace */
+typedef struct PIDScanJobStruct
+{
+	PIDInd			id;
+	PIDCoeffs		C;
+	const PIDValue*	e;
+	PIDValue*		y;
+	size_t			n;
+	size_t			Len;	/* Samples per chunk, the last one may be shorter */
+	unsigned		Threads;
+
+	/* Range of chunks [First, Last) processed by the current phase */
+	unsigned		First;
+	unsigned		Last;
+	void			(*Func)( struct PIDScanJobStruct* job, unsigned c );
+
+	/* Transform of chunk c without anti-windup:
+	   I_end = I_start + dI[c], D_end = aD[c]*D_start + bD[c]
+	*/
+	PIDValue*		dI;
+	double*			aD;
+	PIDValue*		bD;
+
+	/* (Predicted) state at the start and state at the end of chunk c */
+	PIDState*		Start;
+	PIDState*		End;
+} PIDScanJob;
+
+
+/* Data of one thread */
+typedef struct
+{
+	PIDScanJob*	job;
+	unsigned	t;
+} PIDScanWorker;
+
+
+
+/* Computes the transform of the I- and D-part over chunk c. The
+   control difference before the chunk is taken from the trace or
+   from the start state for the first chunk.
+*/
+static void pid_ScanTransform( PIDScanJob* job, unsigned c )
+{
+	const PIDCoeffs* C = &job->C;
+	const PIDValue* e = job->e;
+	size_t k, s0 = c*job->Len, s1 = s0 + job->Len;
+	PIDValue e1, dI = 0, bD = 0, Cdx;
+	double aD = 1, Cf;
+
+	if ( s1 > job->n ) s1 = job->n;
+	e1  = (c == 0) ? job->Start[0].e[0] : e[s0-1];
+	Cdx = (C->Cf == 0) ? C->Cd : C->Cdf;
+	Cf  = (double)C->Cf PID_FIXPOINT_CORR_MUL;
+
+	for (k = s0; k < s1; k++)
+	{
+#ifdef PID_INTALGO_RECT
+		dI += PID_SCAN_SAT((PID_SCAN_WIDE(C->Ci)*e1) PID_FIXPOINT_CORR_MUL);
+#else
+		dI += PID_SCAN_SAT((PID_SCAN_WIDE(C->Ci)*PID_SCAN_SAT(PID_SCAN_WIDE(e[k]) + e1)) PID_FIXPOINT_CORR_MUL);
+#endif
+		bD  = (PIDValue)((PID_SCAN_WIDE(Cdx)*PID_SCAN_SAT(PID_SCAN_WIDE(e[k]) - e1) + PID_SCAN_WIDE(C->Cf)*bD) PID_FIXPOINT_CORR_MUL);
+		aD *= Cf;
+		e1  = e[k];
+	}
+
+	job->dI[c] = dI;
+	job->aD[c] = aD;
+	job->bD[c] = bD;
+}
+
+
+
+/* Steps chunk c from its (predicted) start state */
+static void pid_ScanRun( PIDScanJob* job, unsigned c )
+{
+	size_t s0 = c*job->Len, s1 = s0 + job->Len;
+
+	if ( s1 > job->n ) s1 = job->n;
+	job->End[c] = job->Start[c];
+	pid_StepBlockState(job->id, &job->End[c], &job->e[s0], &job->y[s0], s1 - s0);
+}
+
+
+
+/* Thread function: processes every Threads-th chunk of the range */
+static void* pid_ScanWorkerFunc( void* arg )
+{
+	PIDScanWorker* w = (PIDScanWorker*)arg;
+	PIDScanJob* job = w->job;
+	unsigned c;
+
+	for (c = job->First + w->t; c < job->Last; c += job->Threads)
+	{
+		job->Func(job, c);
+	}
+	return NULL;
+}
+
+
+
+/* Calls Func for the chunks [First, Last) using all threads. The share
+   of threads which cannot be created is processed by the caller.
+*/
+static void pid_ScanParallel( PIDScanJob* job, void (*Func)( PIDScanJob*, unsigned ),
+							  unsigned First, unsigned Last, 
+							  pthread_t* Tid, PIDScanWorker* w )
+{
+	unsigned t;
+
+	job->Func  = Func;
+	job->First = First;
+	job->Last  = Last;
+
+	for (t = 1; t < job->Threads; t++)
+	{
+		w[t].job = job;
+		w[t].t   = t;
+		if ( pthread_create(&Tid[t], NULL, pid_ScanWorkerFunc, &w[t]) != 0 )
+		{
+			w[t].job = NULL;
+		}
+	}
+
+	w[0].job = job;
+	w[0].t   = 0;
+	pid_ScanWorkerFunc(&w[0]);
+
+	for (t = 1; t < job->Threads; t++)
+	{
+		if ( w[t].job != NULL ) pthread_join(Tid[t], NULL);
+		else
+		{
+			w[t].job = job;
+			pid_ScanWorkerFunc(&w[t]);
+		}
+	}
+}
+
+
+
+/* Predicts the start states of the chunks c+1, ... from the start
+   state of chunk c (prefix scan of the transforms)
+*/
+static void pid_ScanPredict( PIDScanJob* job, unsigned c, unsigned Chunks )
+{
+	PIDState* st;
+	size_t s0;
+
+	for (c = c + 1; c < Chunks; c++)
+	{
+		st = &job->Start[c];
+		s0 = c*job->Len;
+		st->e[0] = job->e[s0-1];
+		st->e[1] = (s0 >= 2) ? job->e[s0-2] : job->Start[0].e[0];
+		st->y[0] = st->y[1] = 0;
+		st->P    = 0;
+		st->I    = st[-1].I + job->dI[c-1];
+		st->D    = (PIDValue)(job->aD[c-1]*st[-1].D + job->bD[c-1]);
+#ifdef PID_INTEGRATOR_COMPENSATED
+		st->Ic   = 0;
+#endif
+	}
+}
+
+
+
+PIDErr pid_StepTrace( PIDInd id, const PIDValue e[], PIDValue y[], size_t n, 
+					  unsigned Threads, PIDValue Tol, unsigned* Rounds )
+{
+	PIDScanJob job;
+	PIDErr err;
+	PIDState st;
+	pthread_t* Tid;
+	PIDScanWorker* w;
+	unsigned c, Chunks, First, NumRounds = 0;
+	double Dev, d;
+
+	if ( Rounds != NULL ) *Rounds = 0;
+
+	err = pid_StateGet(id, &st);
+	if ( err != pidErr_Ok ) return err;
+	if ( n == 0 ) return pidErr_Ok;
+
+	if ( Threads == 0 )
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		Threads = (cpus > 0) ? (unsigned)cpus : 1;
+	}
+	if ( Threads > n ) Threads = (unsigned)n;
+
+	/* Split the trace into chunks of equal length */
+	Chunks  = Threads*PID_SCAN_CHUNKS_PER_THREAD;
+	if ( Chunks > n ) Chunks = (unsigned)n;
+	job.Len = (n + Chunks - 1)/Chunks;
+	Chunks  = (unsigned)((n + job.Len - 1)/job.Len);
+
+	job.dI    = malloc(Chunks*sizeof(PIDValue));
+	job.aD    = malloc(Chunks*sizeof(double));
+	job.bD    = malloc(Chunks*sizeof(PIDValue));
+	job.Start = malloc(Chunks*sizeof(PIDState));
+	job.End   = malloc(Chunks*sizeof(PIDState));
+	Tid       = malloc(Threads*sizeof(pthread_t));
+	w         = malloc(Threads*sizeof(PIDScanWorker));
+
+	if ( Threads == 1 || !job.dI || !job.aD || !job.bD || !job.Start || 
+		 !job.End || !Tid || !w )
+	{
+		/* Sequential calculation */
+		err = pid_StepBlock(id, e, y, n);
+		NumRounds = 1;
+	}
+	else
+	{
+		job.id      = id;
+		job.e       = e;
+		job.y       = y;
+		job.n       = n;
+		job.Threads = Threads;
+		job.Start[0] = st;
+		pid_CoeffsGet(id, &job.C);
+
+		/* The transforms do not depend on the state */
+		pid_ScanParallel(&job, pid_ScanTransform, 0, Chunks - 1, Tid, w);
+
+		First = 0;
+		Dev   = 0;
+		while ( First < Chunks )
+		{
+			/* Step all chunks from First on from their predicted states.
+			   Chunk First starts from the end state of its predecessor,
+			   which carries the deviations accepted so far.
+			*/
+			pid_ScanPredict(&job, First, Chunks);
+			pid_ScanParallel(&job, pid_ScanRun, First, Chunks, Tid, w);
+			NumRounds++;
+
+			/* Accept the chunks as long as the deviation of the predicted
+			   start states from the end states of the preceding chunks,
+			   accumulated over all rounds, stays within the tolerance. The
+			   deviation is caused by the anti-windup, saturation, and
+			   rounding.
+			*/
+			for (c = First + 1; c < Chunks; c++)
+			{
+				d = fabs((double)job.Start[c].I - (double)job.End[c-1].I)
+				  + fabs((double)job.Start[c].D - (double)job.End[c-1].D);
+				if ( Dev + d > (double)Tol ) break;
+				Dev += d;
+			}
+
+			First = c;
+			if ( First < Chunks ) job.Start[First] = job.End[First-1];
+		}
+
+		pid_StateSet(id, &job.End[Chunks-1]);
+	}
+
+	free(job.dI);
+	free(job.aD);
+	free(job.bD);
+	free(job.Start);
+	free(job.End);
+	free(Tid);
+	free(w);
+
+	if ( Rounds != NULL ) *Rounds = NumRounds;
+
+	return err;
+}
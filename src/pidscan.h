@@ -0,0 +1,100 @@
+/*********************************************************************
+* File: pidscan.h
+*
+* Parallel evaluation of one controller over a long trace of control
+* differences. Between the events at which the anti-windup drops the
+* integration the state of the controller follows a linear recurrence:
+* the I-part accumulates increments and the D-part is a first order
+* filter. The trace is split into chunks, the affine transform of the
+* state over each chunk is computed in parallel, the start states of
+* the chunks are predicted by a prefix scan and the chunks are stepped
+* in parallel from the predicted states. Chunks whose predicted start
+* state does not match the end state of their predecessor (anti-windup,
+* saturation, rounding) are computed again from the correct state.
+*
+* The file needs POSIX threads (link with -pthread).
+*
+* pid_StepTrace		-> Steps a controller over a long trace using several threads
+*
+*
+* Copyright (c) 2014 Jan Winkler, Matthias Schfer, Oscar Rivera
+* Institut fr Regelungs- und Steuerungstheorie
+* Technische Universitt Dresden / Dresden University of Technology
+* D-01062 Dresden, Germany
+*
+* Redistribution and use in source and binary forms, with or without 
+* modification, are permitted provided that the following conditions 
+* are met:
+*
+*     Redistributions of source code must retain the above copyright 
+*     notice, this list of conditions and the following disclaimer. 
+*
+*     Redistributions in binary form must not misrepresent the orignal
+*     source in the documentation and/or other materials provided 
+*     with the distribution. 
+*
+*     The names of the authors nor its contributors may be used to 
+*     endorse or promote products derived from this software without 
+*     specific prior written permission. 
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS 
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE 
+* COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, 
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, 
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+* OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+* Jan.Winkler@tu-dresden.de
+* 04.06.2014
+*********************************************************************/
+#ifndef PIDSCAN_H
+#define PIDSCAN_H
+
+#include "pidcontrol.h"
+
+/* Number of chunks per thread the trace is split into. More chunks 
+   reduce the work which has to be repeated after an anti-windup event
+   but increase the sequential part of the prefix scan.
+*/
+#ifndef PID_SCAN_CHUNKS_PER_THREAD
+#define PID_SCAN_CHUNKS_PER_THREAD 4
+#endif
+
+
+/* Steps the controller over the trace e with the result of n calls of
+   pid_Step. The controller starts from its current state and holds the
+   final state afterwards.
+
+   The results are the ones of the sequential calculation within the
+   tolerance Tol: the sum of the deviations of the I- and D-part at all
+   chunk boundaries which are accepted without repetition is limited to
+   Tol over the whole trace, hence the outputs deviate at most by Tol
+   (plus the rounding errors of floating point arithmetic) from the ones
+   of pid_StepBlock as long as the deviation does not change an
+   anti-windup decision. With fixpoint arithmetic the I-part is predicted
+   exactly, the filtered D-part deviates by a few digits due to the
+   rounding of the products. Tol = 0 therefore gives identical results
+   for controllers without D-filter, but with a D-filter or floating 
+   point arithmetic it makes the calculation sequential (each chunk is
+   repeated). If memory or threads are not available the trace is
+   processed by pid_StepBlock.
+
+   id		-> Index of the controller
+   e		-> The control differences of the n steps
+   y		-> Array to which the n controller outputs are written
+   n		-> Number of samples
+   Threads	-> Number of threads to use, 0 uses all online processors
+   Tol		-> Tolerance of the state deviation (see above)
+   Rounds	-> If not NULL, the number of parallel rounds is written
+			   to it (1 if no chunk had to be repeated)
+*/
+PIDErr pid_StepTrace( PIDInd id, const PIDValue e[], PIDValue y[], size_t n, 
+					  unsigned Threads, PIDValue Tol, unsigned* Rounds );
+
+#endif
@@ -5,7 +5,13 @@
 // https://cboard.cprogramming.com/c-programming/173070-strtod-standard-library-not-working.html
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
+#include <float.h>
 #include "pidcontrol.h"
+#include "pidscan.h"
+#include "pidhalf.h"
+#include "pidlog.h"
+#include "pidexec.h"
 
 #ifdef PID_FIXPOINT
 /* Define sample variance threshold depending on the 
@@ -52,6 +58,1210 @@
 #define DEFAULT_SAMPLE_VAR_THRESH 2e-13
 #endif
 
+/* Names of the failed consistency checks, each one is reported once */
+static const char* check_names[32];
+static int check_num = 0;
+
+static void check_fail(int* failed, const char* what)
+{
+	int k;
+
+	*failed = 1;
+	for (k = 0; k < check_num; k++)
+		if (strcmp(check_names[k], what) == 0) return;
+	if (check_num < 32) check_names[check_num++] = what;
+}
+
+/* Memory to which the binary log is written */
+typedef struct
+{
+	unsigned char* Data;
+	size_t Len;
+	size_t Size;
+} LogBuf;
+
+static int log_Append(void* Ctx, const void* Data, size_t Len)
+{
+	LogBuf* b = (LogBuf*)Ctx;
+	unsigned char* Data2;
+
+	if (b->Len + Len > b->Size) {
+		Data2 = realloc(b->Data, 2*(b->Len + Len));
+		if (Data2 == NULL) return -1;
+		b->Data = Data2;
+		b->Size = 2*(b->Len + Len);
+	}
+	memcpy(b->Data + b->Len, Data, Len);
+	b->Len += Len;
+	return 0;
+}
+
+/* Inputs and outputs of the cyclic executor on the simulated clock */
+typedef struct
+{
+	const PIDValue* e;
+	PIDValue* y[3];
+	uint64_t* t[3];			/* Ticks of the steps */
+	int n[3];				/* Steps of each controller */
+	PIDExecSimClock* Clk;
+	uint64_t BurstTick;		/* First cycle which takes Cost nanoseconds */
+	int Bursts;				/* Number of such cycles */
+	PIDExecTime Cost;
+	uint64_t StopTick;
+	PIDExec* X;
+} ExecIo;
+
+static void exec_Sense(void* Ctx, uint64_t Tick, PIDInd first, PIDInd n, PIDValue e[])
+{
+	ExecIo* io = (ExecIo*)Ctx;
+	PIDInd j;
+
+	for (j = 0; j < n; j++)
+		e[j] = io->e[io->n[first + j]];
+	if (first == 0 && Tick >= io->BurstTick && io->Bursts > 0) {
+		io->Clk->Time += io->Cost;
+		io->Bursts--;
+	}
+}
+
+static void exec_Actuate(void* Ctx, uint64_t Tick, PIDInd first, PIDInd n, const PIDValue y[])
+{
+	ExecIo* io = (ExecIo*)Ctx;
+	PIDInd j;
+
+	for (j = 0; j < n; j++) {
+		io->t[first + j][io->n[first + j]] = Tick;
+		io->y[first + j][io->n[first + j]++] = y[j];
+	}
+	if (Tick == io->StopTick) pid_ExecStop(io->X);
+}
+
+/* Reference data and outputs of pid_Step the tests compare with */
+typedef struct
+{
+	size_t DataSets;		/* Number of samples, at least 1 */
+	const double* eSim;
+	const PIDValue* eLib;
+	const PIDValue* yPLib;
+	const PIDValue* yPILib;
+	const PIDValue* yPIDLib;
+	PIDValue Kp, Ki, Kd, Tf, TSample;
+} TestData;
+
+/* A gain schedule with identical coefficient blocks has to reproduce
+ * the results of pid_Step exactly */
+static int test_Schedule(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* eLib = T->eLib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	const PIDValue Kp = T->Kp;
+	const PIDValue Ki = T->Ki;
+	const PIDValue Kd = T->Kd;
+	const PIDValue Tf = T->Tf;
+	const PIDValue TSample = T->TSample;
+	PIDValue yCheck;
+	PIDCoeffs Coeffs[2];
+	PIDSchedule Sched;
+	int i;
+
+	pid_CoeffsCalc_K(Kp, Ki, Kd, Tf, TSample, &Coeffs[0]);
+	Coeffs[1] = Coeffs[0];
+	pid_ScheduleInit(&Sched, Coeffs, 2, 0, 1);
+	pid_ScheduleSet(2, &Sched);
+	pid_Reset(2);
+	for (i=0; i < DataSets; i++)
+	{
+		pid_StepSched(2, eLib[i], eLib[i], &yCheck);
+		if (yCheck != yPIDLib[i]) check_fail(failed, "gain schedule");
+	}
+	pid_ScheduleSet(2, NULL);
+
+	/* Halfway between the gains -M and M of a P-controller the gain is 0,
+	 * without overflow of the fixpoint products. A table mixing blocks
+	 * with and without D-filter is rejected */
+	memset(Coeffs, 0, sizeof(Coeffs));
+	Coeffs[0].Cp = -(PID_VAL_MAX/2);
+	Coeffs[1].Cp = PID_VAL_MAX/2;
+	pid_ScheduleInit(&Sched, Coeffs, 2, 0, 2);
+	pid_ScheduleSet(2, &Sched);
+	pid_Reset(2);
+	pid_StepSched(2, 1, (PIDValue)(1 PID_FIXPOINT_CORR_DIV), &yCheck);
+	if (yCheck != 0) check_fail(failed, "gain schedule");
+	pid_ScheduleSet(2, NULL);
+	Coeffs[1].Cf = Coeffs[0].Cf + 1;
+	if (pid_ScheduleInit(&Sched, Coeffs, 2, 0, 2) != pidErr_Schedule) check_fail(failed, "gain schedule");
+#ifdef PID_FIXPOINT
+	/* A D-filter coefficient above 1 could overflow the wide sum */
+	Coeffs[0].Cf = Coeffs[1].Cf = PID_FIXPOINT_FACTOR + 1;
+	if (pid_ScheduleInit(&Sched, Coeffs, 2, 0, 2) != pidErr_Schedule) check_fail(failed, "gain schedule");
+#endif
+
+	return 0;
+}
+
+/* Steps with the variable sample time dt = TSample have to reproduce
+ * the results of pid_Step (exactly with fixpoint arithmetic) */
+static int test_StepDt(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* eLib = T->eLib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	const PIDValue Kp = T->Kp;
+	const PIDValue Ki = T->Ki;
+	const PIDValue Kd = T->Kd;
+	const PIDValue Tf = T->Tf;
+	const PIDValue TSample = T->TSample;
+	PIDValue yCheck;
+	int i;
+
+	pid_Reset(2);
+	for (i=0; i < DataSets; i++)
+	{
+		pid_StepDt(2, eLib[i], TSample, &yCheck);
+#ifdef PID_FIXPOINT
+		if (yCheck != yPIDLib[i]) check_fail(failed, "pid_StepDt");
+#else
+		if (fabs(yCheck - yPIDLib[i]) > 1e-5*(1 + fabs(yPIDLib[i]))) check_fail(failed, "pid_StepDt");
+#endif
+	}
+
+	/* With dt = 2*TSample the precomputed factors have to give the
+	 * results of a controller set up for that sample time */
+	{
+		PIDValue* yRef = malloc(DataSets*sizeof(PIDValue));
+
+		if (yRef == NULL) return 1;
+		pid_ParaSet_K(2, Kp, Ki, Kd, Tf, 2*TSample);
+		pid_Reset(2);
+		for (i=0; i < DataSets; i++)
+			pid_Step(2, eLib[i], &yRef[i]);
+		pid_ParaSet_K(2, Kp, Ki, Kd, Tf, TSample);
+		pid_Reset(2);
+		for (i=0; i < DataSets; i++)
+		{
+			pid_StepDt(2, eLib[i], 2*TSample, &yCheck);
+#ifdef PID_FIXPOINT
+			if (yCheck != yRef[i]) check_fail(failed, "pid_StepDt");
+#else
+			if (fabs(yCheck - yRef[i]) > 1e-5*(1 + fabs(yRef[i]))) check_fail(failed, "pid_StepDt");
+#endif
+		}
+		free(yRef);
+	}
+
+#if (defined PID_VAL_FORMAT_I32) || (defined PID_VAL_FORMAT_I64)
+	/* Parameters for which the factors of pid_StepDt round Ci differently
+	 * than pid_ParaSet_K, dt = TSample still has to give pid_Step */
+	{
+		PIDValue* yRef = malloc(DataSets*sizeof(PIDValue));
+
+		if (yRef == NULL) return 1;
+		pid_ParaSet_K(2, 20000, 10000, 40000, 6, 3);
+		pid_Reset(2);
+		for (i=0; i < DataSets; i++)
+			pid_Step(2, eLib[i], &yRef[i]);
+		pid_Reset(2);
+		for (i=0; i < DataSets; i++)
+		{
+			pid_StepDt(2, eLib[i], 3, &yCheck);
+			if (yCheck != yRef[i]) check_fail(failed, "pid_StepDt");
+		}
+		pid_ParaSet_K(2, Kp, Ki, Kd, Tf, TSample);
+		free(yRef);
+	}
+#endif
+
+	return 0;
+}
+
+/* A controller reset by pid_InitRange has the default state (no
+ * limits, sample time 1, output 0). Configured again it has to
+ * reproduce the results of pid_Step exactly */
+static int test_DefaultState(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* eLib = T->eLib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	const PIDValue Kp = T->Kp;
+	const PIDValue Ki = T->Ki;
+	const PIDValue Kd = T->Kd;
+	const PIDValue Tf = T->Tf;
+	const PIDValue TSample = T->TSample;
+	PIDValue Kp_Read, Ki_Read, Kd_Read, Tf_Read, TSample_Read, yCheck;
+	int i;
+	PIDValue yMin, yMax;
+
+	pid_InitRange(2, 1);
+	pid_LimitsGet(2, &yMin, &yMax);
+	pid_ParaGet_K(2, &Kp_Read, &Ki_Read, &Kd_Read, &Tf_Read, &TSample_Read);
+	if (yMin != PID_VAL_MIN || yMax != PID_VAL_MAX || TSample_Read != 1) check_fail(failed, "default state");
+	pid_Step(2, eLib[DataSets - 1], &yCheck);
+	if (yCheck != 0) check_fail(failed, "default state");
+	pid_StepDt(2, eLib[DataSets - 1], TSample, &yCheck);
+	if (yCheck != 0) check_fail(failed, "default state");
+
+	pid_InitRange(2, 1);
+	pid_ParaSet_K(2, Kp, Ki, Kd, Tf, TSample);
+	for (i=0; i < DataSets; i++)
+	{
+		pid_Step(2, eLib[i], &yCheck);
+		if (yCheck != yPIDLib[i]) check_fail(failed, "default state");
+	}
+
+	/* A further pid_Init resets the used controllers as well */
+	pid_LimitsSet(2, -Kp, Kp);
+	pid_Init();
+	pid_LimitsGet(2, &yMin, &yMax);
+	pid_ParaGet_K(2, &Kp_Read, &Ki_Read, &Kd_Read, &Tf_Read, &TSample_Read);
+	if (yMin != PID_VAL_MIN || yMax != PID_VAL_MAX || TSample_Read != 1 || Kp_Read != 0) check_fail(failed, "default state");
+	pid_Step(2, eLib[DataSets - 1], &yCheck);
+	if (yCheck != 0) check_fail(failed, "default state");
+	pid_ParaSet_K(0, Kp, 0, 0, 0, TSample);
+	pid_ParaSet_K(1, Kp, Ki, 0, 0, TSample);
+	pid_ParaSet_K(2, Kp, Ki, Kd, Tf, TSample);
+
+	return 0;
+}
+
+/* The bulk operations on the group {0, 2} have to give the results
+ * of the operations on the single controllers, controller 1 has to
+ * stay unchanged */
+static int test_Groups(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* yPILib = T->yPILib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	PIDValue P_Read, I_Read, D_Read;
+	static const uint64_t Bits[1] = { 5 };
+	PIDValue Pg[2], Ig[2], Dg[2], yMin, yMax, I1;
+	PIDArw Arw;
+	PIDGroup G;
+	int j;
+
+	pid_GroupInit(&G, "outer", 0, 3, Bits);
+	if (pid_GroupSize(&G) != 2) check_fail(failed, "groups");
+	pid_IPartSet(1, yPILib[DataSets - 1]);
+	pid_GroupIPartSet(&G, yPIDLib[DataSets - 1]);
+	pid_GroupPartsGet(&G, Pg, Ig, Dg);
+	for (j=0; j < 2; j++) {
+		pid_PartsGet(2*j, &P_Read, &I_Read, &D_Read);
+		if (Pg[j] != P_Read || Ig[j] != I_Read || Dg[j] != D_Read || I_Read != yPIDLib[DataSets - 1]) check_fail(failed, "groups");
+	}
+	pid_GroupLimitsSet(&G, -yPIDLib[DataSets - 1], yPIDLib[DataSets - 1]);
+	pid_GroupArwSet(&G, pidArw_On);
+	pid_LimitsGet(2, &yMin, &yMax);
+	pid_ArwGet(2, &Arw);
+	if (yMin != -yPIDLib[DataSets - 1] || yMax != yPIDLib[DataSets - 1] || Arw != pidArw_On) check_fail(failed, "groups");
+	pid_GroupReset(&G);
+	pid_GroupPartsGet(&G, Pg, Ig, Dg);
+	if (Ig[0] != 0 || Ig[1] != 0) check_fail(failed, "groups");
+	pid_LimitsGet(1, &yMin, &yMax);
+	pid_ArwGet(1, &Arw);
+	pid_PartsGet(1, &P_Read, &I1, &D_Read);
+	if (yMin != PID_VAL_MIN || yMax != PID_VAL_MAX || Arw != pidArw_Off || I1 != yPILib[DataSets - 1]) check_fail(failed, "groups");
+
+	/* Back to the configuration of the reference data */
+	pid_GroupInit(&G, "all", 0, 3, NULL);
+	pid_GroupLimitsSet(&G, PID_VAL_MIN, PID_VAL_MAX);
+	pid_GroupArwSet(&G, pidArw_Off);
+	pid_GroupReset(&G);
+
+	return 0;
+}
+
+/* The values seen by a consumer of the changes of the outputs have
+ * to stay within the deadband of the outputs of pid_Step, with a
+ * deadband of 0 they have to be identical */
+static int test_Export(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* eLib = T->eLib;
+	const PIDValue* yPILib = T->yPILib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	int i;
+	PIDExportEntry Out[3];
+	PIDExport X;
+	PIDValue ek[3], yk[3], View[3], Band;
+	void* Mem = malloc(pid_ExportMemSize(3));
+	size_t m, k, Sent = 0;
+	int j, b;
+
+	if (Mem == NULL) return 1;
+	for (b=0; b < 2; b++) {
+		Band = (b == 0) ? 0 : yPIDLib[DataSets - 1]/16;
+		if (Band < 0) Band = -Band;
+		pid_ExportInit(&X, Mem, 0, 3, pidExp_Y, Band);
+		for (j=0; j < 3; j++) {
+			pid_Reset(j);
+			View[j] = 0;
+		}
+		for (i=0; i < DataSets; i++) {
+			ek[0] = ek[1] = ek[2] = eLib[i];
+			pid_StepBankExport(0, 3, ek, yk, &X);
+			m = pid_ExportCollect(&X, Out, 3);
+			for (k=0; k < m; k++)
+				View[Out[k].Id] = Out[k].Value;
+			Sent += m;
+			if (yPIDLib[i] - View[2] > Band || View[2] - yPIDLib[i] > Band ||
+				yPILib[i] - View[1] > Band || View[1] - yPILib[i] > Band) check_fail(failed, "change export");
+		}
+	}
+	printf("change export: %lu of %lu values sent\n", (unsigned long)Sent, (unsigned long)(6*DataSets));
+	free(Mem);
+
+	return 0;
+}
+
+/* The event-triggered step with the threshold 0 skips the steps with
+ * an unchanged control difference only. For a control difference held
+ * over 8 samples its outputs at the first two samples (a change and a
+ * quiet step) have to equal the ones of pid_StepBank (exactly with 
+ * fixpoint arithmetic), also with limits and anti-windup. With floating
+ * point the catch-up of the I-part rounds differently, the deviation
+ * accumulates with the I-part, hence it is relative to the largest
+ * output */
+static int test_Event(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* eLib = T->eLib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	int i;
+	PIDEvent V;
+	PIDEventStats St;
+	PIDValue ek[3], yk[3], yLim = 0;
+	double yAbs;
+	PIDValue* yRef = malloc(3*(DataSets > 202 ? DataSets : 202)*sizeof(PIDValue));
+	void* Mem = malloc(pid_EventMemSize(3));
+	int j, b, r;
+
+	if (yRef == NULL || Mem == NULL) return 1;
+	for (i=0; i < DataSets; i++)
+		if (yPIDLib[i] > yLim) yLim = yPIDLib[i]/2;
+	for (b=0; b < 2; b++) {
+		for (j=0; j < 3; j++) {
+			pid_Reset(j);
+			if (b == 1) {
+				pid_LimitsSet(j, -yLim, yLim);
+				pid_ArwSet(j, pidArw_On);
+			}
+		}
+		for (i=0; i < DataSets; i++) {
+			ek[0] = ek[1] = ek[2] = eLib[i & ~7];
+			pid_StepBank(0, 3, ek, &yRef[3*i]);
+		}
+		for (i=0, yAbs=0; i < 3*DataSets; i++)
+			if (fabs(yRef[i]) > yAbs) yAbs = fabs(yRef[i]);
+
+		for (j=0; j < 3; j++)
+			pid_Reset(j);
+		yk[0] = yk[1] = yk[2] = 0;
+		pid_EventInit(&V, Mem, 0, 3, 0, 1000);
+		for (i=0; i < DataSets; i++) {
+			ek[0] = ek[1] = ek[2] = eLib[i & ~7];
+			pid_StepBankEvent(0, 3, ek, yk, &V);
+			/* A skipped controller holds the output of the second sample */
+			r = ((i & 7) == 0) ? i : (i & ~7) + 1;
+			for (j=0; j < 3; j++) {
+#ifdef PID_FIXPOINT
+				if (yk[j] != yRef[3*r + j]) check_fail(failed, "event-triggered step");
+#else
+				if (fabs(yk[j] - yRef[3*r + j]) > 1e-5*(1 + yAbs)) check_fail(failed, "event-triggered step");
+#endif
+			}
+		}
+	}
+	for (j=0; j < 3; j++) {
+		pid_LimitsSet(j, PID_VAL_MIN, PID_VAL_MAX);
+		pid_ArwSet(j, pidArw_Off);
+	}
+	pid_EventStatsRead(&V, &St);
+	printf("event-triggered step: %lu of %lu steps skipped\n", (unsigned long)St.Skips, (unsigned long)(St.Steps + St.Skips));
+
+	/* A control difference held over 200 samples is caught up at
+	 * once by the change at sample 200, 198 skipped steps exceed the
+	 * range of the narrow formats */
+	for (b=0; b < 2; b++) {
+		for (j=0; j < 3; j++)
+			pid_Reset(j);
+		if (b == 1) pid_EventInit(&V, Mem, 0, 3, 0, 1000);
+		for (i=0; i < 202; i++) {
+#ifdef PID_FIXPOINT
+			ek[0] = ek[1] = ek[2] = (i < 200) ? 40 : 0;
+#else
+			ek[0] = ek[1] = ek[2] = (i < 200) ? (PIDValue)0.004 : 0;
+#endif
+			if (b == 0)
+				pid_StepBank(0, 3, ek, &yRef[3*i]);
+			else
+				pid_StepBankEvent(0, 3, ek, yk, &V);
+		}
+	}
+	for (j=0; j < 3; j++) {
+#ifdef PID_FIXPOINT
+		if (yk[j] != yRef[3*201 + j]) check_fail(failed, "event-triggered step");
+#else
+		if (fabs(yk[j] - yRef[3*201 + j]) > 1e-5*(1 + fabs(yRef[3*201 + j]))) check_fail(failed, "event-triggered step");
+#endif
+	}
+	pid_EventStatsRead(&V, &St);
+	if (St.Skips != 3*198) check_fail(failed, "event-triggered step");
+	free(Mem);
+	free(yRef);
+
+	return 0;
+}
+
+/* The input stage has to compute the control differences of the
+ * reference data from raw samples like the conversion of eLib above.
+ * The samples are the values of eSim, the gain of -1 and the setpoint 0
+ * give e = 0 - (-eSim). The input stage saturates the control
+ * differences, the conversion of eLib not, hence the check needs data
+ * which fit the value format */
+static int test_Input(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const double* eSim = T->eSim;
+	const PIDValue* yPLib = T->yPLib;
+	const PIDValue* yPILib = T->yPILib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	int i;
+	struct { uint16_t Status; double Value; } Adc[3];
+	PIDStrided Raw = { &Adc[0].Value, sizeof(Adc[0]), pidIo_F64 };
+	PIDInput V;
+	PIDValue yk[3];
+	void* Mem = malloc(pid_InputMemSize(3));
+	int j, fits = 1;
+
+	if (Mem == NULL) return 1;
+#ifdef PID_FIXPOINT
+	for (i=0; i < DataSets; i++)
+		if (eSim[i]*PID_FIXPOINT_FACTOR <= PID_VAL_MIN || eSim[i]*PID_FIXPOINT_FACTOR >= PID_VAL_MAX) fits = 0;
+#endif
+	pid_InputInit(&V, Mem, 0, 3);
+	for (j=0; j < 3; j++) {
+		pid_InputSet(&V, j, -1, 0, 1, 0);
+		pid_Reset(j);
+	}
+	for (i=0; fits && i < DataSets; i++) {
+		for (j=0; j < 3; j++)
+			Adc[j].Value = eSim[i];
+		pid_StepBankRaw(0, 3, &Raw, NULL, &V, yk);
+		if (yk[0] != yPLib[i] || yk[1] != yPILib[i] || yk[2] != yPIDLib[i]) check_fail(failed, "input stage");
+	}
+	/* A NaN sample gives the control difference 0 */
+	for (j=0; j < 3; j++) {
+		pid_InputSet(&V, j, -1, 0, 1, 0);
+		pid_Reset(j);
+		Adc[j].Value = NAN;
+	}
+	pid_StepBankRaw(0, 3, &Raw, NULL, &V, yk);
+	if (yk[0] != 0 || yk[1] != 0 || yk[2] != 0) check_fail(failed, "input stage");
+	for (j=0; j < 3; j++)
+		pid_Reset(j);
+	free(Mem);
+
+	return 0;
+}
+
+/* Stepping the three controllers on members of application structs
+ * has to reproduce the results of pid_Step exactly */
+static int test_Strided(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* eLib = T->eLib;
+	const PIDValue* yPLib = T->yPLib;
+	const PIDValue* yPILib = T->yPILib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	int i;
+	struct { short Pad; double y; int Cnt; } Drives[3];
+#ifdef PID_FIXPOINT
+	struct { char Tag; int32_t e; } Sensors[3];
+	PIDStrided eIo = { &Sensors[0].e, sizeof(Sensors[0]), pidIo_I32 };
+#else
+	struct { char Tag; double e; } Sensors[3];
+	PIDStrided eIo = { &Sensors[0].e, sizeof(Sensors[0]), pidIo_F64 };
+#endif
+	PIDStrided yIo = { &Drives[0].y, sizeof(Drives[0]), pidIo_F64 };
+	int j;
+
+	for (j=0; j < 3; j++)
+		pid_Reset(j);
+	for (i=0; i < DataSets; i++) {
+		for (j=0; j < 3; j++) {
+#ifdef PID_FIXPOINT
+			Sensors[j].e = (int32_t)eLib[i];
+#else
+			Sensors[j].e = (double)eLib[i];
+#endif
+		}
+		pid_StepStrided(0, 3, &eIo, &yIo);
+		if (Drives[0].y != (double)yPLib[i] || Drives[1].y != (double)yPILib[i] || Drives[2].y != (double)yPIDLib[i]) check_fail(failed, "strided step");
+	}
+
+#ifndef PID_FIXPOINT
+	/* Outputs to integer types saturate, NaN gives 0 */
+	{
+		PIDValue eSat[3] = { (PIDValue)1e30, (PIDValue)-1e30, (PIDValue)NAN };
+		int64_t y64[3];
+		int8_t y8[3];
+		PIDStrided eSatIo = { eSat, sizeof(PIDValue), pidIo_Value };
+		PIDStrided y64Io = { y64, sizeof(int64_t), pidIo_I64 };
+		PIDStrided y8Io = { y8, sizeof(int8_t), pidIo_I8 };
+
+		for (j=0; j < 3; j++)
+			pid_Reset(j);
+		pid_StepStrided(0, 3, &eSatIo, &y64Io);
+		if (y64[0] != INT64_MAX || y64[1] != INT64_MIN || y64[2] != 0) check_fail(failed, "strided step");
+		for (j=0; j < 3; j++)
+			pid_Reset(j);
+		pid_StepStrided(0, 3, &eSatIo, &y8Io);
+		if (y8[0] != INT8_MAX || y8[1] != INT8_MIN || y8[2] != 0) check_fail(failed, "strided step");
+		for (j=0; j < 3; j++)
+			pid_Reset(j);
+	}
+#else
+	/* Inputs beyond the range of PIDValue saturate, NaN gives 0. The
+	 * controllers have no gains to keep the arithmetic in range */
+	{
+		double eF64[3] = { 1e30, -1e30, NAN };
+		int64_t eI64[3] = { INT64_MAX, INT64_MIN, 5 };
+		PIDValue ySat[3];
+		PIDStrided eF64Io = { eF64, sizeof(double), pidIo_F64 };
+		PIDStrided eI64Io = { eI64, sizeof(int64_t), pidIo_I64 };
+		PIDStrided ySatIo = { ySat, sizeof(PIDValue), pidIo_Value };
+		PIDState St[3];
+
+		for (j=0; j < 3; j++) {
+			pid_ParaSet_K(j, 0, 0, 0, 0, T->TSample);
+			pid_Reset(j);
+		}
+		pid_StepStrided(0, 3, &eF64Io, &ySatIo);
+		for (j=0; j < 3; j++) {
+			pid_StateGet(j, &St[j]);
+			pid_Reset(j);
+		}
+		if (St[0].e[0] != PID_VAL_MAX || St[1].e[0] != PID_VAL_MIN || St[2].e[0] != 0) check_fail(failed, "strided step");
+		pid_StepStrided(0, 3, &eI64Io, &ySatIo);
+		for (j=0; j < 3; j++)
+			pid_StateGet(j, &St[j]);
+		if (St[0].e[0] != PID_VAL_MAX || St[1].e[0] != PID_VAL_MIN || St[2].e[0] != 5) check_fail(failed, "strided step");
+		pid_ParaSet_K(0, T->Kp, 0, 0, 0, T->TSample);
+		pid_ParaSet_K(1, T->Kp, T->Ki, 0, 0, T->TSample);
+		pid_ParaSet_K(2, T->Kp, T->Ki, T->Kd, T->Tf, T->TSample);
+		for (j=0; j < 3; j++)
+			pid_Reset(j);
+	}
+#endif
+
+	return 0;
+}
+
+/* Stepping over the whole data as one block has to reproduce the
+ * results of pid_Step exactly, including the final parts. The output
+ * is the sum of the parts, saturated with PID_FIXPOINT_SATURATE */
+static int test_Block(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* eLib = T->eLib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	PIDValue P_Read, I_Read, D_Read;
+	PIDValue* yBlock = malloc(DataSets*sizeof(PIDValue));
+	PIDValue* PBlock = malloc(DataSets*sizeof(PIDValue));
+	PIDValue* IBlock = malloc(DataSets*sizeof(PIDValue));
+	PIDValue* DBlock = malloc(DataSets*sizeof(PIDValue));
+	int i;
+
+	if (yBlock == NULL || PBlock == NULL || IBlock == NULL || DBlock == NULL) return 1;
+	pid_Reset(2);
+	pid_StepBlockParts(2, eLib, yBlock, PBlock, IBlock, DBlock, DataSets);
+	pid_PartsGet(2, &P_Read, &I_Read, &D_Read);
+	for (i=0; i < DataSets; i++) {
+#ifdef PID_FIXPOINT_SATURATE
+		PIDWideValue ySum = (PIDWideValue)PBlock[i] + IBlock[i] + DBlock[i];
+		if (ySum > PID_VAL_MAX) ySum = PID_VAL_MAX;
+		if (ySum < PID_VAL_MIN) ySum = PID_VAL_MIN;
+#else
+		PIDValue ySum = (PIDValue)(PBlock[i] + IBlock[i] + DBlock[i]);
+#endif
+		if (yBlock[i] != yPIDLib[i] || yBlock[i] != (PIDValue)ySum) check_fail(failed, "block step");
+	}
+	if (P_Read != PBlock[DataSets-1] || I_Read != IBlock[DataSets-1] || D_Read != DBlock[DataSets-1]) check_fail(failed, "block step");
+	pid_Reset(2);
+	pid_StepBlock(2, eLib, yBlock, DataSets);
+	for (i=0; i < DataSets; i++)
+		if (yBlock[i] != yPIDLib[i]) check_fail(failed, "block step");
+	free(yBlock);
+	free(PBlock);
+	free(IBlock);
+	free(DBlock);
+
+	return 0;
+}
+
+/* The parallel evaluation of the trace has to reproduce the results
+ * of pid_Step within its tolerance, floating point adds the rounding
+ * errors of the prediction. With limits and anti-windup the chunks
+ * behind an anti-windup event have to be repeated. */
+static int test_Trace(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* eLib = T->eLib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	PIDValue* yRef = malloc(DataSets*sizeof(PIDValue));
+	PIDValue* yBlock = malloc(DataSets*sizeof(PIDValue));
+	PIDValue yLim = 0, TraceTol;
+	double TraceSlack;
+	unsigned Rounds;
+	int i, b;
+
+	if (yRef == NULL || yBlock == NULL) return 1;
+
+#ifdef PID_FIXPOINT
+	/* A digit of the rounding of the D-filter at each of the 15 chunk
+	 * boundaries */
+	TraceTol = 16;
+	TraceSlack = 0;
+#else
+	TraceTol = (PIDValue)1e-4;
+	TraceSlack = 1e-6;
+#endif
+	for (i=0; i < DataSets; i++)
+		if (yPIDLib[i] > yLim) yLim = yPIDLib[i]/2;
+	for (b=0; b < 2; b++) {
+		if (b == 1) {
+			pid_LimitsSet(2, -yLim, yLim);
+			pid_ArwSet(2, pidArw_On);
+			pid_Reset(2);
+			for (i=0; i < DataSets; i++)
+				pid_Step(2, eLib[i], &yRef[i]);
+		} else {
+			memcpy(yRef, yPIDLib, DataSets*sizeof(PIDValue));
+		}
+		pid_Reset(2);
+		Rounds = 0;
+		pid_StepTrace(2, eLib, yBlock, DataSets, 4, TraceTol, &Rounds);
+		for (i=0; i < DataSets; i++)
+			if ((double)yBlock[i] - yRef[i] > TraceTol + TraceSlack || (double)yRef[i] - yBlock[i] > TraceTol + TraceSlack) check_fail(failed, "parallel trace");
+		/* 16 chunks of 4 threads: without limits the prediction is
+		 * accepted at once (fixpoint may need a 2nd round due to the
+		 * rounding of the D-filter), anti-windup events force repetitions */
+		if (Rounds < 1 || Rounds > 16 || (b == 0 && Rounds > 2) || (b == 1 && Rounds < 2)) check_fail(failed, "parallel trace");
+	}
+	pid_ArwSet(2, pidArw_Off);
+	pid_LimitsSet(2, PID_VAL_MIN, PID_VAL_MAX);
+	free(yBlock);
+	free(yRef);
+
+	return 0;
+}
+
+/* The online statistics of the batched step have to match the ones
+ * computed from the outputs and the I-parts of pid_Step */
+static int test_Stats(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* eLib = T->eLib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	PIDValue yCheck, P_Read, I_Read, D_Read;
+	PIDStats St;
+	PIDStatsValues StV;
+	double Mean = 0, M2 = 0, MeanSq = 0, dx;
+#ifdef PID_VAL_FORMAT_F32
+	double StatTol = 1e-3;
+#else
+	double StatTol = 1e-9;	/* accumulated in double */
+#endif
+	PIDValue IMin = 0, IMax = 0;
+	uint32_t Sat = 0;
+	int i;
+
+	pid_StatsReset(&St, 1);
+	pid_Reset(2);
+	for (i=0; i < DataSets; i++) {
+		pid_StepBankStats(2, 1, &eLib[i], &yCheck, &St, (PIDStatValue)0.1);
+		if (yCheck != yPIDLib[i]) check_fail(failed, "online statistics");
+		dx = (double)eLib[i] - Mean;
+		Mean += dx/(i + 1);
+		M2 += dx*((double)eLib[i] - Mean);
+		MeanSq += 0.1*((double)eLib[i]*eLib[i] - MeanSq);
+		pid_PartsGet(2, &P_Read, &I_Read, &D_Read);
+		if (i == 0 || I_Read < IMin) IMin = I_Read;
+		if (i == 0 || I_Read > IMax) IMax = I_Read;
+		if (yPIDLib[i] == PID_VAL_MAX || yPIDLib[i] == PID_VAL_MIN) Sat++;
+	}
+	pid_StatsRead(&St, 1, &StV);
+	if (DataSets > 1 && (StV.Count != (uint32_t)DataSets || StV.IMin != IMin || StV.IMax != IMax ||
+		StV.SatFrac != (PIDStatValue)Sat/DataSets ||
+		fabs(StV.Mean - Mean) > StatTol*(1 + fabs(Mean)) ||
+		fabs(StV.Var - M2/(DataSets - 1)) > StatTol*(1 + M2/(DataSets - 1)) ||
+		fabs(StV.MeanSq - MeanSq) > StatTol*(1 + MeanSq))) check_fail(failed, "online statistics");
+
+	return 0;
+}
+
+#ifndef PID_FIXPOINT
+/* The compact bank in half precision has to follow the outputs of
+ * pid_Step within the accuracy of its coefficients. All controllers
+ * of a bank of 19 stepped together (full blocks and the rest) have
+ * to give the results of a single one */
+static int test_Half(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* eLib = T->eLib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	PIDValue yCheck;
+	int i;
+	PIDCoeffs C;
+	PIDHalfBank Half, HalfN;
+	PIDHalfFormat Fmt;
+	PIDValue eN[19], yN[19];
+	float* HalfMem = malloc(pid_HalfSize(1));
+	float* HalfMemN = malloc(pid_HalfSize(19));
+	double yMaxAbs = 0, Err;
+	int j;
+
+	if (HalfMem == NULL || HalfMemN == NULL) return 1;
+	for (i=0; i < DataSets; i++)
+		if (fabs(yPIDLib[i]) > yMaxAbs) yMaxAbs = fabs(yPIDLib[i]);
+	pid_CoeffsGet(2, &C);
+	for (Fmt = pidHalf_F16; Fmt <= pidHalf_BF16; Fmt++) {
+		pid_HalfInit(&Half, HalfMem, 1, Fmt);
+		pid_HalfSet(&Half, 0, &C, PID_VAL_MIN, PID_VAL_MAX, pidArw_Off);
+		pid_HalfInit(&HalfN, HalfMemN, 19, Fmt);
+		for (j=0; j < 19; j++)
+			pid_HalfSet(&HalfN, j, &C, PID_VAL_MIN, PID_VAL_MAX, pidArw_Off);
+		Err = 0;
+		for (i=0; i < DataSets; i++) {
+			pid_HalfStep(&Half, 0, 1, &eLib[i], &yCheck);
+			if (fabs(yCheck - yPIDLib[i]) > Err) Err = fabs(yCheck - yPIDLib[i]);
+			for (j=0; j < 19; j++)
+				eN[j] = eLib[i];
+			pid_HalfStep(&HalfN, 0, 19, eN, yN);
+			for (j=0; j < 19; j++)
+				if (yN[j] != yCheck) check_fail(failed, "half precision");
+		}
+		printf("half precision %s (%s): max. error %e\n", Fmt == pidHalf_F16 ? "F16" : "BF16", pid_HalfKernel(&Half), Err/yMaxAbs);
+		if (Err > (Fmt == pidHalf_F16 ? 2e-3 : 1.6e-2)*yMaxAbs) check_fail(failed, "half precision");
+	}
+	free(HalfMemN);
+	free(HalfMem);
+
+	return 0;
+}
+#endif
+
+#ifndef PID_FIXPOINT
+/* Over a long run the I-part of a F32 controller drifts from the sum
+ * of its increments in double precision, with PID_INTEGRATOR_COMPENSATED
+ * it has to stay within a few units of the last place. A state saved
+ * by pid_StateGet and restored by pid_StateSet (including the rounding
+ * error of the compensation) has to continue with the same outputs */
+static int test_Compensated(const TestData* T, int* failed)
+{
+	const PIDValue Kp = T->Kp;
+	const PIDValue Ki = T->Ki;
+	const PIDValue Kd = T->Kd;
+	const PIDValue Tf = T->Tf;
+	const PIDValue TSample = T->TSample;
+	PIDValue P_Read, I_Read, D_Read, yCheck;
+	PIDState St;
+	PIDValue eI = (PIDValue)0.1, yRun[16];
+	double ISum = 0, Drift;
+	long k;
+
+	pid_ParaSet_K(2, 0, Ki, 0, 0, TSample);
+	pid_Reset(2);
+	for (k=0; k < 1000000; k++) {
+#ifdef PID_INTALGO_RECT
+		ISum += (double)(PIDValue)(Ki*TSample*(k > 0 ? eI : 0));
+#else
+		ISum += (double)(PIDValue)((Ki*TSample/2)*(eI + (k > 0 ? eI : 0)));
+#endif
+		pid_Step(2, eI, &yCheck);
+	}
+	pid_PartsGet(2, &P_Read, &I_Read, &D_Read);
+	Drift = fabs((double)I_Read - ISum)/ISum;
+	printf("I-part drift after %ld steps: %e\n", k, Drift);
+#if (defined PID_INTEGRATOR_COMPENSATED) && (defined PID_VAL_FORMAT_F32)
+	if (Drift > 4*FLT_EPSILON) check_fail(failed, "compensated I-part");
+#endif
+	pid_StateGet(2, &St);
+	for (k=0; k < 16; k++)
+		pid_Step(2, eI, &yRun[k]);
+	pid_StateSet(2, &St);
+	for (k=0; k < 16; k++) {
+		pid_Step(2, eI, &yCheck);
+		if (yCheck != yRun[k]) check_fail(failed, "compensated I-part");
+	}
+	pid_ParaSet_K(2, Kp, Ki, Kd, Tf, TSample);
+	pid_Reset(2);
+
+	return 0;
+}
+#endif
+
+/* The binary log of the outputs and control differences has to decode
+ * to the quantized values, exactly for fixpoint. The small blocks make
+ * the decoder start over several times. */
+static int test_Log(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* eLib = T->eLib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	const PIDValue TSample = T->TSample;
+	int i;
+	PIDLogEncoder Log;
+	PIDLogBlock Block;
+	LogBuf Out = { NULL, 0, 0 };
+	uint32_t LogNum;
+	double LogScale, LogTs;
+	int64_t q[2];
+	PIDValue ye[2];
+	size_t pos, len;
+	uint32_t k;
+	int64_t* LogMem = malloc(pid_LogMemSize(2, 64));
+	int n = 0, bad = 0;
+
+	if (LogMem == NULL) return 1;
+	pid_LogOpen(&Log, LogMem, 2, 64, 1e6, TSample, log_Append, &Out);
+	for (i=0; i < DataSets; i++) {
+		ye[0] = yPIDLib[i];
+		ye[1] = eLib[i];
+		pid_LogTick(&Log, ye);
+	}
+	if (pid_LogFlush(&Log) != pidErr_Ok || Out.Data == NULL) return 1;
+
+	if (pid_LogHeaderParse(Out.Data, &LogNum, &LogScale, &LogTs) != pidErr_Ok || LogNum != 2) bad = 1;
+	for (pos = PID_LOG_FILE_HEADER; !bad && pos < Out.Len; pos += Block.Len) {
+		if (pid_LogBlockParse(Out.Data + pos, &Block) != pidErr_Ok || Block.Tick != (uint64_t)n) bad = 1;
+		pos += PID_LOG_BLOCK_HEADER;
+		q[0] = q[1] = 0;
+		for (k = 0, len = 0; !bad && k < Block.Ticks; k++, n++) {
+			len += pid_LogTickDecode(Out.Data + pos + len, Out.Data + pos + Block.Len, 2, q);
+#ifdef PID_FIXPOINT
+			if (q[0] != yPIDLib[n] || q[1] != eLib[n]) bad = 1;
+#else
+			if (fabs(q[0]/LogScale - yPIDLib[n]) > 0.5e-6*(1 + 1e-9*fabs(yPIDLib[n])) || 
+				fabs(q[1]/LogScale - eLib[n]) > 0.5e-6*(1 + 1e-9*fabs(eLib[n]))) bad = 1;
+#endif
+		}
+		if (len != Block.Len) bad = 1;
+	}
+	if (bad || n != DataSets) check_fail(failed, "binary log");
+	printf("binary log: %lu bytes for %lu ticks of 2 values\n", (unsigned long)Out.Len, (unsigned long)DataSets);
+
+#ifndef PID_FIXPOINT
+	/* Values beyond the range of int64_t saturate, NaN is logged as 0 */
+	Out.Len = 0;
+	pid_LogOpen(&Log, LogMem, 2, 64, 1e6, TSample, log_Append, &Out);
+	ye[0] = (PIDValue)INFINITY;
+	ye[1] = (PIDValue)-1e30;
+	pid_LogTick(&Log, ye);
+	ye[0] = (PIDValue)NAN;
+	ye[1] = (PIDValue)-INFINITY;
+	pid_LogTick(&Log, ye);
+	if (pid_LogFlush(&Log) != pidErr_Ok || Out.Data == NULL) return 1;
+	q[0] = q[1] = 0;
+	pos = PID_LOG_FILE_HEADER + PID_LOG_BLOCK_HEADER;
+	pos += pid_LogTickDecode(Out.Data + pos, Out.Data + Out.Len, 2, q);
+	if (q[0] != INT64_MAX || q[1] != INT64_MIN) check_fail(failed, "binary log");
+	pid_LogTickDecode(Out.Data + pos, Out.Data + Out.Len, 2, q);
+	if (q[0] != 0 || q[1] != INT64_MIN) check_fail(failed, "binary log");
+#endif
+	free(Out.Data);
+	free(LogMem);
+
+	return 0;
+}
+
+/* The cyclic executor on the simulated clock has to step controller 2
+ * with the double sample time every second cycle like pid_Step, and
+ * has to handle an overrun of 2.5 sample times at cycle 10 by its
+ * policy. A step after dropped releases or with reduced rates has to
+ * use the elapsed time. Two overruns in a row degrade the rates to
+ * 1/2 only if the limit of the divisor is 3. */
+static int test_Exec(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* eLib = T->eLib;
+	const PIDValue* yPLib = T->yPLib;
+	const PIDValue* yPILib = T->yPILib;
+	const PIDValue Kp = T->Kp;
+	const PIDValue Ki = T->Ki;
+	const PIDValue Kd = T->Kd;
+	const PIDValue Tf = T->Tf;
+	const PIDValue TSample = T->TSample;
+	PIDValue yCheck;
+	int i;
+#ifdef PID_FIXPOINT
+	const double TimeUnit = 0.1;
+#else
+	const double TimeUnit = 1;
+#endif
+	const PIDExecOverrun Policy[6] = { pidOvr_Skip, pidOvr_CatchUp, pidOvr_CatchUp, pidOvr_Degrade, pidOvr_Degrade, pidOvr_Degrade };
+	const unsigned Limit[6] = { 1, 8, 1, 4, 4, 3 };
+	const int Bursts[6] = { 1, 1, 1, 1, 2, 2 };
+	/* Cycles, Misses, Late, Skipped, Degraded, Steps */
+	const uint64_t Expect[6][6] = { { 38, 1, 0, 2, 0, 114 }, { 40, 2, 1, 0, 0, 120 },
+									{ 39, 1, 0, 1, 0, 117 }, { 38, 1, 0, 2, 8, 102 },
+									{ 36, 2, 0, 4, 18, 75 }, { 36, 2, 0, 4, 10, 93 } };
+	PIDExecSimClock Clk = { 0 };
+	PIDExecClock Clock;
+	PIDExecCycle Rec[4];
+	PIDExecStats St;
+	PIDExec X;
+	PIDExecRt Rt;
+	ExecIo io;
+	void* Mem = malloc(pid_ExecMemSize(3));
+	int j, p;
+
+	if (Mem == NULL) return 1;
+	memset(&io, 0, sizeof(io));
+	io.e = eLib;
+	io.Clk = &Clk;
+	io.X = &X;
+	io.BurstTick = io.StopTick = UINT64_MAX;
+	for (j=0; j < 3; j++) {
+		io.y[j] = malloc((DataSets + 64)*sizeof(PIDValue));
+		io.t[j] = malloc((DataSets + 64)*sizeof(uint64_t));
+		if (io.y[j] == NULL || io.t[j] == NULL) return 1;
+		pid_Reset(j);
+	}
+	pid_ExecClockSim(&Clock, &Clk);
+	pid_ParaSet_K(2, Kp, Ki, Kd, Tf, 2*TSample);
+	if (pid_ExecInit(&X, Mem, 0, 3, TimeUnit, &Clock) != pidErr_Ok) check_fail(failed, "cyclic executor");
+	pid_ExecIoSet(&X, exec_Sense, exec_Actuate, &io);
+	pid_ExecRecordSet(&X, Rec, 4);
+	pid_ExecRun(&X, DataSets);
+	pid_ExecStatsRead(&X, &St);
+	if (St.Cycles != (uint64_t)DataSets || St.Misses != 0 || St.LatencyMax != 0 || 
+		St.Steps != (uint64_t)(2*DataSets + (DataSets + 1)/2) || Rec[0].Stepped != 3 || Rec[1].Stepped != 2 ||
+		Clk.Time != (PIDExecTime)(DataSets - 1)*(PIDExecTime)llround((double)TSample*TimeUnit*1e9)) check_fail(failed, "cyclic executor");
+	pid_Reset(2);
+	for (i=0; i < DataSets; i++) {
+		if (io.y[0][i] != yPLib[i] || io.y[1][i] != yPILib[i]) check_fail(failed, "cyclic executor");
+		if (i < io.n[2]) {
+			pid_Step(2, eLib[i], &yCheck);
+			if (io.y[2][i] != yCheck) check_fail(failed, "cyclic executor");
+		}
+	}
+	pid_ParaSet_K(2, Kp, Ki, Kd, Tf, TSample);
+
+	for (p=0; p < 6; p++) {
+		memset(io.n, 0, sizeof(io.n));
+		io.BurstTick = 10;
+		io.Bursts = Bursts[p];
+		io.Cost = (PIDExecTime)(2.5*(double)TSample*TimeUnit*1e9);
+		for (j=0; j < 3; j++)
+			pid_Reset(j);
+		pid_ExecInit(&X, Mem, 0, 3, TimeUnit, &Clock);
+		pid_ExecIoSet(&X, exec_Sense, exec_Actuate, &io);
+		pid_ExecPolicySet(&X, Policy[p], Limit[p], 8);
+		pid_ExecRun(&X, 40);
+		pid_ExecStatsRead(&X, &St);
+		if (St.Cycles != Expect[p][0] || St.Misses != Expect[p][1] || St.Late != Expect[p][2] ||
+			St.Skipped != Expect[p][3] || St.Degraded != Expect[p][4] || St.Steps != Expect[p][5]) check_fail(failed, "cyclic executor");
+		for (j=0; j < 3; j++) {
+			pid_Reset(j);
+			for (i=0; i < io.n[j]; i++) {
+				if (i == 0 || io.t[j][i] - io.t[j][i-1] == 1)
+					pid_Step(j, eLib[i], &yCheck);
+				else
+					pid_StepDt(j, eLib[i], TSample*(PIDValue)(io.t[j][i] - io.t[j][i-1]), &yCheck);
+				if (io.y[j][i] != yCheck) check_fail(failed, "cyclic executor");
+			}
+		}
+	}
+
+	io.BurstTick = UINT64_MAX;
+	io.StopTick = 5;
+	pid_ExecInit(&X, Mem, 0, 3, TimeUnit, &Clock);
+	pid_ExecIoSet(&X, exec_Sense, exec_Actuate, &io);
+	memset(io.n, 0, sizeof(io.n));
+	pid_ExecRun(&X, 0);
+	pid_ExecStatsRead(&X, &St);
+	if (St.Cycles != 6) check_fail(failed, "cyclic executor");
+	/* Sample times of 50 ns are below the smallest base period */
+	if (pid_ExecInit(&X, Mem, 0, 3, TimeUnit*1e-7, &Clock) != pidErr_TSample) check_fail(failed, "cyclic executor");
+	memset(&Rt, 0, sizeof(Rt));
+	Rt.Cpu = 1 << 30;
+	if (pid_ExecRtSetup(&Rt, NULL) != pidErr_Index) check_fail(failed, "cyclic executor");
+	printf("cyclic executor: %lu cycles, %lu missed, %lu releases skipped\n", 
+		   (unsigned long)St.Cycles, (unsigned long)St.Misses, (unsigned long)St.Skipped);
+
+	for (j=0; j < 3; j++) {
+		free(io.y[j]);
+		free(io.t[j]);
+		pid_Reset(j);
+	}
+	free(Mem);
+
+	return 0;
+}
+
+#ifdef PID_OUTPUT_STAGE
+/* The output stage has to rate limit the outputs of pid_Step and has
+ * to convert them to codes of a 12 bit DAC like a separate pass. A
+ * flight recorder has to hold the rate limited outputs. */
+static int test_OutStage(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* eLib = T->eLib;
+	const PIDValue* yPLib = T->yPLib;
+	const PIDValue* yPILib = T->yPILib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	int i;
+	PIDOutStage S;
+	PIDValue ek[3], yk[3], yMaxAbs = 1, ys = 0;
+	int32_t uk[3], u;
+	double x;
+	int j;
+#ifdef PID_FLIGHT_RECORDER
+	PIDRecSample RecBuf[16], RecOut[16];
+	PIDValue yHist[16];
+	PIDRecorder Rec;
+	uint32_t k, m;
+#endif
+
+	for (i=0; i < DataSets; i++)
+		if (fabs((double)yPIDLib[i]) > yMaxAbs) yMaxAbs = (PIDValue)fabs((double)yPIDLib[i]);
+	S.Slew	 = yMaxAbs/8;
+	S.Band	 = S.Slew/4;
+	S.Gain	 = 2047.0/(double)yMaxAbs;
+	S.Offset = 2048;
+	S.uMin	 = 0;
+	S.uMax	 = 4095;
+	pid_OutStageSet(2, &S);
+#ifdef PID_FLIGHT_RECORDER
+	pid_RecInit(&Rec, RecBuf, 16, 0, 0, NULL, NULL);
+	pid_RecSet(2, &Rec);
+#endif
+	for (j=0; j < 3; j++)
+		pid_Reset(j);
+	for (i=0; i < DataSets; i++) {
+		ek[0] = ek[1] = ek[2] = eLib[i];
+		pid_StepBankOut(0, 3, ek, yk, uk);
+		if ((double)yPIDLib[i] - (double)ys > (double)S.Slew) ys = ys + S.Slew;
+		else if ((double)yPIDLib[i] - (double)ys < -(double)S.Slew) ys = ys - S.Slew;
+		else ys = yPIDLib[i];
+		x = (ys <= S.Band && ys >= -S.Band) ? S.Offset : S.Gain*(double)ys + S.Offset;
+		u = (int32_t)(x < 0 ? 0 : (x > 4095 ? 4095 : x + 0.5));
+		if (yk[0] != yPLib[i] || yk[1] != yPILib[i] || yk[2] != ys || uk[2] != u) check_fail(failed, "output stage");
+#ifdef PID_FLIGHT_RECORDER
+		yHist[i & 15] = ys;
+#endif
+	}
+#ifdef PID_FLIGHT_RECORDER
+	m = pid_RecRead(&Rec, RecOut, 16);
+	for (k=0; k < m; k++)
+		if (RecOut[k].y != yHist[(DataSets - m + k) & 15]) check_fail(failed, "output stage");
+	pid_RecSet(2, NULL);
+#endif
+
+#ifndef PID_FIXPOINT
+	/* A NaN output gives the code of the output 0, without a stage 0 */
+	for (j=0; j < 3; j++)
+		pid_Reset(j);
+	ek[0] = ek[1] = ek[2] = (PIDValue)NAN;
+	pid_StepBankOut(0, 3, ek, yk, uk);
+	if (uk[0] != 0 || uk[1] != 0 || uk[2] != 2048) check_fail(failed, "output stage");
+	for (j=0; j < 3; j++)
+		pid_Reset(j);
+#endif
+	pid_OutStageSet(2, NULL);
+
+	return 0;
+}
+#endif
+
+#ifdef PID_FLIGHT_RECORDER
+/* The flight recorder has to freeze 4 steps after the output reached
+ * the upper limit and has to hold the last 16 outputs. The limit is
+ * the maximum output, so the outputs are not changed by it. */
+static int test_Recorder(const TestData* T, int* failed)
+{
+	const size_t DataSets = T->DataSets;
+	const PIDValue* eLib = T->eLib;
+	const PIDValue* yPIDLib = T->yPIDLib;
+	PIDValue yCheck, P_Read, I_Read, D_Read;
+	int i;
+	PIDRecSample RecBuf[16], RecOut[16];
+	PIDRecorder Rec;
+	PIDValue yLim;
+	uint32_t m;
+	int k0 = 0, b;
+
+	for (i=1; i < DataSets; i++)
+		if (yPIDLib[i] > yPIDLib[k0]) k0 = i;
+	pid_RecInit(&Rec, RecBuf, 16, 4, pidRec_SatMax, NULL, NULL);
+	pid_RecSet(2, &Rec);
+	pid_LimitsSet(2, PID_VAL_MIN, yPIDLib[k0]);
+	pid_Reset(2);
+	for (i=0; i < DataSets; i++)
+		pid_Step(2, eLib[i], &yCheck);
+	if (k0 >= 11 && k0 + 4 < DataSets) {
+		if (pid_RecFrozen(&Rec) != pidRec_SatMax || pid_RecRead(&Rec, RecOut, 16) != 16) check_fail(failed, "flight recorder");
+		for (i=0; i < 16; i++)
+			if (RecOut[i].y != yPIDLib[k0 + 4 - 15 + i] || RecOut[i].e != eLib[k0 + 4 - 15 + i]) check_fail(failed, "flight recorder");
+	}
+
+	/* The anti-windup event needs a dropped change of the I-part, so it
+	 * does not trigger with the anti-windup switched off. With it on the
+	 * recorder freezes at a step at the limit which kept the I-part. */
+	yLim = yPIDLib[k0]/2;
+	pid_RecInit(&Rec, RecBuf, 16, 0, pidRec_Arw, NULL, NULL);
+	pid_LimitsSet(2, -yLim, yLim);
+	for (b=0; yLim > 0 && b < 2; b++) {
+		pid_ArwSet(2, b == 0 ? pidArw_Off : pidArw_On);
+		pid_RecArm(&Rec);
+		pid_Reset(2);
+		for (i=0; i < DataSets && !pid_RecFrozen(&Rec); i++) {
+			pid_PartsGet(2, &P_Read, &I_Read, &D_Read);
+			pid_Step(2, eLib[i], &yCheck);
+		}
+		m = pid_RecRead(&Rec, RecOut, 16);
+		if (b == 0 && pid_RecFrozen(&Rec) != 0) check_fail(failed, "flight recorder");
+		if (b == 1 && (pid_RecFrozen(&Rec) != pidRec_Arw || m == 0 || RecOut[m - 1].I != I_Read ||
+			(RecOut[m - 1].y != yLim && RecOut[m - 1].y != -yLim))) check_fail(failed, "flight recorder");
+	}
+	if (pid_RecInit(&Rec, RecBuf, 16, 16, 0, NULL, NULL) != pidErr_Index) check_fail(failed, "flight recorder");
+	pid_RecSet(2, NULL);
+	pid_ArwSet(2, pidArw_Off);
+	pid_LimitsSet(2, PID_VAL_MIN, PID_VAL_MAX);
+
+	return 0;
+}
+#endif
+/* The tests in the order they run, each one returns 1 if it could not
+ * allocate its memory */
+static int (* const Tests[])(const TestData* T, int* failed) =
+{
+	test_Schedule,
+	test_StepDt,
+	test_DefaultState,
+	test_Groups,
+	test_Export,
+	test_Event,
+	test_Input,
+	test_Strided,
+	test_Block,
+	test_Trace,
+	test_Stats,
+#ifndef PID_FIXPOINT
+	test_Half,
+	test_Compensated,
+#endif
+	test_Log,
+	test_Exec,
+#ifdef PID_OUTPUT_STAGE
+	test_OutStage,
+#endif
+#ifdef PID_FLIGHT_RECORDER
+	test_Recorder,
+#endif
+};
+
 int main(int argc, char* argv[])
 {
 	int    DataSets = 0;
@@ -67,6 +1277,9 @@ int main(int argc, char* argv[])
 	PIDValue*  eLib;
 	PIDValue Kp_Read, Ki_Read, Kd_Read, Tf_Read, TSample_Read, Kr_Read, Tn_Read, Tv_Read;
 	PIDValue *err;
+	TestData T;
+	size_t k;
+	int check_failed = 0;
 	
 #ifndef PID_FIXPOINT
 	puts("Library got compiled for using FLOATING POINT.");
@@ -80,17 +1293,19 @@ int main(int argc, char* argv[])
 	/* Read parameters from command line 
 	 * Which controller should be tested?
 	 * Threshold for sample variance?
-	 * Command Line Options: pidtest [Testmode] [variance_thresh]
+	 * Command Line Options: pidtest [Testmode] [variance_thresh] [datafile]
 	 * TestMode = 1 (P), 2(PI), 3(PID)
 	 * variance_thresh e.g. "1.423095e-13"
-	 * if variance_thresh is not provided, then it will be  2e-13
+	 * if variance_thresh is not provided or "-", then it will be  2e-13
+	 * datafile = file with the reference data (default PIDControlTestData.txt)
 	 * */
-	 char usage_string[] = "Usage ./pidtest [TestMode] [variance_thres] \n "
+	 char usage_string[] = "Usage ./pidtest [TestMode] [variance_thres] [datafile] \n "
 	 "TestMode = 1,2 or 3 \n1 ==> Test P-Controller \n2 ==> Test PI-Controller\n"
 	 "3 ==> Test PID-Controller \n"
-	 "variance_thresh e.g. \"1.423095e-13\". If not provided then it will be 2e-13\n\n";
+	 "variance_thresh e.g. \"1.423095e-13\". If not provided or \"-\" then it will be 2e-13\n"
+	 "datafile: reference data, if not provided then PIDControlTestData.txt\n\n";
 	 
-	if (argc < 2 || argc > 3) {
+	if (argc < 2 || argc > 4) {
 		 puts(usage_string);
 		 return 1;
 	}
@@ -104,7 +1319,7 @@ int main(int argc, char* argv[])
 		printf("Test Mode is %d\n", test_mode);
 	//read threshold, if provided
 	double sample_var_thresh = 0;
-	if (argc == 3) {
+	if (argc >= 3 && strcmp(argv[2], "-") != 0) {
 		sample_var_thresh = strtod(argv[2], NULL);
 		if (sample_var_thresh == 0.0) {
 			printf("%f\n", sample_var_thresh);
@@ -149,7 +1364,7 @@ int main(int argc, char* argv[])
 	int	choice = 0;
 
 	/* Open the file with the reference test-data */
-	datafile = fopen("PIDControlTestData.txt", "r");
+	datafile = fopen(argc == 4 ? argv[3] : "PIDControlTestData.txt", "r");
 	if (datafile == NULL) 
 	{
 		printf("Couldn't open datafile for reading\n");
@@ -159,6 +1374,12 @@ int main(int argc, char* argv[])
 	/* Determine the number of datasets (=rows) provided by the test-data */
 	memset(line, 0, sizeof(line));
 	while (	fgets(line, sizeof(line), datafile) != NULL ) DataSets++;
+	if (DataSets == 0)
+	{
+		printf("No data in datafile\n");
+		fclose(datafile);
+		return 1;
+	}
 
 	/* Allocate corresponding memory for the data to import */
 	tSim    = malloc(DataSets*sizeof(double));
@@ -171,6 +1392,13 @@ int main(int argc, char* argv[])
 	yPILib  = malloc(DataSets*sizeof(PIDValue));
 	yPIDLib = malloc(DataSets*sizeof(PIDValue));
 	err = malloc(DataSets*sizeof(PIDValue));
+	if (tSim == NULL || eSim == NULL || eLib == NULL || yPSim == NULL || yPISim == NULL || yPIDSim == NULL ||
+		yPLib == NULL || yPILib == NULL || yPIDLib == NULL || err == NULL)
+	{
+		puts("Memory allocation failed");
+		fclose(datafile);
+		return 1;
+	}
 
 	/* Reset the file pointer to the beginning of the file and import the data */
 	fseek(datafile, 0, SEEK_SET);
@@ -198,6 +1426,27 @@ int main(int argc, char* argv[])
 		pid_Step(2, eLib[i], &yPIDLib[i]);
 	}
 
+	/* Check the further features against these results */
+	T.DataSets = DataSets;
+	T.eSim	  = eSim;
+	T.eLib	  = eLib;
+	T.yPLib	  = yPLib;
+	T.yPILib  = yPILib;
+	T.yPIDLib = yPIDLib;
+	T.Kp	  = Kp;
+	T.Ki	  = Ki;
+	T.Kd	  = Kd;
+	T.Tf	  = Tf;
+	T.TSample = TSample;
+	for (k=0; k < sizeof(Tests)/sizeof(Tests[0]); k++)
+	{
+		if (Tests[k](&T, &check_failed) != 0)
+		{
+			puts("Memory allocation failed");
+			return 1;
+		}
+	}
+
 	printf("Size of int8_t: %lu Byte\n", sizeof(int8_t));
 	printf("Size of uint8_t: %lu Byte\n", sizeof(uint8_t));
 	printf("Size of int16_t: %lu Byte\n", sizeof(int16_t));
@@ -354,6 +1603,13 @@ int main(int argc, char* argv[])
 	printf("squared error sum = %e\n", squared_err_sum);
 	printf("sample variance = squared error sum / number of samples = %e\n", sample_variance);
 	printf("threshold = %e", (double)sample_var_thresh);
+	if (check_failed) {
+		printf("==> Test failed! (results of the step functions differ:");
+		for (i=0; i < check_num; i++)
+			printf("%s %s", i > 0 ? "," : "", check_names[i]);
+		puts(")\n");
+		return 1;
+	}
 	if (sample_variance <= sample_var_thresh) {
 		puts("==> Test successful!\n");
 		return 0;